@@ -0,0 +1,295 @@
+// SPDX-License-Identifier: MPL-2.0
+//
+// Copyright (C) 2024 Alexander Seifarth
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+//! Benchmarks: wrapper overhead, request-response latency and notification throughput
+//!
+//! Like the tests the benchmarks create a "routing" application first, which hosts the routing
+//! manager, and then
+//! - provider: offers the routed service (echo method and an event),
+//! - consumer: requests the routed service and subscribes to the event,
+//! - local: offers the local service and calls it itself, so requests never leave the application.
+//!
+//! Groups
+//! - `wrapper`: send paths that return without a network hop (no subscriber, service not available).
+//!   They measure the FFI crossing, payload creation and vsomeip's bookkeeping only, so regressions
+//!   in the wrapper show up independently of the transport.
+//! - `request_response`: round trips with [VSomeipApplication::call()] for local and routed
+//!   services, reliable and unreliable, across payload sizes. Besides criterion's estimates the
+//!   p50/p99/p999 latencies of all samples are printed. The difference between `local` and `routed`
+//!   is the cost of the routing hop.
+//! - `notification`: notifications per second from provider to consumer across payload sizes.
+//!
+//! Note that between applications of one host vsomeip uses local (unix domain socket)
+//! communication, so `reliable` only changes the path when the configuration routes the service
+//! over the network. Unreliable payloads larger than a UDP datagram are skipped, they would need
+//! SOME/IP-TP to be configured.
+
+use std::sync::Arc;
+use std::sync::atomic::{AtomicBool, AtomicU64, Ordering};
+use std::time::{Duration, Instant};
+use bytes::Bytes;
+use criterion::{criterion_group, criterion_main, BenchmarkId, Criterion, Throughput};
+use tokio::runtime::Runtime;
+use tokio::sync::Notify;
+use vsomeiprs::{ApplicationOptions, EventGroupID, InstanceID, InterfaceVersion, MajorVersion, MessageType, MethodID,
+                ReturnCode, ServiceID, VSomeipApplication, VSomeipMessage, VSomeipReceiver};
+
+const ROUTED_SERVICE: ServiceID = ServiceID(0x0b01);
+const LOCAL_SERVICE: ServiceID = ServiceID(0x0b02);
+const UNAVAILABLE_SERVICE: ServiceID = ServiceID(0x0b03);
+const INSTANCE_ID: InstanceID = InstanceID(1);
+const ECHO_METHOD: MethodID = MethodID(0x0001);
+const EVENT_ID: MethodID = MethodID(0x8001);
+const EVENT_GROUP: EventGroupID = EventGroupID(1);
+const MAJOR: u8 = 1;
+const MINOR: u32 = 0;
+
+const SIZES: [usize; 6] = [0, 64, 1024, 16 * 1024, 256 * 1024, 1024 * 1024];
+/// Largest unreliable payload that fits into a single UDP datagram.
+const MAX_UDP_PAYLOAD: usize = 1400;
+/// Maximum number of notifications in flight during the throughput benchmark.
+const NOTIFY_WINDOW: u64 = 256;
+const TIMEOUT: Duration = Duration::from_secs(5);
+
+struct Fixture {
+    rt: Runtime,
+    _routing: (VSomeipApplication, VSomeipReceiver),
+    provider: Arc<VSomeipApplication>,
+    consumer: Arc<VSomeipApplication>,
+    local: Arc<VSomeipApplication>,
+    notifications: Arc<Counter>,
+}
+
+/// Number of notifications received by the consumer.
+#[derive(Default)]
+struct Counter {
+    value: AtomicU64,
+    changed: Notify,
+}
+
+impl Counter {
+    async fn wait_for(&self, target: u64) {
+        while self.value.load(Ordering::Acquire) < target {
+            let changed = self.changed.notified();
+            if self.value.load(Ordering::Acquire) >= target {
+                break;
+            }
+            if tokio::time::timeout(TIMEOUT, changed).await.is_err() {
+                panic!("notifications lost, received {} of {}", self.value.load(Ordering::Acquire), target);
+            }
+        }
+    }
+}
+
+impl Fixture {
+    fn new() -> Self {
+        let rt = tokio::runtime::Builder::new_multi_thread().enable_all().build().unwrap();
+        let version = InterfaceVersion::make_version(MAJOR, MINOR);
+        let notifications = Arc::new(Counter::default());
+        let available = Arc::new((AtomicBool::new(false), AtomicBool::new(false)));
+
+        let (routing, provider, consumer, local) = rt.block_on(async {
+            let routing = setup_app("routing").await;
+
+            let (provider, precv) = setup_app("bench-provider").await;
+            let provider = Arc::new(provider);
+            provider.offer_event_seg(ROUTED_SERVICE, INSTANCE_ID, EVENT_ID, EVENT_GROUP, false, None, false, true);
+            provider.offer_service(ROUTED_SERVICE, INSTANCE_ID, version);
+            tokio::spawn(serve(provider.clone(), precv, None));
+
+            let (local, lrecv) = setup_app("bench-local").await;
+            let local = Arc::new(local);
+            local.offer_service(LOCAL_SERVICE, INSTANCE_ID, version);
+            local.request_service(LOCAL_SERVICE, INSTANCE_ID, version);
+            tokio::spawn(serve(local.clone(), lrecv, Some(available.clone())));
+
+            let (consumer, crecv) = setup_app("bench-consumer").await;
+            let consumer = Arc::new(consumer);
+            consumer.request_service(ROUTED_SERVICE, INSTANCE_ID, version);
+            consumer.request_event_seg(ROUTED_SERVICE, INSTANCE_ID, EVENT_ID, EVENT_GROUP, false);
+            tokio::spawn(consume(consumer.clone(), crecv, available.clone(), notifications.clone()));
+
+            let deadline = Instant::now() + TIMEOUT;
+            while !(available.0.load(Ordering::Acquire) && available.1.load(Ordering::Acquire)) {
+                assert!(Instant::now() < deadline, "services not available");
+                tokio::time::sleep(Duration::from_millis(10)).await;
+            }
+            (routing, provider, consumer, local)
+        });
+
+        let fixture = Fixture { rt, _routing: routing, provider, consumer, local, notifications };
+        fixture.wait_subscribed();
+        fixture
+    }
+
+    /// Notifies until the consumer's subscription has been acknowledged and a notification arrived.
+    fn wait_subscribed(&self) {
+        let deadline = Instant::now() + TIMEOUT;
+        while self.notifications.value.load(Ordering::Acquire) == 0 {
+            assert!(Instant::now() < deadline, "subscription not established");
+            self.provider.notify(ROUTED_SERVICE, INSTANCE_ID, EVENT_ID, &Bytes::new(), true);
+            std::thread::sleep(Duration::from_millis(10));
+        }
+    }
+}
+
+async fn setup_app(name: &str) -> (VSomeipApplication, VSomeipReceiver) {
+    let (app, mut recv) = VSomeipApplication::create_with_options(name, ApplicationOptions::default()).unwrap();
+    assert!(recv.wait_registered_for(TIMEOUT).await, "{} not registered", name);
+    (app, recv)
+}
+
+/// Echoes every request. With `available` set the local service's availability is reported.
+async fn serve(app: Arc<VSomeipApplication>, mut recv: VSomeipReceiver,
+               available: Option<Arc<(AtomicBool, AtomicBool)>>)
+{
+    while let Some(msg) = recv.recv().await {
+        match msg {
+            VSomeipMessage::Message(MessageType::Request { header, data }) =>
+                app.send_response(&header, ReturnCode::Ok, data.as_bytes_ref()),
+            VSomeipMessage::ServiceAvailability { service_id, avail, .. } if service_id == LOCAL_SERVICE.id() => {
+                if let Some(available) = &available {
+                    available.1.store(avail, Ordering::Release);
+                }
+            }
+            _ => {}
+        }
+    }
+}
+
+/// Subscribes once the routed service is available and counts the notifications.
+async fn consume(app: Arc<VSomeipApplication>, mut recv: VSomeipReceiver,
+                 available: Arc<(AtomicBool, AtomicBool)>, notifications: Arc<Counter>)
+{
+    while let Some(msg) = recv.recv().await {
+        match msg {
+            VSomeipMessage::ServiceAvailability { service_id, avail, .. } if service_id == ROUTED_SERVICE.id() => {
+                available.0.store(avail, Ordering::Release);
+                if avail {
+                    app.subscribe(ROUTED_SERVICE, INSTANCE_ID, EVENT_GROUP, EVENT_ID, MajorVersion(MAJOR));
+                }
+            }
+            VSomeipMessage::Message(MessageType::Notification { header, .. }) if header.method_id == EVENT_ID => {
+                notifications.value.fetch_add(1, Ordering::AcqRel);
+                notifications.changed.notify_waiters();
+            }
+            _ => {}
+        }
+    }
+}
+
+fn payload(size: usize) -> Bytes {
+    Bytes::from((0..size).map(|i| i as u8).collect::<Vec<u8>>())
+}
+
+/// Prints the latency percentiles of all samples of a benchmark.
+fn report_percentiles(name: &str, samples: &mut [Duration]) {
+    if samples.is_empty() {
+        return;
+    }
+    samples.sort_unstable();
+    let at = |p: f64| samples[((samples.len() as f64 * p) as usize).min(samples.len() - 1)];
+    println!("{:<48} p50 {:>10.1?}  p99 {:>10.1?}  p999 {:>10.1?}  ({} samples)",
+             name, at(0.50), at(0.99), at(0.999), samples.len());
+}
+
+fn bench_wrapper(c: &mut Criterion, f: &Fixture) {
+    let mut group = c.benchmark_group("wrapper");
+    for size in SIZES {
+        let data = payload(size);
+        group.throughput(Throughput::Elements(1));
+        // the local application offers no event, so vsomeip drops the notification right away
+        group.bench_with_input(BenchmarkId::new("notify_unsubscribed", size), &data, |b, data| {
+            b.iter(|| f.local.notify(LOCAL_SERVICE, INSTANCE_ID, EVENT_ID, data, true))
+        });
+        group.bench_with_input(BenchmarkId::new("send_request_unavailable", size), &data, |b, data| {
+            b.iter(|| f.local.send_request(UNAVAILABLE_SERVICE, INSTANCE_ID, ECHO_METHOD, MajorVersion(MAJOR),
+                                           data, true))
+        });
+        let mut template = f.local.create_request_template(UNAVAILABLE_SERVICE, INSTANCE_ID, ECHO_METHOD,
+                                                           MajorVersion(MAJOR), true).unwrap();
+        group.bench_with_input(BenchmarkId::new("send_with_unavailable", size), &data, |b, data| {
+            b.iter(|| f.local.send_with(&mut template, data))
+        });
+    }
+    group.bench_function("payload_pool_stats", |b| b.iter(|| f.local.payload_pool_stats()));
+    group.finish();
+}
+
+fn bench_request_response(c: &mut Criterion, f: &Fixture) {
+    let mut group = c.benchmark_group("request_response");
+    group.measurement_time(Duration::from_secs(10));
+    let targets = [("local", &f.local, LOCAL_SERVICE), ("routed", &f.consumer, ROUTED_SERVICE)];
+    for (mode, app, service) in targets {
+        for reliable in [false, true] {
+            for size in SIZES {
+                if !reliable && size > MAX_UDP_PAYLOAD {
+                    continue;
+                }
+                let data = payload(size);
+                let name = format!("{}/{}", mode, if reliable { "reliable" } else { "unreliable" });
+                let mut samples = Vec::new();
+                group.throughput(Throughput::Bytes(size as u64));
+                group.bench_with_input(BenchmarkId::new(&name, size), &data, |b, data| {
+                    b.iter_custom(|iters| {
+                        f.rt.block_on(async {
+                            let mut total = Duration::ZERO;
+                            for _ in 0..iters {
+                                let start = Instant::now();
+                                let result = app.call(service, INSTANCE_ID, ECHO_METHOD, MajorVersion(MAJOR),
+                                                      data, reliable, TIMEOUT).await;
+                                let elapsed = start.elapsed();
+                                assert_eq!(result.expect("call failed").as_bytes_ref().len(), data.len());
+                                samples.push(elapsed);
+                                total += elapsed;
+                            }
+                            total
+                        })
+                    })
+                });
+                report_percentiles(&format!("request_response/{}/{}", name, size), &mut samples);
+            }
+        }
+    }
+    group.finish();
+}
+
+fn bench_notification(c: &mut Criterion, f: &Fixture) {
+    let mut group = c.benchmark_group("notification");
+    group.measurement_time(Duration::from_secs(10));
+    for size in SIZES {
+        let data = payload(size);
+        group.throughput(Throughput::Elements(1));
+        group.bench_with_input(BenchmarkId::new("routed", size), &data, |b, data| {
+            b.iter_custom(|iters| {
+                f.rt.block_on(async {
+                    let base = f.notifications.value.load(Ordering::Acquire);
+                    let start = Instant::now();
+                    for n in 0..iters {
+                        if n >= NOTIFY_WINDOW {
+                            f.notifications.wait_for(base + n - NOTIFY_WINDOW + 1).await;
+                        }
+                        f.provider.notify(ROUTED_SERVICE, INSTANCE_ID, EVENT_ID, data, true);
+                    }
+                    f.notifications.wait_for(base + iters).await;
+                    start.elapsed()
+                })
+            })
+        });
+    }
+    group.finish();
+}
+
+fn benchmarks(c: &mut Criterion) {
+    let fixture = Fixture::new();
+    bench_wrapper(c, &fixture);
+    bench_request_response(c, &fixture);
+    bench_notification(c, &fixture);
+}
+
+criterion_group!(benches, benchmarks);
+criterion_main!(benches);
@@ -11,7 +11,11 @@ use cmake;
 
 fn main() { 
     // build the vsomeipc library (static) that wraps the vsomeip3 lib
-    let dst_vsomeipc = cmake::build("vsomeipc").join("lib");
+    let mut vsomeipc = cmake::Config::new("vsomeipc");
+    if env::var_os("CARGO_FEATURE_STATIC_MEMORY").is_some() {
+        vsomeipc.define("VSOMEIPC_STATIC_MEMORY", "ON");
+    }
+    let dst_vsomeipc = vsomeipc.build().join("lib");
     println!("cargo:rustc-link-search=native={}", dst_vsomeipc.display());
     println!("cargo:rustc-link-lib=static=vsomeipc");
 
@@ -38,6 +42,28 @@ fn main() {
     println!("cargo::rerun-if-changed=vsomeipc/vsomeipc.cpp");
     println!("cargo::rerun-if-changed=vsomeipc/application.h");
     println!("cargo::rerun-if-changed=vsomeipc/application.cpp");
+    println!("cargo::rerun-if-changed=vsomeipc/payload_pool.h");
+    println!("cargo::rerun-if-changed=vsomeipc/payload_pool.cpp");
+    println!("cargo::rerun-if-changed=vsomeipc/conflation_table.h");
+    println!("cargo::rerun-if-changed=vsomeipc/conflation_table.cpp");
+    println!("cargo::rerun-if-changed=vsomeipc/message_ring.h");
+    println!("cargo::rerun-if-changed=vsomeipc/message_ring.cpp");
+    println!("cargo::rerun-if-changed=vsomeipc/route_table.h");
+    println!("cargo::rerun-if-changed=vsomeipc/route_table.cpp");
+    println!("cargo::rerun-if-changed=vsomeipc/dispatch_pool.h");
+    println!("cargo::rerun-if-changed=vsomeipc/dispatch_pool.cpp");
+    println!("cargo::rerun-if-changed=vsomeipc/stats_recorder.h");
+    println!("cargo::rerun-if-changed=vsomeipc/stats_recorder.cpp");
+    println!("cargo::rerun-if-changed=vsomeipc/standby_table.h");
+    println!("cargo::rerun-if-changed=vsomeipc/standby_table.cpp");
+    println!("cargo::rerun-if-changed=vsomeipc/field_cache.h");
+    println!("cargo::rerun-if-changed=vsomeipc/field_cache.cpp");
+    println!("cargo::rerun-if-changed=vsomeipc/subscriber_table.h");
+    println!("cargo::rerun-if-changed=vsomeipc/subscriber_table.cpp");
+    println!("cargo::rerun-if-changed=vsomeipc/shm_pool.h");
+    println!("cargo::rerun-if-changed=vsomeipc/shm_pool.cpp");
+    println!("cargo::rerun-if-changed=vsomeipc/buffer_payload.h");
+    println!("cargo::rerun-if-changed=vsomeipc/buffer_payload.cpp");
     println!("cargo::rerun-if-changed=vsomeipc/CMakeLists.txt");
 
     // we're linking C++ libraris - so we need the C++ std library.
@@ -45,7 +71,8 @@ fn main() {
     if cfg!(target_os = "macos") {
         println!("cargo:rustc-flags=-l dylib=c++");
     } else if cfg!(target_os = "linux") {
-        println!("cargo:rustc-flags=-l dylib=stdc++");
+        // shm_open is in librt before glibc 2.34
+        println!("cargo:rustc-flags=-l dylib=stdc++ -l dylib=rt");
     }
 
     // Tell cargo to look for shared libraries in the specified directory
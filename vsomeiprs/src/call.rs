@@ -0,0 +1,451 @@
+// SPDX-License-Identifier: MPL-2.0
+//
+// Copyright (C) 2024 Alexander Seifarth
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+use std::collections::HashMap;
+use std::sync::{Arc, Condvar, Mutex, MutexGuard};
+use std::sync::atomic::{AtomicUsize, Ordering};
+use std::thread::JoinHandle;
+use std::time::{Duration, Instant};
+use tokio::sync::oneshot;
+use super::{MessageHeader, MessageType, ReturnCode, VSomeipPayload};
+
+pub(crate) type CallResult = Result<VSomeipPayload, ReturnCode>;
+
+/// Resolution of the call timeouts.
+const TICK: Duration = Duration::from_millis(10);
+/// Number of timer wheel slots, timeouts longer than `SLOTS * TICK` take several wheel rounds.
+const SLOTS: u64 = 256;
+
+#[derive(Eq, PartialEq, Hash, Copy, Clone, Debug)]
+struct CallKey {
+    service: u16,
+    method: u16,
+    session: u16,
+}
+
+impl From<&MessageHeader> for CallKey {
+    fn from(header: &MessageHeader) -> Self {
+        CallKey { service: header.service_id.id(), method: header.method_id.id(), session: header.session_id.id() }
+    }
+}
+
+struct Pending {
+    reply: oneshot::Sender<CallResult>,
+    deadline: u64,
+}
+
+struct Inner {
+    pending: HashMap<CallKey, Pending>,
+    /// Hashed timer wheel, slot `deadline % SLOTS` holds the keys of the calls expiring at `deadline`.
+    /// Keys of answered calls are left in the wheel and skipped when their slot comes up.
+    wheel: Vec<Vec<CallKey>>,
+    /// Last tick processed by the timer thread.
+    tick: u64,
+    /// Number of requests being sent per (service, method). A response to such a method without a
+    /// pending call waits until the sent requests are registered, it may answer one of them.
+    sending: HashMap<(u16, u16), usize>,
+    /// Sum of `sending`.
+    sends: usize,
+    timer: Option<JoinHandle<()>>,
+    shutdown: bool,
+}
+
+/// Table of the requests sent with `VSomeipApplication::call()` that still wait for their response.
+///
+/// Registering a call and completing it are O(1). All timeouts are driven by a single timer
+/// thread which only runs while calls are pending.
+pub(crate) struct PendingCalls {
+    inner: Mutex<Inner>,
+    wakeup: Condvar,
+    /// Signalled when sent requests are registered.
+    sent: Condvar,
+    in_flight: AtomicUsize,
+    epoch: Instant,
+}
+
+impl PendingCalls {
+    pub(crate) fn new() -> Arc<Self> {
+        Arc::new(PendingCalls {
+            inner: Mutex::new(Inner {
+                pending: HashMap::new(),
+                wheel: (0..SLOTS).map(|_| Vec::new()).collect(),
+                tick: 0,
+                sending: HashMap::new(),
+                sends: 0,
+                timer: None,
+                shutdown: false,
+            }),
+            wakeup: Condvar::new(),
+            sent: Condvar::new(),
+            in_flight: AtomicUsize::new(0),
+            epoch: Instant::now(),
+        })
+    }
+
+    /// Registers the request sent by `send`, which returns the request's session.
+    /// `send` is invoked without the table locked. A response to the method arriving meanwhile
+    /// waits until the call is registered, other responses and the timeouts are processed as
+    /// usual. A still pending call with the same (service, method, session) is replaced, its
+    /// future resolves with an error.
+    pub(crate) fn register<F>(self: &Arc<Self>, service: u16, method: u16, timeout: Duration, send: F)
+        -> oneshot::Receiver<CallResult>
+        where F: FnOnce() -> u16
+    {
+        let (reply, receiver) = oneshot::channel();
+        if !self.begin_send(service, std::slice::from_ref(&method)) {
+            return receiver;
+        }
+        let key = CallKey { service, method, session: send() };
+        let deadline = self.deadline(timeout);
+        let mut inner = self.lock();
+        self.end_send(&mut inner, service, std::slice::from_ref(&method));
+        if !inner.shutdown {
+            let idle = inner.pending.is_empty();
+            Self::insert(&mut inner, key, reply, deadline);
+            self.start(&mut inner, idle);
+        }
+        drop(inner);
+        self.sent.notify_all();
+        receiver
+    }
+
+    /// Registers the requests of a scatter-gather call sent by `send`, one to each method of
+    /// `methods`, with a common deadline. `send` writes the requests' sessions to its argument in
+    /// the order of `methods`, it is invoked without the table locked like the `send` of
+    /// [PendingCalls::register()]. Returns the receivers of the responses in the same order.
+    pub(crate) fn register_many<F>(self: &Arc<Self>, service: u16, methods: &[u16], timeout: Duration, send: F)
+        -> Vec<oneshot::Receiver<CallResult>>
+        where F: FnOnce(&mut [u16])
+    {
+        let mut sessions = vec![0u16; methods.len()];
+        let mut receivers = Vec::with_capacity(methods.len());
+        if !self.begin_send(service, methods) {
+            receivers.extend(methods.iter().map(|_| oneshot::channel().1));
+            return receivers;
+        }
+        send(&mut sessions);
+        let deadline = self.deadline(timeout);
+        let mut inner = self.lock();
+        self.end_send(&mut inner, service, methods);
+        let idle = inner.pending.is_empty();
+        for (&method, &session) in methods.iter().zip(&sessions) {
+            let (reply, receiver) = oneshot::channel();
+            if !inner.shutdown {
+                Self::insert(&mut inner, CallKey { service, method, session }, reply, deadline);
+            }
+            receivers.push(receiver);
+        }
+        if !inner.shutdown {
+            self.start(&mut inner, idle);
+        }
+        drop(inner);
+        self.sent.notify_all();
+        receivers
+    }
+
+    /// Marks requests to `methods` as being sent. Returns false after shutdown.
+    fn begin_send(&self, service: u16, methods: &[u16]) -> bool {
+        let mut inner = self.lock();
+        if inner.shutdown {
+            return false;
+        }
+        for &method in methods {
+            *inner.sending.entry((service, method)).or_default() += 1;
+        }
+        inner.sends += methods.len();
+        // responses must not pass by the table until the requests are registered
+        self.publish(&inner);
+        true
+    }
+
+    fn end_send(&self, inner: &mut Inner, service: u16, methods: &[u16]) {
+        for &method in methods {
+            let key = (service, method);
+            let count = inner.sending.get_mut(&key).unwrap();
+            *count -= 1;
+            if *count == 0 {
+                inner.sending.remove(&key);
+            }
+        }
+        inner.sends -= methods.len();
+        self.publish(inner);
+    }
+
+    /// Publishes the number of calls a response may belong to, see [PendingCalls::complete()].
+    fn publish(&self, inner: &Inner) {
+        self.in_flight.store(inner.pending.len() + inner.sends, Ordering::Relaxed);
+    }
+
+    fn deadline(&self, timeout: Duration) -> u64 {
+        self.now_tick() + (timeout.as_nanos().div_ceil(TICK.as_nanos()) as u64).max(1)
+    }
+
+    fn insert(inner: &mut Inner, key: CallKey, reply: oneshot::Sender<CallResult>, deadline: u64) {
+        inner.wheel[(deadline % SLOTS) as usize].push(key);
+        inner.pending.insert(key, Pending { reply, deadline });
+    }
+
+    /// Publishes the number of pending calls and makes sure the timer runs for newly registered ones,
+    /// `idle` tells whether no calls were pending before.
+    fn start(self: &Arc<Self>, inner: &mut Inner, idle: bool) {
+        self.publish(inner);
+        if inner.timer.is_none() {
+            // the timer must not run behind the deadline of the first call
+            inner.tick = self.now_tick();
+            let calls = self.clone();
+            inner.timer = Some(std::thread::spawn(move || calls.run_timer()));
+        } else if idle {
+            self.wakeup.notify_one();
+        }
+    }
+
+    /// Completes the pending call `msg` responds to. Returns `msg` if it is no response to a
+    /// pending call.
+    pub(crate) fn complete(&self, msg: MessageType) -> Option<MessageType> {
+        if self.in_flight.load(Ordering::Relaxed) == 0 {
+            return Some(msg);
+        }
+        let key = match &msg {
+            MessageType::Response { header, .. } | MessageType::Error { header, .. } => CallKey::from(header),
+            _ => return Some(msg),
+        };
+        let pending = {
+            let mut inner = self.lock();
+            let pending = loop {
+                if let Some(pending) = inner.pending.remove(&key) {
+                    break Some(pending);
+                }
+                if !inner.sending.contains_key(&(key.service, key.method)) {
+                    break None;
+                }
+                inner = self.sent.wait(inner).unwrap();
+            };
+            self.publish(&inner);
+            pending
+        };
+        let Some(pending) = pending else {
+            return Some(msg);
+        };
+        let result = match msg {
+            MessageType::Response { data, .. } => Ok(data),
+            MessageType::Error { return_code, .. } => Err(return_code),
+            _ => unreachable!(),
+        };
+        // the caller may have dropped the future already
+        let _ = pending.reply.send(result);
+        None
+    }
+
+    /// Stops the timer thread, all pending calls resolve with an error.
+    pub(crate) fn shutdown(&self) {
+        let timer = {
+            let mut inner = self.lock();
+            inner.shutdown = true;
+            inner.pending.clear();
+            self.publish(&inner);
+            inner.timer.take()
+        };
+        self.wakeup.notify_one();
+        if let Some(timer) = timer {
+            let _ = timer.join();
+        }
+    }
+
+    fn run_timer(&self) {
+        let mut inner = self.lock();
+        loop {
+            while inner.pending.is_empty() && !inner.shutdown {
+                inner = self.wakeup.wait(inner).unwrap();
+            }
+            if inner.shutdown {
+                return;
+            }
+            drop(inner);
+            std::thread::sleep(TICK);
+            inner = self.lock();
+            let expired = self.advance(&mut inner);
+            if !expired.is_empty() {
+                drop(inner);
+                for reply in expired {
+                    let _ = reply.send(Err(ReturnCode::Timeout));
+                }
+                inner = self.lock();
+            }
+        }
+    }
+
+    /// Processes the wheel slots up to the current tick and returns the expired calls.
+    fn advance(&self, inner: &mut Inner) -> Vec<oneshot::Sender<CallResult>> {
+        let now = self.now_tick();
+        let mut expired = Vec::new();
+        // every slot is visited at most once, calls of later wheel rounds stay in their slot
+        let steps = now.saturating_sub(inner.tick).min(SLOTS);
+        let Inner { pending, wheel, tick, .. } = inner;
+        for step in 1..=steps {
+            wheel[((*tick + step) % SLOTS) as usize].retain(|key| match pending.get(key) {
+                Some(p) if p.deadline <= now => {
+                    expired.push(pending.remove(key).unwrap().reply);
+                    false
+                }
+                Some(_) => true,
+                None => false,
+            });
+        }
+        *tick = now;
+        self.publish(inner);
+        expired
+    }
+
+    fn now_tick(&self) -> u64 {
+        (self.epoch.elapsed().as_nanos() / TICK.as_nanos()) as u64
+    }
+
+    fn lock(&self) -> MutexGuard<'_, Inner> {
+        self.inner.lock().unwrap()
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use super::*;
+    use crate::{ClientID, InstanceID, InterfaceVersion, MethodID, ServiceID, SessionID};
+
+    fn header(method: u16, session: u16) -> MessageHeader {
+        MessageHeader {
+            service_id: ServiceID(0x1234),
+            instance_id: InstanceID(1),
+            method_id: MethodID(method),
+            client_id: ClientID(0),
+            session_id: SessionID(session),
+            interface_version: InterfaceVersion::make_major(1),
+            reliable: false,
+            trace: None,
+        }
+    }
+
+    fn response(method: u16, session: u16) -> MessageType {
+        MessageType::Response { header: header(method, session), data: VSomeipPayload::from(std::ptr::null_mut()) }
+    }
+
+    #[test]
+    fn complete_test() {
+        let calls = PendingCalls::new();
+        let reply = calls.register(0x1234, 1, Duration::from_secs(5), || 7);
+        assert!(calls.complete(response(1, 8)).is_some());
+        assert!(calls.complete(response(2, 7)).is_some());
+        assert!(calls.complete(response(1, 7)).is_none());
+        assert!(reply.blocking_recv().unwrap().is_ok());
+        assert!(calls.complete(response(1, 7)).is_some());
+        calls.shutdown();
+    }
+
+    #[test]
+    fn error_test() {
+        let calls = PendingCalls::new();
+        let reply = calls.register(0x1234, 1, Duration::from_secs(5), || 3);
+        let error = MessageType::Error { header: header(1, 3), return_code: ReturnCode::NotReady,
+            data: VSomeipPayload::from(std::ptr::null_mut()) };
+        assert!(calls.complete(error).is_none());
+        assert_eq!(reply.blocking_recv().unwrap().unwrap_err(), ReturnCode::NotReady);
+        calls.shutdown();
+    }
+
+    #[test]
+    fn timeout_test() {
+        let calls = PendingCalls::new();
+        let short = calls.register(0x1234, 1, Duration::from_millis(20), || 1);
+        let long = calls.register(0x1234, 1, Duration::from_secs(5), || 2);
+        assert_eq!(short.blocking_recv().unwrap().unwrap_err(), ReturnCode::Timeout);
+        assert!(calls.complete(response(1, 2)).is_none());
+        assert!(long.blocking_recv().unwrap().is_ok());
+        calls.shutdown();
+    }
+
+    /// Completes the call from another thread while `send` is still running.
+    fn complete_during_send(calls: &Arc<PendingCalls>, method: u16, session: u16)
+        -> std::sync::mpsc::Receiver<bool>
+    {
+        let (done, result) = std::sync::mpsc::channel();
+        let calls = calls.clone();
+        std::thread::spawn(move || { let _ = done.send(calls.complete(response(method, session)).is_none()); });
+        std::thread::sleep(Duration::from_millis(50));
+        result
+    }
+
+    #[test]
+    fn response_during_send_test() {
+        let calls = PendingCalls::new();
+        let mut completed = None;
+        let reply = calls.register(0x1234, 1, Duration::from_secs(5), || {
+            completed = Some(complete_during_send(&calls, 1, 9));
+            9
+        });
+        assert!(completed.unwrap().recv().unwrap());
+        assert!(reply.blocking_recv().unwrap().is_ok());
+
+        let mut completed = None;
+        let replies = calls.register_many(0x1234, &[1, 2], Duration::from_secs(5), |sessions| {
+            completed = Some(complete_during_send(&calls, 2, 11));
+            sessions.copy_from_slice(&[10, 11]);
+        });
+        assert!(completed.unwrap().recv().unwrap());
+        let mut replies = replies.into_iter();
+        let first = replies.next().unwrap();
+        assert!(replies.next().unwrap().blocking_recv().unwrap().is_ok());
+        assert!(calls.complete(response(1, 10)).is_none());
+        assert!(first.blocking_recv().unwrap().is_ok());
+
+        // a fan-out does not hold up responses of other calls
+        let other = calls.register(0x1234, 3, Duration::from_secs(5), || 12);
+        let replies = calls.register_many(0x1234, &[1, 2], Duration::from_secs(5), |sessions| {
+            assert!(calls.complete(response(3, 12)).is_none());
+            sessions.copy_from_slice(&[13, 14]);
+        });
+        assert!(other.blocking_recv().unwrap().is_ok());
+        assert_eq!(replies.len(), 2);
+        calls.shutdown();
+    }
+
+    #[test]
+    fn unlocked_send_test() {
+        let calls = PendingCalls::new();
+        let first = calls.register(0x1234, 1, Duration::from_secs(5), || 1);
+        // responses of other methods and pending calls are processed while a request is sent
+        let second = calls.register(0x1234, 2, Duration::from_secs(5), || {
+            assert!(calls.complete(response(3, 2)).is_some());
+            assert!(calls.complete(response(1, 1)).is_none());
+            2
+        });
+        assert!(first.blocking_recv().unwrap().is_ok());
+        assert!(calls.complete(response(2, 2)).is_none());
+        assert!(second.blocking_recv().unwrap().is_ok());
+        calls.shutdown();
+    }
+
+    #[test]
+    fn register_many_test() {
+        let calls = PendingCalls::new();
+        let replies = calls.register_many(0x1234, &[1, 1, 2], Duration::from_millis(50), |sessions| {
+            sessions.copy_from_slice(&[4, 5, 6]);
+        });
+        assert!(calls.complete(response(2, 6)).is_none());
+        assert!(calls.complete(response(1, 4)).is_none());
+        let results: Vec<_> = replies.into_iter().map(|r| r.blocking_recv().unwrap()).collect();
+        assert!(results[0].is_ok());
+        assert_eq!(results[1].as_ref().unwrap_err(), &ReturnCode::Timeout);
+        assert!(results[2].is_ok());
+        calls.shutdown();
+    }
+
+    #[test]
+    fn shutdown_test() {
+        let calls = PendingCalls::new();
+        let reply = calls.register(0x1234, 1, Duration::from_secs(5), || 1);
+        calls.shutdown();
+        assert!(reply.blocking_recv().is_err());
+    }
+}
@@ -0,0 +1,444 @@
+// SPDX-License-Identifier: MPL-2.0
+//
+// Copyright (C) 2024 Alexander Seifarth
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+//! Declarative description of the services, events and subscriptions of an application.
+//!
+//! A [Catalogue] is written in JSON (feature `json`) or built in code and compiled into a compact
+//! binary form with [Catalogue::encode()]. The binary form can be memory mapped and is read in
+//! place by [CatalogueView], which [crate::VSomeipApplication::load_catalogue()] registers in one go.
+//!
+//! Binary layout (little endian):
+//! ```text
+//! header        "VSCT" version:u16 reserved:u16 services:u32 events:u32 subscriptions:u32 groups:u32
+//! service       service:u16 instance:u16 minor:u32 major:u8 role:u8 reserved:u16
+//! event         service:u16 instance:u16 notifier:u16 flags:u8 role:u8 cycle_ms:u32 first_group:u32 groups:u32
+//! subscription  service:u16 instance:u16 event_group:u16 notifier:u16 major:u8 reserved:u24
+//! group         event_group:u16
+//! ```
+
+use std::fmt;
+
+const MAGIC: &[u8; 4] = b"VSCT";
+const VERSION: u16 = 1;
+const HEADER_SIZE: usize = 24;
+const SERVICE_SIZE: usize = 12;
+const EVENT_SIZE: usize = 20;
+const SUBSCRIPTION_SIZE: usize = 12;
+const GROUP_SIZE: usize = 2;
+
+const FLAG_FIELD: u8 = 0x01;
+const FLAG_CHANGE_RESETS_CYCLE: u8 = 0x02;
+const FLAG_UPDATE_ON_CHANGE: u8 = 0x04;
+
+/// Whether the application provides or consumes a service or event.
+#[derive(Debug, Clone, Copy, Eq, PartialEq, Default)]
+#[cfg_attr(feature = "json", derive(serde::Deserialize), serde(rename_all = "lowercase"))]
+pub enum Role {
+    #[default]
+    Offered,
+    Consumed,
+}
+
+/// A service instance offered or requested by the application.
+#[derive(Debug, Clone, Eq, PartialEq)]
+#[cfg_attr(feature = "json", derive(serde::Deserialize))]
+pub struct CatalogueService {
+    #[cfg_attr(feature = "json", serde(deserialize_with = "json::id"))]
+    pub service: u16,
+    #[cfg_attr(feature = "json", serde(deserialize_with = "json::id"))]
+    pub instance: u16,
+    #[cfg_attr(feature = "json", serde(deserialize_with = "json::id"))]
+    pub major: u8,
+    #[cfg_attr(feature = "json", serde(default, deserialize_with = "json::id"))]
+    pub minor: u32,
+    #[cfg_attr(feature = "json", serde(default))]
+    pub role: Role,
+}
+
+/// An event or field offered or requested by the application.
+#[derive(Debug, Clone, Eq, PartialEq)]
+#[cfg_attr(feature = "json", derive(serde::Deserialize))]
+pub struct CatalogueEvent {
+    #[cfg_attr(feature = "json", serde(deserialize_with = "json::id"))]
+    pub service: u16,
+    #[cfg_attr(feature = "json", serde(deserialize_with = "json::id"))]
+    pub instance: u16,
+    #[cfg_attr(feature = "json", serde(deserialize_with = "json::id"))]
+    pub notifier: u16,
+    #[cfg_attr(feature = "json", serde(deserialize_with = "json::ids"))]
+    pub event_groups: Vec<u16>,
+    #[cfg_attr(feature = "json", serde(default))]
+    pub is_field: bool,
+    #[cfg_attr(feature = "json", serde(default))]
+    pub role: Role,
+    /// Cycle time of cyclic notifications in ms, 0 disables them (offered events only).
+    #[cfg_attr(feature = "json", serde(default))]
+    pub cycle_ms: u32,
+    #[cfg_attr(feature = "json", serde(default))]
+    pub change_resets_cycle: bool,
+    #[cfg_attr(feature = "json", serde(default = "json::yes"))]
+    pub update_on_change: bool,
+}
+
+/// A subscription of an event group of a consumed service.
+#[derive(Debug, Clone, Eq, PartialEq)]
+#[cfg_attr(feature = "json", derive(serde::Deserialize))]
+pub struct CatalogueSubscription {
+    #[cfg_attr(feature = "json", serde(deserialize_with = "json::id"))]
+    pub service: u16,
+    #[cfg_attr(feature = "json", serde(deserialize_with = "json::id"))]
+    pub instance: u16,
+    #[cfg_attr(feature = "json", serde(deserialize_with = "json::id"))]
+    pub event_group: u16,
+    /// Event of the group to forward, 0xffff forwards all events of the group.
+    #[cfg_attr(feature = "json", serde(default = "json::any_event", deserialize_with = "json::id"))]
+    pub notifier: u16,
+    #[cfg_attr(feature = "json", serde(deserialize_with = "json::id"))]
+    pub major: u8,
+}
+
+/// Services, events and subscriptions of an application.
+#[derive(Debug, Clone, Default, Eq, PartialEq)]
+#[cfg_attr(feature = "json", derive(serde::Deserialize), serde(default))]
+pub struct Catalogue {
+    pub services: Vec<CatalogueService>,
+    pub events: Vec<CatalogueEvent>,
+    pub subscriptions: Vec<CatalogueSubscription>,
+}
+
+/// Errors of reading a catalogue.
+#[derive(Debug, Clone, Eq, PartialEq)]
+pub enum CatalogueError {
+    /// The data does not start with the catalogue magic.
+    BadMagic,
+    /// The binary format version is not supported.
+    UnsupportedVersion(u16),
+    /// The data size does not match the table sizes of the header.
+    BadSize,
+    /// The event with the given index refers to event groups outside the group table.
+    BadEventGroups(usize),
+    /// The JSON source is invalid.
+    Json(String),
+}
+
+impl fmt::Display for CatalogueError {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        match self {
+            CatalogueError::BadMagic => write!(f, "not a service catalogue"),
+            CatalogueError::UnsupportedVersion(v) => write!(f, "unsupported catalogue version {}", v),
+            CatalogueError::BadSize => write!(f, "catalogue size does not match its header"),
+            CatalogueError::BadEventGroups(idx) => write!(f, "event {} has invalid event groups", idx),
+            CatalogueError::Json(e) => write!(f, "invalid catalogue source: {}", e),
+        }
+    }
+}
+
+impl std::error::Error for CatalogueError {}
+
+impl Catalogue {
+    /// Parses the JSON source form of a catalogue. Ids are given as numbers or hex strings ("0x1234").
+    #[cfg(feature = "json")]
+    pub fn from_json(source: &str) -> Result<Self, CatalogueError> {
+        serde_json::from_str(source).map_err(|e| CatalogueError::Json(e.to_string()))
+    }
+
+    /// Returns the binary form of the catalogue.
+    pub fn encode(&self) -> Vec<u8> {
+        let groups: usize = self.events.iter().map(|e| e.event_groups.len()).sum();
+        let mut out = Vec::with_capacity(HEADER_SIZE + self.services.len() * SERVICE_SIZE
+            + self.events.len() * EVENT_SIZE + self.subscriptions.len() * SUBSCRIPTION_SIZE + groups * GROUP_SIZE);
+        out.extend_from_slice(MAGIC);
+        out.extend_from_slice(&VERSION.to_le_bytes());
+        out.extend_from_slice(&0u16.to_le_bytes());
+        for count in [self.services.len(), self.events.len(), self.subscriptions.len(), groups] {
+            out.extend_from_slice(&(count as u32).to_le_bytes());
+        }
+        for s in &self.services {
+            out.extend_from_slice(&s.service.to_le_bytes());
+            out.extend_from_slice(&s.instance.to_le_bytes());
+            out.extend_from_slice(&s.minor.to_le_bytes());
+            out.extend_from_slice(&[s.major, s.role as u8, 0, 0]);
+        }
+        let mut first_group = 0u32;
+        for e in &self.events {
+            let flags = if e.is_field { FLAG_FIELD } else { 0 }
+                | if e.change_resets_cycle { FLAG_CHANGE_RESETS_CYCLE } else { 0 }
+                | if e.update_on_change { FLAG_UPDATE_ON_CHANGE } else { 0 };
+            out.extend_from_slice(&e.service.to_le_bytes());
+            out.extend_from_slice(&e.instance.to_le_bytes());
+            out.extend_from_slice(&e.notifier.to_le_bytes());
+            out.extend_from_slice(&[flags, e.role as u8]);
+            out.extend_from_slice(&e.cycle_ms.to_le_bytes());
+            out.extend_from_slice(&first_group.to_le_bytes());
+            out.extend_from_slice(&(e.event_groups.len() as u32).to_le_bytes());
+            first_group += e.event_groups.len() as u32;
+        }
+        for s in &self.subscriptions {
+            out.extend_from_slice(&s.service.to_le_bytes());
+            out.extend_from_slice(&s.instance.to_le_bytes());
+            out.extend_from_slice(&s.event_group.to_le_bytes());
+            out.extend_from_slice(&s.notifier.to_le_bytes());
+            out.extend_from_slice(&[s.major, 0, 0, 0]);
+        }
+        for e in &self.events {
+            for g in &e.event_groups {
+                out.extend_from_slice(&g.to_le_bytes());
+            }
+        }
+        out
+    }
+}
+
+/// Read-only view of the binary form of a catalogue, e.g. of a memory mapped file.
+/// The data is validated once on creation and read in place afterwards.
+#[derive(Debug, Clone, Copy)]
+pub struct CatalogueView<'a> {
+    services: &'a [u8],
+    events: &'a [u8],
+    subscriptions: &'a [u8],
+    groups: &'a [u8],
+}
+
+fn u16_at(data: &[u8], pos: usize) -> u16 {
+    u16::from_le_bytes([data[pos], data[pos + 1]])
+}
+
+fn u32_at(data: &[u8], pos: usize) -> u32 {
+    u32::from_le_bytes([data[pos], data[pos + 1], data[pos + 2], data[pos + 3]])
+}
+
+fn role_of(value: u8) -> Role {
+    if value == Role::Consumed as u8 { Role::Consumed } else { Role::Offered }
+}
+
+/// Record of the event table, the event groups are stored separately.
+pub(crate) struct EventRecord {
+    pub(crate) service: u16,
+    pub(crate) instance: u16,
+    pub(crate) notifier: u16,
+    pub(crate) is_field: bool,
+    pub(crate) role: Role,
+    pub(crate) cycle_ms: u32,
+    pub(crate) change_resets_cycle: bool,
+    pub(crate) update_on_change: bool,
+    pub(crate) first_group: usize,
+    pub(crate) groups: usize,
+}
+
+impl<'a> CatalogueView<'a> {
+    /// Validates the binary catalogue `data`.
+    pub fn new(data: &'a [u8]) -> Result<Self, CatalogueError> {
+        if data.len() < HEADER_SIZE || &data[0..4] != MAGIC {
+            return Err(CatalogueError::BadMagic);
+        }
+        let version = u16_at(data, 4);
+        if version != VERSION {
+            return Err(CatalogueError::UnsupportedVersion(version));
+        }
+        let counts = [u32_at(data, 8), u32_at(data, 12), u32_at(data, 16), u32_at(data, 20)];
+        let mut rest = &data[HEADER_SIZE..];
+        let mut tables = [&rest[..0]; 4];
+        for (idx, size) in [SERVICE_SIZE, EVENT_SIZE, SUBSCRIPTION_SIZE, GROUP_SIZE].into_iter().enumerate() {
+            let len = (counts[idx] as usize).checked_mul(size).ok_or(CatalogueError::BadSize)?;
+            if rest.len() < len {
+                return Err(CatalogueError::BadSize);
+            }
+            (tables[idx], rest) = rest.split_at(len);
+        }
+        if !rest.is_empty() {
+            return Err(CatalogueError::BadSize);
+        }
+        let view = CatalogueView { services: tables[0], events: tables[1], subscriptions: tables[2], groups: tables[3] };
+        let group_count = view.groups.len() / GROUP_SIZE;
+        for idx in 0..view.event_count() {
+            let e = view.event(idx);
+            if e.first_group.checked_add(e.groups).map_or(true, |end| end > group_count) {
+                return Err(CatalogueError::BadEventGroups(idx));
+            }
+        }
+        Ok(view)
+    }
+
+    pub fn service_count(&self) -> usize {
+        self.services.len() / SERVICE_SIZE
+    }
+
+    pub fn event_count(&self) -> usize {
+        self.events.len() / EVENT_SIZE
+    }
+
+    pub fn subscription_count(&self) -> usize {
+        self.subscriptions.len() / SUBSCRIPTION_SIZE
+    }
+
+    pub fn service(&self, idx: usize) -> CatalogueService {
+        let r = &self.services[idx * SERVICE_SIZE..][..SERVICE_SIZE];
+        CatalogueService { service: u16_at(r, 0), instance: u16_at(r, 2), minor: u32_at(r, 4), major: r[8],
+                           role: role_of(r[9]) }
+    }
+
+    pub(crate) fn event(&self, idx: usize) -> EventRecord {
+        let r = &self.events[idx * EVENT_SIZE..][..EVENT_SIZE];
+        EventRecord {
+            service: u16_at(r, 0),
+            instance: u16_at(r, 2),
+            notifier: u16_at(r, 4),
+            is_field: r[6] & FLAG_FIELD != 0,
+            role: role_of(r[7]),
+            cycle_ms: u32_at(r, 8),
+            change_resets_cycle: r[6] & FLAG_CHANGE_RESETS_CYCLE != 0,
+            update_on_change: r[6] & FLAG_UPDATE_ON_CHANGE != 0,
+            first_group: u32_at(r, 12) as usize,
+            groups: u32_at(r, 16) as usize,
+        }
+    }
+
+    /// Returns the event groups of all events of the catalogue, an event's groups are the range
+    /// `first_group..first_group + groups` of it.
+    pub(crate) fn event_groups(&self) -> impl Iterator<Item = u16> + 'a {
+        self.groups.chunks_exact(GROUP_SIZE).map(|g| u16::from_le_bytes([g[0], g[1]]))
+    }
+
+    pub fn subscription(&self, idx: usize) -> CatalogueSubscription {
+        let r = &self.subscriptions[idx * SUBSCRIPTION_SIZE..][..SUBSCRIPTION_SIZE];
+        CatalogueSubscription { service: u16_at(r, 0), instance: u16_at(r, 2), event_group: u16_at(r, 4),
+                                notifier: u16_at(r, 6), major: r[8] }
+    }
+
+    /// Copies the catalogue into its owned form.
+    pub fn to_catalogue(&self) -> Catalogue {
+        let groups: Vec<u16> = self.event_groups().collect();
+        Catalogue {
+            services: (0..self.service_count()).map(|idx| self.service(idx)).collect(),
+            events: (0..self.event_count()).map(|idx| {
+                let e = self.event(idx);
+                CatalogueEvent {
+                    service: e.service, instance: e.instance, notifier: e.notifier,
+                    event_groups: groups[e.first_group..e.first_group + e.groups].to_vec(),
+                    is_field: e.is_field, role: e.role, cycle_ms: e.cycle_ms,
+                    change_resets_cycle: e.change_resets_cycle, update_on_change: e.update_on_change,
+                }
+            }).collect(),
+            subscriptions: (0..self.subscription_count()).map(|idx| self.subscription(idx)).collect(),
+        }
+    }
+}
+
+#[cfg(feature = "json")]
+mod json {
+    use serde::de::{Deserializer, Error};
+    use serde::Deserialize;
+
+    #[derive(Deserialize)]
+    #[serde(untagged)]
+    enum Id {
+        Number(u64),
+        Text(String),
+    }
+
+    impl Id {
+        fn value<T: TryFrom<u64>, E: Error>(self) -> Result<T, E> {
+            let value = match self {
+                Id::Number(n) => n,
+                Id::Text(s) => match s.strip_prefix("0x").or_else(|| s.strip_prefix("0X")) {
+                    Some(hex) => u64::from_str_radix(hex, 16),
+                    None => s.parse(),
+                }.map_err(|_| E::custom(format!("invalid id {:?}", s)))?,
+            };
+            T::try_from(value).map_err(|_| E::custom(format!("id {:#x} out of range", value)))
+        }
+    }
+
+    pub(super) fn id<'de, D: Deserializer<'de>, T: TryFrom<u64>>(d: D) -> Result<T, D::Error> {
+        Id::deserialize(d)?.value()
+    }
+
+    pub(super) fn ids<'de, D: Deserializer<'de>, T: TryFrom<u64>>(d: D) -> Result<Vec<T>, D::Error> {
+        Vec::<Id>::deserialize(d)?.into_iter().map(Id::value).collect()
+    }
+
+    pub(super) fn yes() -> bool {
+        true
+    }
+
+    pub(super) fn any_event() -> u16 {
+        0xffff
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use super::*;
+
+    fn catalogue() -> Catalogue {
+        Catalogue {
+            services: vec![
+                CatalogueService { service: 0x1234, instance: 1, major: 1, minor: 2, role: Role::Offered },
+                CatalogueService { service: 0x5678, instance: 3, major: 2, minor: 0, role: Role::Consumed },
+            ],
+            events: vec![
+                CatalogueEvent { service: 0x1234, instance: 1, notifier: 0x8001, event_groups: vec![1, 2],
+                                 is_field: true, role: Role::Offered, cycle_ms: 100, change_resets_cycle: true,
+                                 update_on_change: false },
+                CatalogueEvent { service: 0x5678, instance: 3, notifier: 0x8002, event_groups: vec![5],
+                                 is_field: false, role: Role::Consumed, cycle_ms: 0, change_resets_cycle: false,
+                                 update_on_change: true },
+            ],
+            subscriptions: vec![
+                CatalogueSubscription { service: 0x5678, instance: 3, event_group: 5, notifier: 0xffff, major: 2 },
+            ],
+        }
+    }
+
+    #[test]
+    fn encode_test() {
+        let c = catalogue();
+        let data = c.encode();
+        assert_eq!(data.len(), HEADER_SIZE + 2 * SERVICE_SIZE + 2 * EVENT_SIZE + SUBSCRIPTION_SIZE + 3 * GROUP_SIZE);
+        let view = CatalogueView::new(&data).unwrap();
+        assert_eq!(view.service_count(), 2);
+        assert_eq!(view.event_count(), 2);
+        assert_eq!(view.subscription_count(), 1);
+        assert_eq!(view.to_catalogue(), c);
+    }
+
+    #[test]
+    fn validate_test() {
+        let mut data = catalogue().encode();
+        assert_eq!(CatalogueView::new(&data[..data.len() - 1]).unwrap_err(), CatalogueError::BadSize);
+        assert_eq!(CatalogueView::new(&data[1..]).unwrap_err(), CatalogueError::BadMagic);
+        // second event refers to groups 3..4 of 3
+        let first_group = HEADER_SIZE + 2 * SERVICE_SIZE + EVENT_SIZE + 12;
+        data[first_group] = 3;
+        assert_eq!(CatalogueView::new(&data).unwrap_err(), CatalogueError::BadEventGroups(1));
+        data[4] = 2;
+        assert_eq!(CatalogueView::new(&data).unwrap_err(), CatalogueError::UnsupportedVersion(2));
+    }
+
+    #[cfg(feature = "json")]
+    #[test]
+    fn json_test() {
+        let c = Catalogue::from_json(r#"{
+            "services": [
+                { "service": "0x1234", "instance": 1, "major": 1, "minor": 2 },
+                { "service": "0x5678", "instance": "0x3", "major": 2, "role": "consumed" }
+            ],
+            "events": [
+                { "service": "0x1234", "instance": 1, "notifier": "0x8001", "event_groups": [1, "0x2"],
+                  "is_field": true, "cycle_ms": 100, "change_resets_cycle": true, "update_on_change": false },
+                { "service": "0x5678", "instance": 3, "notifier": "0x8002", "event_groups": [5],
+                  "role": "consumed" }
+            ],
+            "subscriptions": [
+                { "service": "0x5678", "instance": 3, "event_group": 5, "major": 2 }
+            ]
+        }"#).unwrap();
+        assert_eq!(c, catalogue());
+        assert!(Catalogue::from_json(r#"{ "services": [ { "service": "0x12345", "instance": 1, "major": 1 } ] }"#)
+            .is_err());
+    }
+}
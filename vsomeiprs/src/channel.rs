@@ -0,0 +1,578 @@
+// SPDX-License-Identifier: MPL-2.0
+//
+// Copyright (C) 2024 Alexander Seifarth
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+use std::collections::{HashMap, HashSet, VecDeque};
+use std::io::{self, Write};
+use std::sync::{Arc, Condvar, Mutex, MutexGuard, RwLock};
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::time::{Duration, Instant};
+use tokio::sync::mpsc::UnboundedSender;
+use tokio::sync::Notify;
+use tokio::time::timeout;
+use super::{MessageType, VSomeipMessage};
+use super::stats::{Histogram, HistogramSnapshot};
+use super::ring::{RingSender, SpscRing};
+use super::trace::{self, TraceRecord, TraceRing};
+
+/// Behaviour of a bounded receive queue when a message arrives while the queue is full.
+#[derive(Eq, PartialEq, Debug, Copy, Clone, Default)]
+pub enum OverflowPolicy {
+    /// The vsomeip dispatch thread waits until the consumer made room in the queue.
+    #[default]
+    Block,
+    /// The arriving message is discarded.
+    DropNewest,
+    /// The oldest queued message is discarded to make room for the arriving one.
+    DropOldest,
+    /// A notification of a field replaces a still queued notification of the same field, as only
+    /// the latest value of a field matters. Fields are the events requested with `is_field` set.
+    /// Notifications are coalesced regardless of the fill level, other messages (including the
+    /// notifications of plain events) arriving at a full queue are discarded.
+    CoalesceFields,
+}
+
+/// Counters of a bounded receive queue.
+#[derive(Debug, Default, Copy, Clone, Eq, PartialEq)]
+pub struct ChannelStats {
+    /// Messages discarded on arrival ([OverflowPolicy::DropNewest] and [OverflowPolicy::CoalesceFields]).
+    pub dropped_newest: u64,
+    /// Queued messages discarded in favour of newer ones ([OverflowPolicy::DropOldest]).
+    pub dropped_oldest: u64,
+    /// Queued notifications replaced by a newer value ([OverflowPolicy::CoalesceFields]).
+    pub coalesced: u64,
+    /// Number of times the dispatch thread had to wait for room ([OverflowPolicy::Block]).
+    pub blocked: u64,
+    /// Highest number of messages queued at the same time.
+    pub high_water: u64,
+}
+
+type CoalesceKey = (u16, u16, u16);
+
+/// The (service, instance, notifier) of the events an application has requested as fields, shared
+/// with its receive queues.
+#[derive(Default)]
+pub(crate) struct FieldSet(RwLock<HashSet<CoalesceKey>>);
+
+impl FieldSet {
+    pub(crate) fn insert(&self, service_id: u16, instance_id: u16, notifier_id: u16) {
+        self.0.write().unwrap_or_else(|e| e.into_inner()).insert((service_id, instance_id, notifier_id));
+    }
+
+    pub(crate) fn remove(&self, service_id: u16, instance_id: u16, notifier_id: u16) {
+        self.0.write().unwrap_or_else(|e| e.into_inner()).remove(&(service_id, instance_id, notifier_id));
+    }
+
+    fn contains(&self, key: &CoalesceKey) -> bool {
+        self.0.read().unwrap_or_else(|e| e.into_inner()).contains(key)
+    }
+}
+
+struct Queued {
+    msg: VSomeipMessage,
+    enqueued: Instant,
+}
+
+struct QueueState {
+    items: VecDeque<Queued>,
+    /// sequence number of the front element of `items`
+    head_seq: u64,
+    /// sequence number of the queued notification per key (CoalesceFields only)
+    coalesce: HashMap<CoalesceKey, u64>,
+    sender_alive: bool,
+    receiver_alive: bool,
+    high_water: usize,
+}
+
+pub(crate) struct BoundedQueue {
+    state: Mutex<QueueState>,
+    not_full: Condvar,
+    notify: Notify,
+    capacity: usize,
+    policy: OverflowPolicy,
+    dropped_newest: AtomicU64,
+    dropped_oldest: AtomicU64,
+    coalesced: AtomicU64,
+    blocked: AtomicU64,
+    /// time from push to pop of the messages
+    latency: Histogram,
+    /// the last popped messages sampled for tracing
+    traces: TraceRing,
+    /// the notifications coalesced by CoalesceFields
+    fields: Arc<FieldSet>,
+}
+
+fn notification_key(msg: &VSomeipMessage) -> Option<CoalesceKey> {
+    match msg {
+        VSomeipMessage::Message(MessageType::Notification { header, .. }) =>
+            Some((header.service_id.id(), header.instance_id.id(), header.method_id.id())),
+        _ => None,
+    }
+}
+
+/// Registration and availability messages are rare and must not get lost, so they bypass the
+/// capacity limit.
+pub(crate) fn is_control(msg: &VSomeipMessage) -> bool {
+    !matches!(msg, VSomeipMessage::Message(_))
+}
+
+/// Completes the trace of a message sampled for tracing when it leaves a receive queue.
+pub(crate) fn stamp_dequeued(msg: &mut VSomeipMessage, traces: &TraceRing) {
+    if let VSomeipMessage::Message(m) = msg {
+        let header = m.header_mut();
+        if let Some(trace) = header.trace.as_mut() {
+            trace.dequeued_ns = trace::now_ns();
+            traces.push(TraceRecord {
+                service_id: header.service_id.id(),
+                instance_id: header.instance_id.id(),
+                method_id: header.method_id.id(),
+                session_id: header.session_id.id(),
+                trace: *trace,
+            });
+        }
+    }
+}
+
+impl BoundedQueue {
+    #[cfg(test)]
+    pub(crate) fn new(capacity: usize, policy: OverflowPolicy) -> Arc<Self> {
+        Self::with_fields(capacity, policy, Arc::default())
+    }
+
+    /// Creates a queue which coalesces the notifications of `fields` with [OverflowPolicy::CoalesceFields].
+    pub(crate) fn with_fields(capacity: usize, policy: OverflowPolicy, fields: Arc<FieldSet>) -> Arc<Self> {
+        assert!(capacity > 0, "queue capacity must not be zero");
+        Arc::new(BoundedQueue {
+            state: Mutex::new(QueueState {
+                items: VecDeque::with_capacity(capacity),
+                head_seq: 0,
+                coalesce: HashMap::new(),
+                sender_alive: true,
+                receiver_alive: true,
+                high_water: 0,
+            }),
+            not_full: Condvar::new(),
+            notify: Notify::new(),
+            capacity,
+            policy,
+            dropped_newest: AtomicU64::new(0),
+            dropped_oldest: AtomicU64::new(0),
+            coalesced: AtomicU64::new(0),
+            blocked: AtomicU64::new(0),
+            latency: Histogram::new(),
+            traces: TraceRing::new(),
+            fields,
+        })
+    }
+
+    /// Returns the key of a field notification, `None` for other messages.
+    fn coalesce_key(&self, msg: &VSomeipMessage) -> Option<CoalesceKey> {
+        notification_key(msg).filter(|key| self.fields.contains(key))
+    }
+
+    fn lock(&self) -> MutexGuard<'_, QueueState> {
+        self.state.lock().unwrap_or_else(|e| e.into_inner())
+    }
+
+    pub(crate) fn push(&self, msg: VSomeipMessage) {
+        let coalesce = match self.policy {
+            OverflowPolicy::CoalesceFields => self.coalesce_key(&msg),
+            _ => None,
+        };
+        let mut state = self.lock();
+        if !state.receiver_alive {
+            return;
+        }
+        if let Some(key) = coalesce {
+            if let Some(&seq) = state.coalesce.get(&key) {
+                let idx = (seq - state.head_seq) as usize;
+                // the replacing value takes over the queue position and age of the replaced one
+                state.items[idx].msg = msg;
+                self.coalesced.fetch_add(1, Ordering::Relaxed);
+                return;
+            }
+        }
+        if state.items.len() >= self.capacity && !is_control(&msg) {
+            match self.policy {
+                OverflowPolicy::Block => {
+                    self.blocked.fetch_add(1, Ordering::Relaxed);
+                    while state.items.len() >= self.capacity && state.receiver_alive {
+                        state = self.not_full.wait(state).unwrap_or_else(|e| e.into_inner());
+                    }
+                    if !state.receiver_alive {
+                        return;
+                    }
+                }
+                OverflowPolicy::DropNewest | OverflowPolicy::CoalesceFields => {
+                    self.dropped_newest.fetch_add(1, Ordering::Relaxed);
+                    return;
+                }
+                OverflowPolicy::DropOldest => {
+                    // control messages are kept, the oldest data message makes room
+                    if let Some(pos) = state.items.iter().position(|q| !is_control(&q.msg)) {
+                        let _ = state.items.remove(pos);
+                        if pos == 0 {
+                            state.head_seq += 1;
+                        }
+                        self.dropped_oldest.fetch_add(1, Ordering::Relaxed);
+                    }
+                }
+            }
+        }
+        if let Some(key) = coalesce {
+            let seq = state.head_seq + state.items.len() as u64;
+            state.coalesce.insert(key, seq);
+        }
+        state.items.push_back(Queued { msg, enqueued: Instant::now() });
+        state.high_water = state.high_water.max(state.items.len());
+        drop(state);
+        self.notify.notify_one();
+    }
+
+    fn pop(&self) -> Option<VSomeipMessage> {
+        let mut state = self.lock();
+        let Queued { mut msg, enqueued } = state.items.pop_front()?;
+        if self.policy == OverflowPolicy::CoalesceFields {
+            // not filtered by `fields`, a field may have been released since it was queued
+            if let Some(key) = notification_key(&msg) {
+                if state.coalesce.get(&key) == Some(&state.head_seq) {
+                    state.coalesce.remove(&key);
+                }
+            }
+        }
+        state.head_seq += 1;
+        drop(state);
+        if self.policy == OverflowPolicy::Block {
+            self.not_full.notify_one();
+        }
+        self.latency.record(enqueued.elapsed());
+        stamp_dequeued(&mut msg, &self.traces);
+        Some(msg)
+    }
+
+    fn is_sender_alive(&self) -> bool {
+        self.lock().sender_alive
+    }
+
+    fn len(&self) -> usize {
+        self.lock().items.len()
+    }
+
+    pub(crate) fn stats(&self) -> ChannelStats {
+        ChannelStats {
+            dropped_newest: self.dropped_newest.load(Ordering::Relaxed),
+            dropped_oldest: self.dropped_oldest.load(Ordering::Relaxed),
+            coalesced: self.coalesced.load(Ordering::Relaxed),
+            blocked: self.blocked.load(Ordering::Relaxed),
+            high_water: self.lock().high_water as u64,
+        }
+    }
+
+    pub(crate) fn latency(&self) -> HistogramSnapshot {
+        self.latency.snapshot()
+    }
+
+    fn close_sender(&self) {
+        self.lock().sender_alive = false;
+        self.notify.notify_one();
+    }
+
+    fn close_receiver(&self) {
+        let mut state = self.lock();
+        state.receiver_alive = false;
+        state.items.clear();
+        state.coalesce.clear();
+        drop(state);
+        self.not_full.notify_all();
+    }
+}
+
+/// The producer side of a bounded queue, owned by the application.
+pub(crate) struct QueueSender(pub(crate) Arc<BoundedQueue>);
+
+impl Drop for QueueSender {
+    fn drop(&mut self) {
+        self.0.close_sender()
+    }
+}
+
+/// Destination of the messages delivered by the vsomeip callbacks.
+pub(crate) enum MessageSink {
+    Unbounded(UnboundedSender<VSomeipMessage>),
+    Bounded(QueueSender),
+    Ring(RingSender),
+}
+
+impl MessageSink {
+    pub(crate) fn send(&self, msg: VSomeipMessage) {
+        match self {
+            // a failed send means the receiver was dropped - there is nobody to deliver to
+            MessageSink::Unbounded(sender) => { let _ = sender.send(msg); }
+            MessageSink::Bounded(sender) => sender.0.push(msg),
+            MessageSink::Ring(sender) => sender.0.push(msg),
+        }
+    }
+
+    pub(crate) fn stats(&self) -> ChannelStats {
+        match self {
+            MessageSink::Unbounded(_) => ChannelStats::default(),
+            MessageSink::Bounded(sender) => sender.0.stats(),
+            MessageSink::Ring(sender) => sender.0.stats(),
+        }
+    }
+
+    /// Returns the time messages spent in the queue, empty for unbounded channels and rings.
+    pub(crate) fn latency(&self) -> HistogramSnapshot {
+        match self {
+            MessageSink::Unbounded(_) | MessageSink::Ring(_) => HistogramSnapshot::default(),
+            MessageSink::Bounded(sender) => sender.0.latency(),
+        }
+    }
+}
+
+/// The queue behind a [VSomeipReceiver].
+enum ReceiveQueue {
+    Locked(Arc<BoundedQueue>),
+    Ring(Arc<SpscRing>),
+}
+
+/// Receiver of [VSomeipMessage]s with a bounded queue, see [crate::VSomeipApplication::create_with_options()].
+pub struct VSomeipReceiver {
+    queue: ReceiveQueue,
+}
+
+impl Drop for VSomeipReceiver {
+    fn drop(&mut self) {
+        match &self.queue {
+            ReceiveQueue::Locked(queue) => queue.close_receiver(),
+            ReceiveQueue::Ring(ring) => ring.close_receiver(),
+        }
+    }
+}
+
+impl VSomeipReceiver {
+    pub(crate) fn new(queue: Arc<BoundedQueue>) -> Self {
+        VSomeipReceiver { queue: ReceiveQueue::Locked(queue) }
+    }
+
+    pub(crate) fn with_ring(ring: Arc<SpscRing>) -> Self {
+        VSomeipReceiver { queue: ReceiveQueue::Ring(ring) }
+    }
+
+    fn pop(&self) -> Option<VSomeipMessage> {
+        match &self.queue {
+            ReceiveQueue::Locked(queue) => queue.pop(),
+            ReceiveQueue::Ring(ring) => ring.pop(),
+        }
+    }
+
+    fn is_sender_alive(&self) -> bool {
+        match &self.queue {
+            ReceiveQueue::Locked(queue) => queue.is_sender_alive(),
+            ReceiveQueue::Ring(ring) => ring.is_sender_alive(),
+        }
+    }
+
+    fn traces_ring(&self) -> &TraceRing {
+        match &self.queue {
+            ReceiveQueue::Locked(queue) => &queue.traces,
+            ReceiveQueue::Ring(ring) => &ring.traces,
+        }
+    }
+
+    /// Receives the next message.
+    /// Returns `None` when the application has been dropped and all queued messages are consumed.
+    pub async fn recv(&mut self) -> Option<VSomeipMessage> {
+        loop {
+            if let Some(msg) = self.pop() {
+                return Some(msg);
+            }
+            if !self.is_sender_alive() {
+                // a message may have been pushed between the pop and the check
+                return self.pop();
+            }
+            let notify = match &self.queue {
+                ReceiveQueue::Locked(queue) => &queue.notify,
+                ReceiveQueue::Ring(ring) => &ring.notify,
+            };
+            notify.notified().await;
+        }
+    }
+
+    /// Returns the next queued message without waiting.
+    pub fn try_recv(&mut self) -> Option<VSomeipMessage> {
+        self.pop()
+    }
+
+    /// Returns the number of messages currently queued.
+    pub fn len(&self) -> usize {
+        match &self.queue {
+            ReceiveQueue::Locked(queue) => queue.len(),
+            ReceiveQueue::Ring(ring) => ring.len(),
+        }
+    }
+
+    /// Returns whether no message is queued.
+    pub fn is_empty(&self) -> bool {
+        self.len() == 0
+    }
+
+    /// Returns the drop and coalesce counters of the queue.
+    pub fn stats(&self) -> ChannelStats {
+        match &self.queue {
+            ReceiveQueue::Locked(queue) => queue.stats(),
+            ReceiveQueue::Ring(ring) => ring.stats(),
+        }
+    }
+
+    /// Returns the last (up to 1024) received messages sampled for tracing, oldest first.
+    pub fn traces(&self) -> Vec<TraceRecord> {
+        self.traces_ring().records()
+    }
+
+    /// Writes the trace records in their binary form ([TraceRecord::to_bytes()]) to `out` and
+    /// removes them. Returns the number of records written.
+    pub fn dump_traces(&self, out: &mut dyn Write) -> io::Result<usize> {
+        self.traces_ring().dump(out)
+    }
+
+    /// Waits until a `RegistrationState(true)` message is received or a timeout occurs.
+    pub async fn wait_registered_for(&mut self, timeout_time: Duration) -> bool {
+        timeout(timeout_time, async {
+            loop {
+                match self.recv().await {
+                    Some(VSomeipMessage::RegistrationState(true)) => break,
+                    _ => {}
+                }
+            }
+        }).await.is_ok()
+    }
+}
+
+#[cfg(test)]
+pub(crate) mod test {
+    use super::*;
+    use crate::{InstanceID, InterfaceVersion, MessageHeader, MethodID, ServiceID, SessionID, ClientID, VSomeipPayload};
+
+    pub(crate) fn notification(method: u16, session: u16) -> VSomeipMessage {
+        VSomeipMessage::Message(MessageType::Notification {
+            header: MessageHeader {
+                service_id: ServiceID(0x1234),
+                instance_id: InstanceID(1),
+                method_id: MethodID(method),
+                client_id: ClientID(0),
+                session_id: SessionID(session),
+                interface_version: InterfaceVersion::make_major(1),
+                reliable: false,
+                trace: None,
+            },
+            is_initial: false,
+            data: VSomeipPayload::from(std::ptr::null_mut()),
+        })
+    }
+
+    pub(crate) fn session_of(msg: Option<VSomeipMessage>) -> (u16, u16) {
+        match msg {
+            Some(VSomeipMessage::Message(MessageType::Notification { header, .. })) =>
+                (header.method_id.id(), header.session_id.id()),
+            other => panic!("unexpected {:?}", other),
+        }
+    }
+
+    #[test]
+    fn drop_newest_test() {
+        let q = BoundedQueue::new(2, OverflowPolicy::DropNewest);
+        q.push(notification(1, 1));
+        q.push(notification(1, 2));
+        q.push(notification(1, 3));
+        assert_eq!(q.len(), 2);
+        assert_eq!(session_of(q.pop()), (1, 1));
+        assert_eq!(session_of(q.pop()), (1, 2));
+        assert_eq!(q.stats().dropped_newest, 1);
+    }
+
+    #[test]
+    fn drop_oldest_test() {
+        let q = BoundedQueue::new(2, OverflowPolicy::DropOldest);
+        q.push(VSomeipMessage::RegistrationState(true));
+        q.push(notification(1, 1));
+        q.push(notification(1, 2));
+        q.push(notification(1, 3));
+        assert!(matches!(q.pop(), Some(VSomeipMessage::RegistrationState(true))));
+        assert_eq!(session_of(q.pop()), (1, 3));
+        assert!(q.pop().is_none());
+        assert_eq!(q.stats().dropped_oldest, 2);
+    }
+
+    #[test]
+    fn coalesce_test() {
+        let fields = Arc::new(FieldSet::default());
+        fields.insert(0x1234, 1, 1);
+        fields.insert(0x1234, 1, 3);
+        let q = BoundedQueue::with_fields(2, OverflowPolicy::CoalesceFields, fields);
+        q.push(notification(1, 1));
+        q.push(notification(2, 1));
+        q.push(notification(1, 2));
+        q.push(notification(1, 3));
+        q.push(notification(3, 1));
+        assert_eq!(session_of(q.pop()), (1, 3));
+        q.push(notification(1, 4));
+        assert_eq!(session_of(q.pop()), (2, 1));
+        assert_eq!(session_of(q.pop()), (1, 4));
+        assert!(q.pop().is_none());
+        let stats = q.stats();
+        assert_eq!(stats.coalesced, 2);
+        assert_eq!(stats.dropped_newest, 1);
+    }
+
+    #[test]
+    fn coalesce_events_test() {
+        let fields = Arc::new(FieldSet::default());
+        fields.insert(0x1234, 1, 1);
+        let q = BoundedQueue::with_fields(3, OverflowPolicy::CoalesceFields, fields.clone());
+        // notifications of plain events are all kept
+        q.push(notification(2, 1));
+        q.push(notification(2, 2));
+        q.push(notification(1, 1));
+        q.push(notification(1, 2));
+        assert_eq!(session_of(q.pop()), (2, 1));
+        // a field released while queued is not coalesced anymore
+        fields.remove(0x1234, 1, 1);
+        q.push(notification(1, 3));
+        assert_eq!(session_of(q.pop()), (2, 2));
+        assert_eq!(session_of(q.pop()), (1, 2));
+        assert_eq!(session_of(q.pop()), (1, 3));
+        assert!(q.pop().is_none());
+        assert_eq!(q.stats().coalesced, 1);
+    }
+
+    #[test]
+    fn block_test() {
+        let q = BoundedQueue::new(1, OverflowPolicy::Block);
+        q.push(notification(1, 1));
+        let producer = {
+            let q = q.clone();
+            std::thread::spawn(move || q.push(notification(1, 2)))
+        };
+        while q.stats().blocked == 0 {
+            std::thread::yield_now();
+        }
+        assert_eq!(session_of(q.pop()), (1, 1));
+        producer.join().unwrap();
+        assert_eq!(session_of(q.pop()), (1, 2));
+    }
+
+    #[tokio::test]
+    async fn receiver_closed_test() {
+        let q = BoundedQueue::new(4, OverflowPolicy::Block);
+        let sender = QueueSender(q.clone());
+        let mut recv = VSomeipReceiver::new(q);
+        sender.0.push(notification(1, 1));
+        drop(sender);
+        assert_eq!(session_of(recv.recv().await), (1, 1));
+        assert!(recv.recv().await.is_none());
+    }
+}
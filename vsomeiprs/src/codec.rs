@@ -0,0 +1,589 @@
+// SPDX-License-Identifier: MPL-2.0
+//
+// Copyright (C) 2024 Alexander Seifarth
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+//! SOME/IP serialization of payloads.
+//!
+//! Scalars are big endian, strings are UTF-8 with BOM and terminating zero, dynamic arrays and
+//! strings have a 32 bit length field, unions a 32 bit length and a 32 bit type field.
+//! Structs and unions are declared with [crate::someip_struct!] and [crate::someip_union!]:
+//! ```
+//! vsomeiprs::someip_struct! {
+//!     #[derive(Debug, PartialEq)]
+//!     pub struct Position<'a> {
+//!         pub x: i32,
+//!         pub y: i32,
+//!         pub label: &'a str,
+//!     }
+//! }
+//! let data = vsomeiprs::codec::encode(&Position { x: 1, y: -2, label: "home" });
+//! let position: Position = vsomeiprs::codec::decode(&data).unwrap();
+//! assert_eq!(position.label, "home");
+//! ```
+//! Decoding borrows strings and byte arrays from the received buffer instead of copying them.
+//! The size of types without dynamic parts is known at compile time ([SomeIpSerialize::FIXED_SIZE]),
+//! so encoding reserves the buffer once.
+
+use std::fmt;
+use std::mem::MaybeUninit;
+use bytes::{Bytes, BytesMut};
+pub use bytes::BufMut;
+
+const BOM: [u8; 3] = [0xef, 0xbb, 0xbf];
+
+/// Errors of decoding a SOME/IP payload.
+#[derive(Debug, Clone, Copy, Eq, PartialEq)]
+pub enum DecodeError {
+    /// The payload ends before the value.
+    Truncated,
+    /// A bool is neither 0 nor 1.
+    InvalidBool(u8),
+    /// A string lacks the BOM or the terminating zero or is no valid UTF-8.
+    InvalidString,
+    /// A union has a type not defined for it.
+    UnknownVariant(u32),
+    /// A dynamic length array has elements without serialized bytes, their number is unknown.
+    EmptyElement,
+}
+
+impl fmt::Display for DecodeError {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        match self {
+            DecodeError::Truncated => write!(f, "payload truncated"),
+            DecodeError::InvalidBool(v) => write!(f, "invalid bool value {}", v),
+            DecodeError::InvalidString => write!(f, "invalid string"),
+            DecodeError::UnknownVariant(t) => write!(f, "unknown union type {}", t),
+            DecodeError::EmptyElement => write!(f, "array element without serialized bytes"),
+        }
+    }
+}
+
+impl std::error::Error for DecodeError {}
+
+/// Types with a SOME/IP serialization.
+pub trait SomeIpSerialize {
+    /// Size of the serialized value if it is the same for all values.
+    const FIXED_SIZE: Option<usize> = None;
+
+    /// Returns the size of the serialized value.
+    fn serialized_size(&self) -> usize;
+
+    /// Appends the serialized value to `out`.
+    fn serialize<B: BufMut>(&self, out: &mut B);
+}
+
+/// Types that can be decoded from a SOME/IP payload, possibly borrowing from it.
+pub trait SomeIpDeserialize<'de>: Sized {
+    /// Decodes a value from the start of `input` and advances `input` behind it.
+    fn deserialize(input: &mut &'de [u8]) -> Result<Self, DecodeError>;
+}
+
+/// Returns the serialized `value`.
+pub fn encode<T: SomeIpSerialize + ?Sized>(value: &T) -> Bytes {
+    encode_into(value, &mut BytesMut::new())
+}
+
+/// Serializes `value` into `buffer` and returns it as `Bytes`, e.g. for
+/// [crate::VSomeipApplication::notify_owned()]. Reusing `buffer` for successive values reuses its
+/// memory once the previously returned `Bytes` have been released.
+pub fn encode_into<T: SomeIpSerialize + ?Sized>(value: &T, buffer: &mut BytesMut) -> Bytes {
+    buffer.clear();
+    buffer.reserve(value.serialized_size());
+    value.serialize(buffer);
+    buffer.split().freeze()
+}
+
+/// Decodes a value from the start of `data`. Trailing data is ignored, as SOME/IP allows newer
+/// interface versions to extend a payload.
+pub fn decode<'de, T: SomeIpDeserialize<'de>>(data: &'de [u8]) -> Result<T, DecodeError> {
+    let mut input = data;
+    T::deserialize(&mut input)
+}
+
+#[doc(hidden)]
+pub const fn fixed_sum(a: Option<usize>, b: Option<usize>) -> Option<usize> {
+    match (a, b) {
+        (Some(a), Some(b)) => Some(a + b),
+        _ => None,
+    }
+}
+
+#[doc(hidden)]
+pub fn take<'de>(input: &mut &'de [u8], len: usize) -> Result<&'de [u8], DecodeError> {
+    if input.len() < len {
+        return Err(DecodeError::Truncated);
+    }
+    let (head, rest) = input.split_at(len);
+    *input = rest;
+    Ok(head)
+}
+
+/// Returns the data of a value with a 32 bit length field.
+#[doc(hidden)]
+pub fn take_dynamic<'de>(input: &mut &'de [u8]) -> Result<&'de [u8], DecodeError> {
+    let len = u32::deserialize(input)?;
+    take(input, len as usize)
+}
+
+macro_rules! scalar {
+    ($($t:ty),*) => {
+        $(
+            impl SomeIpSerialize for $t {
+                const FIXED_SIZE: Option<usize> = Some(std::mem::size_of::<$t>());
+
+                fn serialized_size(&self) -> usize {
+                    std::mem::size_of::<$t>()
+                }
+
+                fn serialize<B: BufMut>(&self, out: &mut B) {
+                    out.put_slice(&self.to_be_bytes())
+                }
+            }
+
+            impl<'de> SomeIpDeserialize<'de> for $t {
+                fn deserialize(input: &mut &'de [u8]) -> Result<Self, DecodeError> {
+                    let data = take(input, std::mem::size_of::<$t>())?;
+                    Ok(<$t>::from_be_bytes(data.try_into().unwrap()))
+                }
+            }
+        )*
+    };
+}
+
+scalar!(u8, u16, u32, u64, i8, i16, i32, i64, f32, f64);
+
+impl SomeIpSerialize for bool {
+    const FIXED_SIZE: Option<usize> = Some(1);
+
+    fn serialized_size(&self) -> usize {
+        1
+    }
+
+    fn serialize<B: BufMut>(&self, out: &mut B) {
+        out.put_u8(*self as u8)
+    }
+}
+
+impl<'de> SomeIpDeserialize<'de> for bool {
+    fn deserialize(input: &mut &'de [u8]) -> Result<Self, DecodeError> {
+        match u8::deserialize(input)? {
+            0 => Ok(false),
+            1 => Ok(true),
+            v => Err(DecodeError::InvalidBool(v)),
+        }
+    }
+}
+
+impl SomeIpSerialize for str {
+    fn serialized_size(&self) -> usize {
+        4 + BOM.len() + self.len() + 1
+    }
+
+    fn serialize<B: BufMut>(&self, out: &mut B) {
+        out.put_u32((BOM.len() + self.len() + 1) as u32);
+        out.put_slice(&BOM);
+        out.put_slice(self.as_bytes());
+        out.put_u8(0);
+    }
+}
+
+impl<'de> SomeIpDeserialize<'de> for &'de str {
+    fn deserialize(input: &mut &'de [u8]) -> Result<Self, DecodeError> {
+        let data = take_dynamic(input)?;
+        let text = data.strip_prefix(&BOM).and_then(|d| d.strip_suffix(&[0])).ok_or(DecodeError::InvalidString)?;
+        std::str::from_utf8(text).map_err(|_| DecodeError::InvalidString)
+    }
+}
+
+impl<'a> SomeIpSerialize for &'a str {
+    fn serialized_size(&self) -> usize {
+        (**self).serialized_size()
+    }
+
+    fn serialize<B: BufMut>(&self, out: &mut B) {
+        (**self).serialize(out)
+    }
+}
+
+impl SomeIpSerialize for String {
+    fn serialized_size(&self) -> usize {
+        self.as_str().serialized_size()
+    }
+
+    fn serialize<B: BufMut>(&self, out: &mut B) {
+        self.as_str().serialize(out)
+    }
+}
+
+impl<'de> SomeIpDeserialize<'de> for String {
+    fn deserialize(input: &mut &'de [u8]) -> Result<Self, DecodeError> {
+        <&str>::deserialize(input).map(str::to_string)
+    }
+}
+
+/// Dynamic length byte array, decoded without copying.
+impl<'a> SomeIpSerialize for &'a [u8] {
+    fn serialized_size(&self) -> usize {
+        4 + self.len()
+    }
+
+    fn serialize<B: BufMut>(&self, out: &mut B) {
+        out.put_u32(self.len() as u32);
+        out.put_slice(self);
+    }
+}
+
+impl<'de> SomeIpDeserialize<'de> for &'de [u8] {
+    fn deserialize(input: &mut &'de [u8]) -> Result<Self, DecodeError> {
+        take_dynamic(input)
+    }
+}
+
+/// Dynamic length array.
+impl<T: SomeIpSerialize> SomeIpSerialize for Vec<T> {
+    fn serialized_size(&self) -> usize {
+        4 + match T::FIXED_SIZE {
+            Some(size) => size * self.len(),
+            None => self.iter().map(T::serialized_size).sum(),
+        }
+    }
+
+    fn serialize<B: BufMut>(&self, out: &mut B) {
+        out.put_u32((self.serialized_size() - 4) as u32);
+        for element in self {
+            element.serialize(out);
+        }
+    }
+}
+
+impl<'de, T: SomeIpDeserialize<'de> + SomeIpSerialize> SomeIpDeserialize<'de> for Vec<T> {
+    fn deserialize(input: &mut &'de [u8]) -> Result<Self, DecodeError> {
+        let mut data = take_dynamic(input)?;
+        let mut elements = Vec::with_capacity(T::FIXED_SIZE.map_or(0, |size| data.len() / size.max(1)));
+        while !data.is_empty() {
+            let remaining = data.len();
+            elements.push(T::deserialize(&mut data)?);
+            // an element consuming nothing would be decoded forever
+            if data.len() == remaining {
+                return Err(DecodeError::EmptyElement);
+            }
+        }
+        Ok(elements)
+    }
+}
+
+/// Fixed length array (without length field).
+impl<T: SomeIpSerialize, const N: usize> SomeIpSerialize for [T; N] {
+    const FIXED_SIZE: Option<usize> = match T::FIXED_SIZE {
+        Some(size) => Some(size * N),
+        None => None,
+    };
+
+    fn serialized_size(&self) -> usize {
+        match Self::FIXED_SIZE {
+            Some(size) => size,
+            None => self.iter().map(T::serialized_size).sum(),
+        }
+    }
+
+    fn serialize<B: BufMut>(&self, out: &mut B) {
+        for element in self {
+            element.serialize(out);
+        }
+    }
+}
+
+impl<'de, T: SomeIpDeserialize<'de>, const N: usize> SomeIpDeserialize<'de> for [T; N] {
+    fn deserialize(input: &mut &'de [u8]) -> Result<Self, DecodeError> {
+        /// The array being decoded, drops the elements decoded so far if an element fails.
+        struct Partial<T, const N: usize> {
+            elements: [MaybeUninit<T>; N],
+            len: usize,
+        }
+
+        impl<T, const N: usize> Drop for Partial<T, N> {
+            fn drop(&mut self) {
+                for element in &mut self.elements[..self.len] {
+                    unsafe { element.assume_init_drop() }
+                }
+            }
+        }
+
+        let mut partial = Partial::<T, N> { elements: [const { MaybeUninit::uninit() }; N], len: 0 };
+        while partial.len < N {
+            partial.elements[partial.len].write(T::deserialize(input)?);
+            partial.len += 1;
+        }
+        partial.len = 0;
+        // all elements are initialized, `partial` drops none of them
+        Ok(unsafe { std::ptr::read(&partial.elements as *const [MaybeUninit<T>; N] as *const [T; N]) })
+    }
+}
+
+/// Fixed length byte array, decoded without copying.
+impl<'a, const N: usize> SomeIpSerialize for &'a [u8; N] {
+    const FIXED_SIZE: Option<usize> = Some(N);
+
+    fn serialized_size(&self) -> usize {
+        N
+    }
+
+    fn serialize<B: BufMut>(&self, out: &mut B) {
+        out.put_slice(*self);
+    }
+}
+
+impl<'de, const N: usize> SomeIpDeserialize<'de> for &'de [u8; N] {
+    fn deserialize(input: &mut &'de [u8]) -> Result<Self, DecodeError> {
+        Ok(take(input, N)?.try_into().expect("take returns N bytes"))
+    }
+}
+
+/// Declares a struct with a SOME/IP serialization of its fields in declaration order.
+/// The struct may have one lifetime parameter for fields borrowed from the payload (`&'a str`,
+/// `&'a [u8]`, `&'a [u8; N]`).
+#[macro_export]
+macro_rules! someip_struct {
+    ($(#[$meta:meta])* $vis:vis struct $name:ident <$lt:lifetime> {
+        $($(#[$fmeta:meta])* $fvis:vis $field:ident : $ty:ty),* $(,)?
+    }) => {
+        $(#[$meta])* $vis struct $name<$lt> { $($(#[$fmeta])* $fvis $field: $ty),* }
+
+        impl<$lt> $crate::codec::SomeIpSerialize for $name<$lt> {
+            $crate::__someip_struct_serialize!($($field: $ty),*);
+        }
+
+        impl<$lt> $crate::codec::SomeIpDeserialize<$lt> for $name<$lt> {
+            fn deserialize(input: &mut &$lt [u8]) -> Result<Self, $crate::codec::DecodeError> {
+                Ok($name { $($field: <$ty as $crate::codec::SomeIpDeserialize<$lt>>::deserialize(input)?),* })
+            }
+        }
+    };
+
+    ($(#[$meta:meta])* $vis:vis struct $name:ident {
+        $($(#[$fmeta:meta])* $fvis:vis $field:ident : $ty:ty),* $(,)?
+    }) => {
+        $(#[$meta])* $vis struct $name { $($(#[$fmeta])* $fvis $field: $ty),* }
+
+        impl $crate::codec::SomeIpSerialize for $name {
+            $crate::__someip_struct_serialize!($($field: $ty),*);
+        }
+
+        impl<'de> $crate::codec::SomeIpDeserialize<'de> for $name {
+            fn deserialize(input: &mut &'de [u8]) -> Result<Self, $crate::codec::DecodeError> {
+                Ok($name { $($field: <$ty as $crate::codec::SomeIpDeserialize<'de>>::deserialize(input)?),* })
+            }
+        }
+    };
+}
+
+#[doc(hidden)]
+#[macro_export]
+macro_rules! __someip_struct_serialize {
+    ($($field:ident : $ty:ty),*) => {
+        const FIXED_SIZE: Option<usize> = {
+            let size = Some(0usize);
+            $(let size = $crate::codec::fixed_sum(size, <$ty as $crate::codec::SomeIpSerialize>::FIXED_SIZE);)*
+            size
+        };
+
+        fn serialized_size(&self) -> usize {
+            match <Self as $crate::codec::SomeIpSerialize>::FIXED_SIZE {
+                Some(size) => size,
+                None => 0 $(+ $crate::codec::SomeIpSerialize::serialized_size(&self.$field))*,
+            }
+        }
+
+        fn serialize<B: $crate::codec::BufMut>(&self, out: &mut B) {
+            $($crate::codec::SomeIpSerialize::serialize(&self.$field, out);)*
+        }
+    };
+}
+
+/// Declares an enum serialized as SOME/IP union: 32 bit length, 32 bit type and the value of
+/// the variant. Each variant holds one value and is given its type number:
+/// ```
+/// vsomeiprs::someip_union! {
+///     #[derive(Debug, PartialEq)]
+///     pub enum Setting {
+///         1 => Level(u8),
+///         2 => Name(String),
+///     }
+/// }
+/// ```
+#[macro_export]
+macro_rules! someip_union {
+    ($(#[$meta:meta])* $vis:vis enum $name:ident <$lt:lifetime> {
+        $($(#[$vmeta:meta])* $sel:literal => $variant:ident ($ty:ty)),* $(,)?
+    }) => {
+        $(#[$meta])* $vis enum $name<$lt> { $($(#[$vmeta])* $variant($ty)),* }
+
+        impl<$lt> $crate::codec::SomeIpSerialize for $name<$lt> {
+            $crate::__someip_union_serialize!($name, $($sel => $variant),*);
+        }
+
+        impl<$lt> $crate::codec::SomeIpDeserialize<$lt> for $name<$lt> {
+            $crate::__someip_union_deserialize!($lt, $name, $($sel => $variant($ty)),*);
+        }
+    };
+
+    ($(#[$meta:meta])* $vis:vis enum $name:ident {
+        $($(#[$vmeta:meta])* $sel:literal => $variant:ident ($ty:ty)),* $(,)?
+    }) => {
+        $(#[$meta])* $vis enum $name { $($(#[$vmeta])* $variant($ty)),* }
+
+        impl $crate::codec::SomeIpSerialize for $name {
+            $crate::__someip_union_serialize!($name, $($sel => $variant),*);
+        }
+
+        impl<'de> $crate::codec::SomeIpDeserialize<'de> for $name {
+            $crate::__someip_union_deserialize!('de, $name, $($sel => $variant($ty)),*);
+        }
+    };
+}
+
+#[doc(hidden)]
+#[macro_export]
+macro_rules! __someip_union_serialize {
+    ($name:ident, $($sel:literal => $variant:ident),*) => {
+        fn serialized_size(&self) -> usize {
+            8 + match self {
+                $($name::$variant(value) => $crate::codec::SomeIpSerialize::serialized_size(value),)*
+            }
+        }
+
+        fn serialize<B: $crate::codec::BufMut>(&self, out: &mut B) {
+            out.put_u32((self.serialized_size() - 8) as u32);
+            match self {
+                $($name::$variant(value) => {
+                    out.put_u32($sel);
+                    $crate::codec::SomeIpSerialize::serialize(value, out);
+                })*
+            }
+        }
+    };
+}
+
+#[doc(hidden)]
+#[macro_export]
+macro_rules! __someip_union_deserialize {
+    ($lt:lifetime, $name:ident, $($sel:literal => $variant:ident ($ty:ty)),*) => {
+        fn deserialize(input: &mut &$lt [u8]) -> Result<Self, $crate::codec::DecodeError> {
+            let len = <u32 as $crate::codec::SomeIpDeserialize>::deserialize(input)?;
+            let selector = <u32 as $crate::codec::SomeIpDeserialize>::deserialize(input)?;
+            // the value may be followed by padding up to the length
+            let mut data = $crate::codec::take(input, len as usize)?;
+            match selector {
+                $($sel => Ok($name::$variant(<$ty as $crate::codec::SomeIpDeserialize<$lt>>::deserialize(&mut data)?)),)*
+                other => Err($crate::codec::DecodeError::UnknownVariant(other)),
+            }
+        }
+    };
+}
+
+#[cfg(test)]
+mod test {
+    use super::*;
+
+    crate::someip_struct! {
+        #[derive(Debug, Clone, PartialEq)]
+        struct Fixed {
+            a: u8,
+            b: u16,
+            c: [i32; 2],
+            d: bool,
+            e: f64,
+        }
+    }
+
+    crate::someip_struct! {
+        #[derive(Debug, Clone, PartialEq)]
+        struct Borrowed<'a> {
+            id: u32,
+            name: &'a str,
+            raw: &'a [u8],
+            fixed: Vec<Fixed>,
+        }
+    }
+
+    crate::someip_union! {
+        #[derive(Debug, Clone, PartialEq)]
+        enum Value {
+            1 => Number(u32),
+            2 => Text(String),
+        }
+    }
+
+    #[test]
+    fn fixed_test() {
+        assert_eq!(Fixed::FIXED_SIZE, Some(1 + 2 + 8 + 1 + 8));
+        let value = Fixed { a: 1, b: 0x0203, c: [4, -1], d: true, e: 0.5 };
+        let data = encode(&value);
+        assert_eq!(&data[..11], &[1, 2, 3, 0, 0, 0, 4, 0xff, 0xff, 0xff, 0xff]);
+        assert_eq!(decode::<Fixed>(&data).unwrap(), value);
+        assert_eq!(decode::<Fixed>(&data[..data.len() - 1]).unwrap_err(), DecodeError::Truncated);
+    }
+
+    #[test]
+    fn dynamic_test() {
+        assert_eq!(Borrowed::FIXED_SIZE, None);
+        let raw = [9u8, 8, 7];
+        let value = Borrowed { id: 7, name: "abc", raw: &raw, fixed: vec![
+            Fixed { a: 1, b: 2, c: [3, 4], d: false, e: 1.0 },
+            Fixed { a: 5, b: 6, c: [7, 8], d: true, e: 2.0 }] };
+        let data = encode(&value);
+        assert_eq!(data.len(), value.serialized_size());
+        assert_eq!(&data[4..15], &[0, 0, 0, 7, 0xef, 0xbb, 0xbf, b'a', b'b', b'c', 0]);
+        let decoded: Borrowed = decode(&data).unwrap();
+        assert_eq!(decoded, value);
+        // borrowed fields point into the payload
+        assert!(data.as_ptr_range().contains(&decoded.name.as_ptr()));
+    }
+
+    #[test]
+    fn string_test() {
+        let mut data = encode("x").to_vec();
+        assert_eq!(decode::<String>(&data).unwrap(), "x");
+        data[4] = 0;
+        assert_eq!(decode::<&str>(&data).unwrap_err(), DecodeError::InvalidString);
+    }
+
+    #[test]
+    fn union_test() {
+        let mut buffer = BytesMut::new();
+        let data = encode_into(&Value::Number(5), &mut buffer);
+        assert_eq!(&data[..], &[0, 0, 0, 4, 0, 0, 0, 1, 0, 0, 0, 5]);
+        assert_eq!(decode::<Value>(&data).unwrap(), Value::Number(5));
+        let data = encode_into(&Value::Text("hi".to_string()), &mut buffer);
+        assert_eq!(decode::<Value>(&data).unwrap(), Value::Text("hi".to_string()));
+        let unknown = [0u8, 0, 0, 0, 0, 0, 0, 3];
+        assert_eq!(decode::<Value>(&unknown).unwrap_err(), DecodeError::UnknownVariant(3));
+    }
+
+    #[test]
+    fn array_test() {
+        let data = [0u8, 1, 0, 2, 0, 3, 9, 8, 7];
+        assert_eq!(decode::<[u16; 3]>(&data[..6]).unwrap(), [1, 2, 3]);
+        assert_eq!(decode::<[u16; 3]>(&data[..5]).unwrap_err(), DecodeError::Truncated);
+        let mut input = &data[..];
+        let raw = <&[u8; 4]>::deserialize(&mut input).unwrap();
+        assert_eq!(raw, &[0, 1, 0, 2]);
+        // fixed byte arrays point into the payload
+        assert_eq!(raw.as_ptr(), data.as_ptr());
+        assert_eq!(encode(&raw)[..], [0, 1, 0, 2]);
+        // elements decoded before a failing one are dropped
+        let texts = encode(&["a".to_string(), "b".to_string()]);
+        assert_eq!(decode::<[String; 3]>(&texts).unwrap_err(), DecodeError::Truncated);
+    }
+
+    #[test]
+    fn empty_element_test() {
+        let empty = [0u8, 0, 0, 0];
+        assert_eq!(decode::<Vec<[u8; 0]>>(&empty).unwrap(), Vec::<[u8; 0]>::new());
+        let data = [0u8, 0, 0, 1, 7];
+        assert_eq!(decode::<Vec<[u8; 0]>>(&data).unwrap_err(), DecodeError::EmptyElement);
+    }
+}
@@ -0,0 +1,194 @@
+// SPDX-License-Identifier: MPL-2.0
+//
+// Copyright (C) 2024 Alexander Seifarth
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+use std::collections::BTreeMap;
+use std::fmt::Write;
+use std::net::IpAddr;
+
+/// Transport settings of vsomeip: socket buffers, endpoint queues and payload size limits.
+///
+/// vsomeip reads these from its JSON configuration only. The settings are written as an additional
+/// configuration file next to a copy of the base configuration before the application is
+/// initialized, see [crate::ApplicationOptions::transport]. They apply to the endpoints of all
+/// applications of the routing manager configured this way, so they are typically set by the
+/// application hosting the routing manager.
+///
+/// ```
+/// use vsomeiprs::TransportConfig;
+/// let transport = TransportConfig::new()
+///     .udp_receive_buffer_size(4 << 20)
+///     .max_payload_size_unreliable(1400)
+///     .endpoint_queue_limit("10.0.0.1".parse().unwrap(), 30509, 1 << 20);
+/// assert!(transport.to_json().contains("\"udp-receive-buffer-size\": \"4194304\""));
+/// ```
+#[derive(Debug, Clone, Default, Eq, PartialEq)]
+pub struct TransportConfig {
+    udp_receive_buffer_size: Option<u32>,
+    max_payload_size_local: Option<u32>,
+    max_payload_size_reliable: Option<u32>,
+    max_payload_size_unreliable: Option<u32>,
+    buffer_shrink_threshold: Option<u32>,
+    endpoint_queue_limit_external: Option<u32>,
+    endpoint_queue_limit_local: Option<u32>,
+    endpoint_queue_limits: Vec<(IpAddr, u16, u32)>,
+    payload_sizes: Vec<(IpAddr, u16, u32)>,
+}
+
+impl TransportConfig {
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    /// Receive buffer size (SO_RCVBUF) of the UDP sockets in bytes.
+    pub fn udp_receive_buffer_size(mut self, bytes: u32) -> Self {
+        self.udp_receive_buffer_size = Some(bytes);
+        self
+    }
+
+    /// Largest payload of messages exchanged with local applications.
+    pub fn max_payload_size_local(mut self, bytes: u32) -> Self {
+        self.max_payload_size_local = Some(bytes);
+        self
+    }
+
+    /// Largest payload of messages sent or received via TCP.
+    pub fn max_payload_size_reliable(mut self, bytes: u32) -> Self {
+        self.max_payload_size_reliable = Some(bytes);
+        self
+    }
+
+    /// Largest payload of messages sent or received via UDP.
+    pub fn max_payload_size_unreliable(mut self, bytes: u32) -> Self {
+        self.max_payload_size_unreliable = Some(bytes);
+        self
+    }
+
+    /// Number of messages smaller than half of a TCP receive buffer after which the buffer
+    /// is shrunk, 0 disables shrinking.
+    pub fn buffer_shrink_threshold(mut self, messages: u32) -> Self {
+        self.buffer_shrink_threshold = Some(messages);
+        self
+    }
+
+    /// Default limit in bytes of the send queue of an endpoint to another ECU.
+    pub fn endpoint_queue_limit_external(mut self, bytes: u32) -> Self {
+        self.endpoint_queue_limit_external = Some(bytes);
+        self
+    }
+
+    /// Limit in bytes of the send queue of an endpoint to a local application.
+    pub fn endpoint_queue_limit_local(mut self, bytes: u32) -> Self {
+        self.endpoint_queue_limit_local = Some(bytes);
+        self
+    }
+
+    /// Limit in bytes of the send queue of the endpoint `unicast`:`port`.
+    pub fn endpoint_queue_limit(mut self, unicast: IpAddr, port: u16, bytes: u32) -> Self {
+        self.endpoint_queue_limits.push((unicast, port, bytes));
+        self
+    }
+
+    /// Largest payload of messages via the TCP endpoint `unicast`:`port`.
+    pub fn max_payload_size(mut self, unicast: IpAddr, port: u16, bytes: u32) -> Self {
+        self.payload_sizes.push((unicast, port, bytes));
+        self
+    }
+
+    /// Returns the settings as vsomeip JSON configuration.
+    pub fn to_json(&self) -> String {
+        let mut out = String::from("{");
+        let mut first = true;
+        let mut key = |out: &mut String, name: &str| {
+            out.push_str(if first { "\n" } else { ",\n" });
+            first = false;
+            let _ = write!(out, "  \"{}\": ", name);
+        };
+        let scalars = [
+            ("udp-receive-buffer-size", self.udp_receive_buffer_size),
+            ("max-payload-size-local", self.max_payload_size_local),
+            ("max-payload-size-reliable", self.max_payload_size_reliable),
+            ("max-payload-size-unreliable", self.max_payload_size_unreliable),
+            ("buffer-shrink-threshold", self.buffer_shrink_threshold),
+            ("endpoint-queue-limit-external", self.endpoint_queue_limit_external),
+            ("endpoint-queue-limit-local", self.endpoint_queue_limit_local),
+        ];
+        for (name, value) in scalars {
+            if let Some(value) = value {
+                key(&mut out, name);
+                let _ = write!(out, "\"{}\"", value);
+            }
+        }
+        let lists = [
+            ("endpoint-queue-limits", "queue-size-limit", &self.endpoint_queue_limits),
+            ("payload-sizes", "max-payload-size", &self.payload_sizes),
+        ];
+        for (name, value_name, entries) in lists {
+            if entries.is_empty() {
+                continue;
+            }
+            key(&mut out, name);
+            write_port_list(&mut out, value_name, entries);
+        }
+        out.push_str("\n}\n");
+        out
+    }
+}
+
+/// Writes `entries` grouped by unicast address as `[ { "unicast", "ports": [ { "port", value_name } ] } ]`.
+fn write_port_list(out: &mut String, value_name: &str, entries: &[(IpAddr, u16, u32)]) {
+    let mut by_unicast: BTreeMap<IpAddr, Vec<(u16, u32)>> = BTreeMap::new();
+    for (unicast, port, value) in entries {
+        by_unicast.entry(*unicast).or_default().push((*port, *value));
+    }
+    out.push('[');
+    for (idx, (unicast, ports)) in by_unicast.iter().enumerate() {
+        let _ = write!(out, "{}\n    {{ \"unicast\": \"{}\", \"ports\": [", if idx == 0 { "" } else { "," }, unicast);
+        for (idx, (port, value)) in ports.iter().enumerate() {
+            let _ = write!(out, "{} {{ \"port\": \"{}\", \"{}\": \"{}\" }}", if idx == 0 { "" } else { "," },
+                           port, value_name, value);
+        }
+        out.push_str(" ] }");
+    }
+    out.push_str("\n  ]");
+}
+
+#[cfg(test)]
+mod test {
+    use super::*;
+
+    #[test]
+    fn empty_test() {
+        assert_eq!(TransportConfig::new().to_json(), "{\n}\n");
+    }
+
+    #[test]
+    fn to_json_test() {
+        let a: IpAddr = "10.0.0.1".parse().unwrap();
+        let b: IpAddr = "10.0.0.2".parse().unwrap();
+        let json = TransportConfig::new()
+            .udp_receive_buffer_size(1 << 20)
+            .buffer_shrink_threshold(0)
+            .endpoint_queue_limit(b, 30510, 2048)
+            .endpoint_queue_limit(a, 30509, 1024)
+            .endpoint_queue_limit(a, 30511, 4096)
+            .max_payload_size(a, 30509, 65536)
+            .to_json();
+        assert_eq!(json, concat!(
+            "{\n",
+            "  \"udp-receive-buffer-size\": \"1048576\",\n",
+            "  \"buffer-shrink-threshold\": \"0\",\n",
+            "  \"endpoint-queue-limits\": [\n",
+            "    { \"unicast\": \"10.0.0.1\", \"ports\": [ { \"port\": \"30509\", \"queue-size-limit\": \"1024\" },",
+            " { \"port\": \"30511\", \"queue-size-limit\": \"4096\" } ] },\n",
+            "    { \"unicast\": \"10.0.0.2\", \"ports\": [ { \"port\": \"30510\", \"queue-size-limit\": \"2048\" } ] }\n",
+            "  ],\n",
+            "  \"payload-sizes\": [\n",
+            "    { \"unicast\": \"10.0.0.1\", \"ports\": [ { \"port\": \"30509\", \"max-payload-size\": \"65536\" } ] }\n",
+            "  ]\n",
+            "}\n"));
+    }
+}
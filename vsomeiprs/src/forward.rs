@@ -0,0 +1,107 @@
+// SPDX-License-Identifier: MPL-2.0
+//
+// Copyright (C) 2024 Alexander Seifarth
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+use super::{ffi, return_code_to_ffi, InstanceID, MessageHeader, MessageType, MethodID, ReturnCode, ServiceID,
+            SessionID, VSomeipApplication};
+
+/// IDs replaced when forwarding a message, `None` keeps the ID of the received message.
+#[derive(Debug, Default, Clone, Copy, Eq, PartialEq)]
+pub struct Remap {
+    pub service_id: Option<ServiceID>,
+    pub instance_id: Option<InstanceID>,
+    pub method_id: Option<MethodID>,
+}
+
+impl Remap {
+    /// Returns the target IDs of a message received with `header`.
+    pub fn apply(&self, header: &MessageHeader) -> (ServiceID, InstanceID, MethodID) {
+        (self.service_id.unwrap_or(header.service_id),
+         self.instance_id.unwrap_or(header.instance_id),
+         self.method_id.unwrap_or(header.method_id))
+    }
+}
+
+impl VSomeipApplication {
+    /// Forwards a message received by any application through this one, e.g. in a gateway
+    /// between two routing domains. The message is sent with the payload object of the received
+    /// message instead of a copy; vsomeip itself still copies notified data into the event.
+    ///
+    /// A notification is notified as event of this application, which must offer it. A request is
+    /// sent to the provider with the major version and transport of the received one, the returned
+    /// session ID correlates its response which is forwarded with [Self::forward_response()].
+    /// Returns the session ID of a forwarded request, `None` for notifications. Responses and errors
+    /// are not forwarded by this function.
+    pub fn forward(&self, msg: &MessageType, remap: Remap) -> Option<SessionID> {
+        let header = msg.header();
+        let (service_id, instance_id, method_id) = remap.apply(header);
+        match msg {
+            MessageType::Notification { data, .. } => {
+                unsafe {
+                    ffi::application_forward_notification(self.app, service_id.id(), instance_id.id(),
+                                                          method_id.id(), false, data.payload);
+                }
+                None
+            }
+            MessageType::Request { data, .. } | MessageType::RequestNoReturn { data, .. } => {
+                let no_return = matches!(msg, MessageType::RequestNoReturn { .. });
+                let session = unsafe {
+                    ffi::application_forward_request(self.app, service_id.id(), instance_id.id(), method_id.id(),
+                                                     header.interface_version.major.id(), header.reliable,
+                                                     no_return, data.payload)
+                };
+                Some(SessionID(session))
+            }
+            MessageType::Response { .. } | MessageType::Error { .. } => None,
+        }
+    }
+
+    /// Forwards a received response or error as response to `source_request`, the request this
+    /// application received and forwarded. Returns false for other message types.
+    pub fn forward_response(&self, msg: &MessageType, source_request: &MessageHeader) -> bool {
+        let (return_code, data) = match msg {
+            MessageType::Response { data, .. } => (ReturnCode::Ok, data),
+            MessageType::Error { return_code, data, .. } => (*return_code, data),
+            _ => return false,
+        };
+        unsafe {
+            ffi::application_forward_response(self.app,
+                                              source_request.service_id.id(),
+                                              source_request.instance_id.id(),
+                                              source_request.method_id.id(),
+                                              source_request.client_id.id(),
+                                              source_request.session_id.id(),
+                                              source_request.interface_version.major.id(),
+                                              source_request.reliable,
+                                              return_code_to_ffi(return_code),
+                                              data.payload);
+        }
+        true
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use super::*;
+    use crate::{ClientID, InterfaceVersion};
+
+    #[test]
+    fn remap_test() {
+        let header = MessageHeader {
+            service_id: ServiceID(0x1234),
+            instance_id: InstanceID(1),
+            method_id: MethodID(0x8001),
+            client_id: ClientID(0x10),
+            session_id: SessionID(7),
+            interface_version: InterfaceVersion::make_major(1),
+            reliable: false,
+            trace: None,
+        };
+        assert_eq!(Remap::default().apply(&header), (ServiceID(0x1234), InstanceID(1), MethodID(0x8001)));
+        let remap = Remap { instance_id: Some(InstanceID(2)), ..Default::default() };
+        assert_eq!(remap.apply(&header), (ServiceID(0x1234), InstanceID(2), MethodID(0x8001)));
+    }
+}
@@ -0,0 +1,133 @@
+// SPDX-License-Identifier: MPL-2.0
+//
+// Copyright (C) 2024 Alexander Seifarth
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+use std::sync::{Arc, Mutex};
+use super::{ApplicationOptions, InstanceID, InterfaceVersion, MessageTarget, MethodID, OverflowPolicy, RouteID,
+            ServiceID, VSomeipApplication, VSomeipReceiver};
+
+/// Hosts several logical components on one vsomeip application.
+///
+/// All components share the application's routing manager connection, its dispatcher thread and
+/// its inbound demultiplexer: the messages of the services a component has routed to itself are
+/// delivered to the component's own receiver. The number of threads and sockets thereby stays
+/// constant with the number of components.
+///
+/// The receiver returned by [VSomeipHost::create()] gets the registration state of the shared
+/// application and all messages not routed to a component. Components are set up after the
+/// application is registered.
+pub struct VSomeipHost {
+    app: Arc<VSomeipApplication>,
+}
+
+impl VSomeipHost {
+    /// Creates the shared vsomeip application, see [VSomeipApplication::create_with_options()].
+    pub fn create(name: &str, options: ApplicationOptions) -> Result<(Self, VSomeipReceiver), ()> {
+        let (app, receiver) = VSomeipApplication::create_with_options(name, options)?;
+        Ok( (VSomeipHost { app: Arc::new(app) }, receiver) )
+    }
+
+    /// Returns the shared application.
+    pub fn application(&self) -> &VSomeipApplication {
+        &self.app
+    }
+
+    /// Adds a component with a receive queue of its own.
+    /// Messages are delivered to it once services are routed with [Component::route_service()].
+    pub fn add_component(&self, name: &str, queue_capacity: usize, overflow_policy: OverflowPolicy)
+        -> (Component, VSomeipReceiver)
+    {
+        let (target, queue) = self.app.new_target(queue_capacity, overflow_policy);
+        let component = Component {
+            name: name.to_string(),
+            app: self.app.clone(),
+            target,
+            routes: Mutex::new(Vec::new()),
+            requested: Mutex::new(Vec::new()),
+        };
+        (component, VSomeipReceiver::new(queue))
+    }
+}
+
+/// A logical component of a [VSomeipHost].
+///
+/// Sending, offering and notifying go through the shared [Component::application()]. The
+/// component's routes and requested services are removed when it is dropped.
+pub struct Component {
+    name: String,
+    app: Arc<VSomeipApplication>,
+    target: Arc<MessageTarget>,
+    routes: Mutex<Vec<RouteID>>,
+    requested: Mutex<Vec<(ServiceID, InstanceID, InterfaceVersion)>>,
+}
+
+impl Drop for Component {
+    fn drop(&mut self) {
+        for (service_id, instance_id, version) in self.requested.get_mut().unwrap().drain(..) {
+            self.app.release_service_for(service_id, instance_id, version, &self.target);
+        }
+        for route in self.routes.get_mut().unwrap().drain(..) {
+            self.app.detach_route(route);
+        }
+    }
+}
+
+impl Component {
+    pub fn name(&self) -> &str {
+        &self.name
+    }
+
+    /// Returns the shared application.
+    pub fn application(&self) -> &VSomeipApplication {
+        &self.app
+    }
+
+    /// Delivers the messages of methods/events `first` to `last` (inclusive) of a service instance
+    /// to this component, see [VSomeipApplication::add_route()].
+    /// Returns `None` if the range is already routed.
+    pub fn route(&self, service_id: ServiceID, instance_id: InstanceID, first: MethodID, last: MethodID)
+        -> Option<RouteID>
+    {
+        let mut routes = self.routes.lock().unwrap();
+        let route = self.app.attach_route(service_id, instance_id, first, last, &self.target)?;
+        routes.push(route);
+        Some(route)
+    }
+
+    /// Delivers all messages of a service instance to this component, i.e. the requests of a
+    /// service it provides or the responses and notifications of a service it consumes.
+    pub fn route_service(&self, service_id: ServiceID, instance_id: InstanceID) -> Option<RouteID> {
+        self.route(service_id, instance_id, MethodID(0x0000), MethodID(0xffff))
+    }
+
+    /// Removes a route of this component.
+    pub fn remove_route(&self, route: RouteID) {
+        let mut routes = self.routes.lock().unwrap();
+        if let Some(pos) = routes.iter().position(|r| *r == route) {
+            routes.swap_remove(pos);
+            self.app.detach_route(route);
+        }
+    }
+
+    /// Requests a service like [VSomeipApplication::request_service()] but reports its
+    /// availability to this component's receiver. Components requesting the same service share
+    /// the request, it is released with the last one.
+    pub fn request_service(&self, service_id: ServiceID, instance_id: InstanceID, version: InterfaceVersion) {
+        let mut requested = self.requested.lock().unwrap();
+        self.app.request_service_for(service_id, instance_id, version, &self.target);
+        requested.push((service_id, instance_id, version));
+    }
+
+    /// Releases a service requested by this component.
+    pub fn release_service(&self, service_id: ServiceID, instance_id: InstanceID, version: InterfaceVersion) {
+        let mut requested = self.requested.lock().unwrap();
+        if let Some(pos) = requested.iter().position(|r| r.0 == service_id && r.1 == instance_id
+                                                        && r.2.major == version.major) {
+            requested.swap_remove(pos);
+            self.app.release_service_for(service_id, instance_id, version, &self.target);
+        }
+    }
+}
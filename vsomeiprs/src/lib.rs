@@ -7,13 +7,42 @@
 
 mod types;
 pub use types::*;
+mod channel;
+pub use channel::{ChannelStats, OverflowPolicy, VSomeipReceiver};
+mod call;
+mod ring;
+mod stats;
+pub use stats::{ApplicationStats, HistogramSnapshot, MessageCounts};
+pub mod catalogue;
+pub mod codec;
+mod host;
+pub use host::{Component, VSomeipHost};
+mod config;
+pub use config::TransportConfig;
+mod shm;
+pub use shm::ShmFrame;
+mod scheduler;
+pub use scheduler::CyclicScheduler;
+mod trace;
+pub use trace::{MessageTrace, TraceRecord, TRACE_RECORD_SIZE};
+mod forward;
+pub use forward::Remap;
+mod request;
 
+use std::collections::HashMap;
 use std::ffi::{c_char, CString};
 use std::fmt::{Debug, Formatter};
+use std::future::Future;
+use std::sync::{Arc, Mutex, OnceLock};
 use std::time::Duration;
 use bytes::Bytes;
-use tokio::sync::mpsc::{UnboundedReceiver, UnboundedSender};
+use tokio::sync::mpsc::UnboundedReceiver;
+use tokio::sync::Notify;
 use tokio::time::timeout;
+use channel::{BoundedQueue, FieldSet, MessageSink, QueueSender};
+use ring::{RingSender, SpscRing};
+use call::PendingCalls;
+use request::{RequestTargets, ServiceRequests};
 
 mod ffi {
     #![allow(non_upper_case_globals)]
@@ -23,11 +52,190 @@ mod ffi {
     include!(concat!(env!("OUT_DIR"), "/bindings.rs"));
 }
 
+/// Debounce filter for [VSomeipApplication::subscribe_with_debounce()].
+/// vsomeip passes a notification of the subscribed event when one of the enabled conditions holds,
+/// all other notifications are dropped before they reach the application.
+#[derive(Debug, Clone, Default, Eq, PartialEq)]
+pub struct DebounceFilter {
+    /// Pass a notification when its payload differs from the last passed one.
+    pub on_change: bool,
+    /// A notification passed because of a change restarts the `interval`.
+    pub on_change_resets_interval: bool,
+    /// Pass a notification when `interval` has elapsed since the last passed one, `None` disables it.
+    pub interval: Option<Duration>,
+    /// Pass the latest value once the `interval` has elapsed even if no further notification arrives.
+    pub send_current_value_after: bool,
+    /// Bits not considered for `on_change` as (byte index, bit mask) pairs, e.g. counters or noisy
+    /// low order bits of a measurement.
+    pub ignore: Vec<(u32, u8)>,
+}
+
+/// An event of [VSomeipApplication::offer_events()] or [VSomeipApplication::request_events()].
+/// `cycle`, `change_resets_cycle` and `update_on_change` only apply to offered events.
+#[derive(Debug, Clone, Copy)]
+pub struct EventDescriptor<'a> {
+    pub service_id: ServiceID,
+    pub instance_id: InstanceID,
+    pub notifier_id: MethodID,
+    pub event_groups: &'a [EventGroupID],
+    pub is_field: bool,
+    pub cycle: Option<Duration>,
+    pub change_resets_cycle: bool,
+    pub update_on_change: bool,
+}
+
+impl<'a> EventDescriptor<'a> {
+    /// Describes an event without cyclic notifications that is sent on change.
+    pub fn event(service_id: ServiceID, instance_id: InstanceID, notifier_id: MethodID,
+                 event_groups: &'a [EventGroupID]) -> Self {
+        EventDescriptor { service_id, instance_id, notifier_id, event_groups, is_field: false, cycle: None,
+                          change_resets_cycle: false, update_on_change: true }
+    }
+
+    /// Describes a field without cyclic notifications that is sent on change.
+    pub fn field(service_id: ServiceID, instance_id: InstanceID, notifier_id: MethodID,
+                 event_groups: &'a [EventGroupID]) -> Self {
+        EventDescriptor { is_field: true, ..Self::event(service_id, instance_id, notifier_id, event_groups) }
+    }
+
+    fn to_ffi(&self) -> ffi::event_descriptor {
+        ffi::event_descriptor {
+            service: self.service_id.id(),
+            instance: self.instance_id.id(),
+            notifier: self.notifier_id.id(),
+            is_field: self.is_field,
+            change_resets_cycle: self.change_resets_cycle,
+            update_on_change: self.update_on_change,
+            cycle: self.cycle.map(|x| x.as_millis() as u32).unwrap_or(0),
+            event_groups: self.event_groups.as_ptr() as *const ffi::eventgroup_id,
+            event_groups_size: self.event_groups.len() as u32,
+        }
+    }
+}
+
+/// Comparator of a provider side event filter, see [VSomeipApplication::offer_event_with_epsilon()].
+/// Invoked with the last sent and the new payload, returns whether the change is significant.
+pub type EpsilonChange = dyn Fn(&[u8], &[u8]) -> bool + Send + Sync;
+
+/// Header filter of received messages, see [VSomeipApplication::set_message_filter()].
+/// Returns whether the message is passed on.
+pub type MessageFilter = dyn Fn(&MessageHeader) -> bool + Send + Sync;
+
+/// Statistics of the pool of payload handles of an application.
+/// Each received message requires a payload handle. In steady state the handles are taken from the
+/// pool (`hits`), only when the pool runs empty a new handle is allocated (`misses`).
+#[derive(Debug, Default, Copy, Clone, Eq, PartialEq)]
+pub struct PayloadPoolStats {
+    /// Number of handles taken from the pool's free list.
+    pub hits: u64,
+    /// Number of handles that had to be allocated because the free list was empty.
+    pub misses: u64,
+    /// Number of handles refused because all were in use, the messages concerned were dropped.
+    /// Only the `static-memory` feature refuses handles.
+    pub exhausted: u64,
+    /// Number of handles currently in the free list.
+    pub available: u32,
+    /// Number of handles currently held by `VSomeipPayload` objects.
+    pub outstanding: u32,
+}
+
+/// Options for [VSomeipApplication::create_with_options()].
+#[derive(Debug, Clone)]
+pub struct ApplicationOptions {
+    /// Maximum number of messages held in the receive queue.
+    pub queue_capacity: usize,
+    /// What happens with messages arriving while the receive queue is full.
+    pub overflow_policy: OverflowPolicy,
+    /// Uses a lock free single-producer/single-consumer ring as receive queue. The consumer is
+    /// only woken up when the ring turns non-empty. The capacity is rounded up to a power of two;
+    /// the ring supports [OverflowPolicy::Block] and [OverflowPolicy::DropNewest] only, creating
+    /// the application fails for the other policies. The ring does not record the queue latency.
+    pub receive_ring: bool,
+    /// Enables the batched receive mode with a ring buffer of the given capacity.
+    /// SOME/IP messages are then not sent to the receiver, they must be fetched with
+    /// [VSomeipApplication::recv_batch()]. Messages arriving at a full ring are dropped.
+    pub batch_capacity: Option<u32>,
+    /// Number of vsomeip I/O threads, `None` keeps the vsomeip default.
+    pub io_threads: Option<u32>,
+    /// Maximum number of vsomeip dispatcher threads used when a handler blocks, `None` keeps the
+    /// vsomeip default.
+    pub max_dispatchers: Option<u32>,
+    /// Time a handler may block the dispatcher before vsomeip starts another dispatcher thread.
+    pub max_dispatch_time: Option<Duration>,
+    /// Number of worker threads the received messages are handled on. Messages are sharded by
+    /// service id, so the messages of a service keep their order while a blocking receive queue
+    /// only stalls the services of one worker. With 0 messages are handled on the vsomeip dispatcher.
+    /// Each worker queues up to `queue_capacity` messages with the `overflow_policy` of the receive
+    /// queue; [OverflowPolicy::CoalesceFields] discards the oldest message at a worker queue.
+    pub dispatch_workers: u32,
+    /// Socket buffer, endpoint queue and payload size settings passed to vsomeip like the
+    /// thread settings above. Both are ignored, with a message on stderr, when the environment
+    /// variable `VSOMEIP_CONFIGURATION_<name>` selects the configuration of the application.
+    pub transport: Option<TransportConfig>,
+    /// Capacity of the pool of payload handles, `None` keeps the default of 1024. With the
+    /// `static-memory` feature this is the number of received messages that can be held at a time,
+    /// all handles are allocated when the application is created.
+    pub payload_handles: Option<u32>,
+}
+
+impl Default for ApplicationOptions {
+    fn default() -> Self {
+        ApplicationOptions {
+            queue_capacity: 1024,
+            overflow_policy: OverflowPolicy::default(),
+            receive_ring: false,
+            batch_capacity: None,
+            io_threads: None,
+            max_dispatchers: None,
+            max_dispatch_time: None,
+            dispatch_workers: 0,
+            transport: None,
+            payload_handles: None,
+        }
+    }
+}
+
+impl ApplicationOptions {
+    /// `transport` holds the JSON text of [ApplicationOptions::transport] and `batch_ready` the
+    /// notification of [ApplicationOptions::batch_capacity] referred to by the result.
+    fn to_ffi_config(&self, transport: Option<&CString>, batch_ready: Option<&Notify>) -> ffi::application_config {
+        ffi::application_config {
+            io_threads: self.io_threads.unwrap_or(0),
+            max_dispatchers: self.max_dispatchers.unwrap_or(0),
+            max_dispatch_time_ms: self.max_dispatch_time.map_or(0, |t| t.as_millis().max(1) as u32),
+            dispatch_workers: self.dispatch_workers,
+            transport_config: transport.map_or(std::ptr::null(), |t| t.as_ptr()),
+            payload_handles: self.payload_handles.unwrap_or(0),
+            dispatch_queue_capacity: self.queue_capacity.min(u32::MAX as usize) as u32,
+            dispatch_overflow: match self.overflow_policy {
+                OverflowPolicy::Block => ffi::overflow_policy_e_OP_BLOCK,
+                OverflowPolicy::DropNewest => ffi::overflow_policy_e_OP_DROP_NEWEST,
+                OverflowPolicy::DropOldest | OverflowPolicy::CoalesceFields => ffi::overflow_policy_e_OP_DROP_OLDEST,
+            },
+            batch_capacity: if batch_ready.is_some() { self.batch_capacity.unwrap_or(0) } else { 0 },
+            batch_ready_handler: if batch_ready.is_some() { Some(batch_ready_handler) } else { None },
+            batch_ready_object: batch_ready.map_or(std::ptr::null(), |n| n as *const Notify as *const std::os::raw::c_void),
+        }
+    }
+}
+
 #[derive(Debug)]
 pub enum VSomeipMessage {
     RegistrationState(bool),
     ServiceAvailability{ service_id: u16, instance_id: u16, avail: bool },
-    Message(MessageType)
+    Message(MessageType),
+    /// A new value of a conflated field has arrived, see [VSomeipApplication::conflate_field()].
+    /// It is sent once when the field becomes dirty, not for every notification.
+    FieldUpdated{ service_id: u16, instance_id: u16, notifier_id: u16 },
+    /// Role of a service instance offered with [VSomeipApplication::offer_service_standby()],
+    /// `active` is false while another provider offers the instance.
+    ProviderRole{ service_id: u16, instance_id: u16, active: bool },
+    /// A client subscribed to or unsubscribed from an eventgroup of offered events, see
+    /// [VSomeipApplication::watch_subscriptions()].
+    Subscription{ service_id: u16, instance_id: u16, eventgroup_id: u16, client_id: u16, subscribed: bool },
+    /// The provider accepted or rejected a subscription of the application, see
+    /// [VSomeipApplication::watch_subscription_status()].
+    SubscriptionStatus{ service_id: u16, instance_id: u16, eventgroup_id: u16, notifier_id: u16, accepted: bool },
 }
 
 /// Waits until a `RegistrationState(true)` message is received or a timeout occurs.
@@ -79,12 +287,22 @@ pub async fn wait_registered_for(timeout_time: Duration, recv: &mut UnboundedRec
 /// object.
 pub struct VSomeipApplication {
     app: ffi::application_t,
-    sender2: Box<UnboundedSender<VSomeipMessage>>,
+    sink: Arc<MessageTarget>,
+    requests: ServiceRequests,
+    // the requested fields, coalesced by the receive queues with OverflowPolicy::CoalesceFields
+    fields: Arc<FieldSet>,
+    batch_ready: Option<Box<Notify>>,
+    routes: Mutex<HashMap<u32, Arc<MessageTarget>>>,
+    // the comparator of each event offered with a filter, vsomeip holds a reference of its own
+    // until it drops the comparator
+    epsilon_filters: Mutex<HashMap<(u16, u16, u16), Arc<Box<EpsilonChange>>>>,
+    message_filter: OnceLock<Box<Box<MessageFilter>>>,
 }
 
 impl Drop for VSomeipApplication {
     fn drop(&mut self) {
         unsafe { ffi::application_delete(self.app) }
+        self.sink.calls.shutdown();
     }
 }
 
@@ -103,54 +321,273 @@ impl VSomeipApplication {
     ///
     /// # Returns
     /// The application object and the channel receiver are returned in case of success (OK).
+    #[cfg_attr(feature = "static-memory",
+               deprecated(note = "the unbounded channel allocates for queued messages, use create_with_options()"))]
     pub fn create(name: &str) -> Result<(Self, UnboundedReceiver<VSomeipMessage>), ()> {
-        let name_cstr = CString::new(name).unwrap();
+        let (sender, recv) = tokio::sync::mpsc::unbounded_channel();
+        let application = Self::create_with_sink(name, MessageSink::Unbounded(sender), Arc::default(),
+                                                 &ApplicationOptions::default())?;
+        Ok( (application, recv) )
+    }
+
+    /// Creates a new vsomeip application object with a bounded receive queue.
+    /// Other than with [VSomeipApplication::create()] the memory held by received but not yet
+    /// consumed messages is limited. When the queue is full the `overflow_policy` of the options
+    /// decides whether the vsomeip dispatch thread waits or which messages are discarded.
+    /// Registration and availability messages are never discarded.
+    ///
+    /// # Args
+    /// - `name` - The name of the application object. Note that vsomeip might modify it if not unique.
+    /// - `options` - Capacity and overflow policy of the receive queue and the threading of the application.
+    pub fn create_with_options(name: &str, options: ApplicationOptions) -> Result<(Self, VSomeipReceiver), ()> {
+        let fields = Arc::new(FieldSet::default());
+        let (sink, receiver) = if options.receive_ring {
+            let ring = SpscRing::new(options.queue_capacity, options.overflow_policy)?;
+            (MessageSink::Ring(RingSender(ring.clone())), VSomeipReceiver::with_ring(ring))
+        } else {
+            let queue = BoundedQueue::with_fields(options.queue_capacity, options.overflow_policy, fields.clone());
+            (MessageSink::Bounded(QueueSender(queue.clone())), VSomeipReceiver::new(queue))
+        };
+        let application = Self::create_with_sink(name, sink, fields, &options)?;
+        Ok( (application, receiver) )
+    }
+
+    fn create_with_sink(name: &str, sink: MessageSink, fields: Arc<FieldSet>, options: &ApplicationOptions)
+        -> Result<Self, ()>
+    {
+        let name_cstr = CString::new(name).map_err(|_| ())?;
         let name_c: *const c_char = name_cstr.as_ptr() as *const c_char;
-        let app = unsafe { ffi::create_application(name_c) };
+        let transport = options.transport.as_ref().map(|t| CString::new(t.to_json()).unwrap());
+        // boxed before the application is created, its address is handed to the batch ring
+        let batch_ready = options.batch_capacity.filter(|&c| c > 0).map(|_| Box::new(Notify::new()));
+        let config = options.to_ffi_config(transport.as_ref(), batch_ready.as_deref());
+        let app = unsafe { ffi::create_application_with_config(name_c, &config) };
         if app.is_null() {
             return Err(());
         }
-        let (sender, recv) = tokio::sync::mpsc::unbounded_channel();
-        let mut application = VSomeipApplication {app, sender2: Box::new(sender)};
+        let mut application = VSomeipApplication {app, sink: Arc::new(MessageTarget {sink, calls: PendingCalls::new()}),
+            requests: ServiceRequests::new(), fields, batch_ready, routes: Mutex::new(HashMap::new()),
+            epsilon_filters: Mutex::new(HashMap::new()), message_filter: OnceLock::new()};
         application.setup_channel_callbacks();
-        Ok( (application, recv) )
+        Ok(application)
     }
 
     /// Registers the vsomeip callbacks (state, availability, message).
-    /// Each callback invocation is transformed into a `VSomeipMessage` and sent in the unbounded
-    /// channel.
+    /// Each callback invocation is transformed into a `VSomeipMessage` and sent to the message
+    /// sink (unbounded channel or bounded queue).
     /// This method must be invoked only once!
     fn setup_channel_callbacks(&mut self) {
         // TODO panic when this method is called more than once.
         unsafe {
-            let sender_ptr = &(*self.sender2) as *const UnboundedSender<VSomeipMessage>;
             ffi::application_register_handlers(
                 self.app,
                 Some(state_handler),
                 Some(message_handler2),
-                sender_ptr as *const std::os::raw::c_void);
+                self.sink_ptr());
+        }
+    }
+
+    /// Waits for received SOME/IP messages and appends all currently available ones to `out`.
+    /// Only for applications created with [ApplicationOptions::batch_capacity].
+    /// # Return
+    /// Returns the number of messages appended.
+    pub async fn recv_batch(&self, out: &mut Vec<MessageType>) -> usize {
+        let notify = self.batch_ready.as_ref().expect("application is not in batched receive mode");
+        loop {
+            let count = self.drain(out);
+            if count > 0 {
+                return count;
+            }
+            notify.notified().await;
+        }
+    }
+
+    /// Appends all messages currently held in the batch ring to `out` without waiting.
+    pub fn try_recv_batch(&self, out: &mut Vec<MessageType>) -> usize {
+        self.drain(out)
+    }
+
+    /// Returns the number of messages dropped because the batch ring was full.
+    pub fn batch_dropped(&self) -> u64 {
+        unsafe { ffi::application_batch_dropped(self.app) }
+    }
+
+    fn drain(&self, out: &mut Vec<MessageType>) -> usize {
+        const CHUNK: usize = 64;
+        let mut headers = [std::mem::MaybeUninit::<ffi::message_header>::uninit(); CHUNK];
+        let mut payloads: [ffi::payload_t; CHUNK] = [std::ptr::null_mut(); CHUNK];
+        let before = out.len();
+        loop {
+            let n = unsafe {
+                ffi::application_drain(self.app, headers.as_mut_ptr() as *mut ffi::message_header,
+                                       payloads.as_mut_ptr(), CHUNK as u32)
+            } as usize;
+            for i in 0..n {
+                if let Some(msg) = make_message(unsafe { headers[i].assume_init_ref() }, payloads[i])
+                    .and_then(|msg| self.sink.calls.complete(msg))
+                {
+                    out.push(msg);
+                }
+            }
+            if n < CHUNK {
+                return out.len() - before;
+            }
+        }
+    }
+
+    fn sink_ptr(&self) -> *const std::os::raw::c_void {
+        &(*self.sink) as *const MessageTarget as *const std::os::raw::c_void
+    }
+
+    /// Returns the drop and coalesce counters of the receive queue.
+    /// For applications with an unbounded channel all counters are zero.
+    pub fn channel_stats(&self) -> ChannelStats {
+        self.sink.sink.stats()
+    }
+
+    /// Returns a snapshot of the application's hot path statistics: message and byte counters,
+    /// the time spent delivering received messages and the receive queue's high-water mark and
+    /// latency. All values are recorded lock free, so they are cheap enough to be always on.
+    pub fn stats(&self) -> ApplicationStats {
+        let mut c = std::mem::MaybeUninit::<ffi::application_stats>::uninit();
+        let c = unsafe {
+            ffi::application_get_stats(self.app, c.as_mut_ptr());
+            c.assume_init()
+        };
+        ApplicationStats {
+            messages_in: MessageCounts::from(&c.msgs_in),
+            messages_out: MessageCounts::from(&c.msgs_out),
+            bytes_in: c.bytes_in,
+            bytes_out: c.bytes_out,
+            notify_calls: c.notify_calls,
+            payload_allocations: c.payload_allocations,
+            dispatch_dropped: c.dispatch_dropped,
+            handler_time: HistogramSnapshot::from(&c.handler_time),
+            queue_high_water: self.sink.sink.stats().high_water,
+            queue_latency: self.sink.sink.latency(),
+        }
+    }
+
+    /// Discards received messages for which `filter` returns false before a payload handle is
+    /// created for them or they are queued, so components forwarding or filtering on the header
+    /// alone do not pay for the messages they drop. The filter runs on the vsomeip dispatcher
+    /// thread, the header passed to it has no trace. Returns false if a filter is already set.
+    pub fn set_message_filter<F>(&self, filter: F) -> bool
+        where F: Fn(&MessageHeader) -> bool + Send + Sync + 'static
+    {
+        if self.message_filter.set(Box::new(Box::new(filter))).is_err() {
+            return false;
+        }
+        let context = &**self.message_filter.get().unwrap() as *const Box<MessageFilter>;
+        unsafe {
+            ffi::application_set_message_filter(self.app, Some(message_filter_handler),
+                                                context as *const std::os::raw::c_void);
+        }
+        true
+    }
+
+    /// Samples every `every`th received message for tracing, 0 (the default) disables tracing.
+    /// A sampled message carries the timestamps of its delivery stages in [MessageHeader::trace];
+    /// bounded receivers additionally keep the last traced messages, see [VSomeipReceiver::traces()].
+    /// Messages which are not sampled cost one relaxed atomic increment.
+    pub fn set_trace_sampling(&self, every: u32) {
+        unsafe { ffi::application_set_trace_sampling(self.app, every) }
+    }
+
+    /// Delivers the messages of methods/events `first` to `last` (inclusive) of a service instance
+    /// to a receiver of their own instead of the application's receiver. With `instance_id`
+    /// [ANY_INSTANCE] the route applies to all instances of the service without a route of their own.
+    /// Independent subsystems can so consume their messages without sharing one queue.
+    ///
+    /// Routed messages bypass conflation and the batched receive mode. Returns `None` if the range
+    /// overlaps the range of an existing route.
+    pub fn add_route(&self, service_id: ServiceID, instance_id: InstanceID, first: MethodID, last: MethodID,
+                     queue_capacity: usize, overflow_policy: OverflowPolicy) -> Option<(RouteID, VSomeipReceiver)>
+    {
+        let (sink, queue) = self.new_target(queue_capacity, overflow_policy);
+        let mut routes = self.routes.lock().unwrap();
+        let route = self.attach_route(service_id, instance_id, first, last, &sink)?;
+        routes.insert(route.id(), sink);
+        Some( (route, VSomeipReceiver::new(queue)) )
+    }
+
+    /// Creates a message target with its own bounded queue, sharing the pending calls of the application.
+    fn new_target(&self, queue_capacity: usize, overflow_policy: OverflowPolicy) -> (Arc<MessageTarget>, Arc<BoundedQueue>) {
+        let queue = BoundedQueue::with_fields(queue_capacity, overflow_policy, self.fields.clone());
+        let sink = Arc::new(MessageTarget {
+            sink: MessageSink::Bounded(QueueSender(queue.clone())),
+            calls: self.sink.calls.clone(),
+        });
+        (sink, queue)
+    }
+
+    /// Adds a route to `target`. The route holds a reference of `target` until its handler has
+    /// returned for the last time after the route was detached.
+    fn attach_route(&self, service_id: ServiceID, instance_id: InstanceID, first: MethodID, last: MethodID,
+                    target: &Arc<MessageTarget>) -> Option<RouteID>
+    {
+        let route = unsafe {
+            ffi::application_add_route(self.app, service_id.id(), instance_id.id(), first.id(), last.id(),
+                                       Some(message_handler2),
+                                       Arc::into_raw(target.clone()) as *const std::os::raw::c_void,
+                                       Some(release_target))
+        };
+        (route != 0).then_some(RouteID(route))
+    }
+
+    /// Removes a route. A handler blocked in the route's full queue may still deliver its message.
+    fn detach_route(&self, route: RouteID) {
+        unsafe { ffi::application_remove_route(self.app, route.id()) }
+    }
+
+    /// Removes a route, its messages are delivered to the application's receiver again.
+    /// The route's receiver is closed once it has returned the messages already queued.
+    pub fn remove_route(&self, route: RouteID) {
+        let mut routes = self.routes.lock().unwrap();
+        if let Some(sink) = routes.remove(&route.id()) {
+            self.detach_route(route);
+            drop(sink);
         }
     }
 
     /// Requests a SOME/IP service.
     /// A consumer must request a desired service before it can use it. Once it is requested the
     /// service's availability notifications will be sent to the application.
+    /// Requests are counted: each one must be released with [VSomeipApplication::release_service()].
     pub fn request_service(&self, service_id: ServiceID, instance_id: InstanceID, version: InterfaceVersion)
     {
-        unsafe {
-            let sender_ptr = &(*self.sender2) as *const UnboundedSender<VSomeipMessage>;
+        self.request_service_for(service_id, instance_id, version, &self.sink)
+    }
+
+    /// Requests a service, its availability is reported to `target`.
+    /// The service is requested from vsomeip once, with the minor version of the first request.
+    fn request_service_for(&self, service_id: ServiceID, instance_id: InstanceID, version: InterfaceVersion,
+                           target: &Arc<MessageTarget>)
+    {
+        let key = (service_id.id(), instance_id.id(), version.major.id());
+        self.requests.add(key, target, |targets| unsafe {
             ffi::application_request_service(self.app, service_id.id(), instance_id.id(),
                                              version.major.id(), version.minor.id(),
                                              Some(avail_handler),
-                                             sender_ptr as *const std::os::raw::c_void);
-        }
+                                             Arc::into_raw(targets.clone()) as *const std::os::raw::c_void,
+                                             Some(release_request));
+        });
     }
 
-    /// Releases a requested SOME/IP service.
+    /// Releases a SOME/IP service requested with [VSomeipApplication::request_service()].
+    /// The service stays requested while components of a [VSomeipHost] still request it.
     pub fn release_service(&self, service_id: ServiceID, instance_id: InstanceID, version: InterfaceVersion) {
-        unsafe {
+        self.release_service_for(service_id, instance_id, version, &self.sink);
+    }
+
+    /// Releases a request of `target`, returns false if it has not requested the service.
+    fn release_service_for(&self, service_id: ServiceID, instance_id: InstanceID, version: InterfaceVersion,
+                           target: &Arc<MessageTarget>) -> bool
+    {
+        let key = (service_id.id(), instance_id.id(), version.major.id());
+        self.requests.remove(key, target, || unsafe {
             ffi::application_release_service(self.app, service_id.id(), instance_id.id(), version.major.id());
-        }
+        })
     }
 
     /// A provider of a service indicates it's readiness to process requests for the service instance.
@@ -159,6 +596,8 @@ impl VSomeipApplication {
     ///      VSOMEIP will then consider the second and later providers as hot-standby for the 
     ///      currently active provider. Therefore, there will be error message or any other 
     ///      indication that a provider is not the active one.
+    ///      Use [VSomeipApplication::offer_service_standby()] for redundant providers that need to
+    ///      know their role.
     pub fn offer_service(&self, service_id: ServiceID, instance_id: InstanceID, version: InterfaceVersion) {
         unsafe {
             ffi::application_offer_service(self.app, service_id.id(), instance_id.id(), 
@@ -166,6 +605,48 @@ impl VSomeipApplication {
         }
     }
     
+    /// Offers a service instance in hot-standby for redundant providers.
+    /// The instance starts in standby role and is offered as soon as the offer of the active
+    /// provider is lost, or after `initial_wait` if no other provider has been seen by then. The
+    /// role is reported with [VSomeipMessage::ProviderRole] messages, first standby and later the
+    /// takeover.
+    ///
+    /// The events of the instance should be offered before, and its fields kept up to date with
+    /// [VSomeipApplication::prepare_field()]. On takeover the service offer and the latest field
+    /// values go out immediately, so subscribers get their initial values without further delay.
+    /// The application must not request the instance itself.
+    /// NOTE: For remote providers vsomeip only knows about their offer after service discovery has
+    ///       seen it, so `initial_wait` should be longer than the cyclic offer delay of the service
+    ///       discovery configuration. Otherwise two providers may turn active.
+    pub fn offer_service_standby(&self, service_id: ServiceID, instance_id: InstanceID, version: InterfaceVersion,
+                                 initial_wait: Duration)
+    {
+        unsafe {
+            ffi::application_offer_service_standby(self.app, service_id.id(), instance_id.id(),
+                                                   version.major.id(), version.minor.id(),
+                                                   initial_wait.as_millis() as u32,
+                                                   Some(provider_role_handler), self.sink_ptr())
+        }
+    }
+
+    /// Removes a service instance from hot-standby, stops offering it if it is active.
+    pub fn stop_offer_service_standby(&self, service_id: ServiceID, instance_id: InstanceID) {
+        unsafe {
+            ffi::application_stop_offer_service_standby(self.app, service_id.id(), instance_id.id())
+        }
+    }
+
+    /// Updates a field like [VSomeipApplication::notify()]. While the instance is in standby
+    /// role the value is only kept for the takeover, nothing is sent.
+    pub fn prepare_field(&self, service_id: ServiceID, instance_id: InstanceID, notifier_id: MethodID,
+                         payload: &Bytes, force_notification: bool)
+    {
+        unsafe {
+            ffi::application_prepare_field(self.app, service_id.id(), instance_id.id(), notifier_id.id(),
+                                           force_notification, payload.as_ptr(), payload.len() as u32)
+        }
+    }
+
     /// A provider indicates that it is no longer offering the service instance.
     pub fn stop_offer_service(&self, service_id: ServiceID, instance_id: InstanceID, version: InterfaceVersion) {
         unsafe {
@@ -181,6 +662,17 @@ impl VSomeipApplication {
                         cycle: Option<Duration>,
                         change_resets_cycle: bool,
                         update_on_change: bool)
+    {
+        self.offer_event_slice(service_id, instance_id, notifier_id, &event_groups, is_field, cycle,
+                               change_resets_cycle, update_on_change)
+    }
+
+    fn offer_event_slice(&self,  service_id: ServiceID, instance_id: InstanceID, notifier_id: MethodID,
+                         event_groups: &[EventGroupID],
+                         is_field: bool,
+                         cycle: Option<Duration>,
+                         change_resets_cycle: bool,
+                         update_on_change: bool)
     {
         unsafe {
             ffi::application_offer_event(self.app, service_id.id(), instance_id.id(), notifier_id.id(),
@@ -200,18 +692,143 @@ impl VSomeipApplication {
                        change_resets_cycle: bool,
                        update_on_change: bool)
     {
-        self.offer_event(service_id, instance_id, notifier_id, vec![event_group], is_field,
-                        cycle, change_resets_cycle, update_on_change)
+        self.offer_event_slice(service_id, instance_id, notifier_id, std::slice::from_ref(&event_group), is_field,
+                               cycle, change_resets_cycle, update_on_change)
+    }
+
+    /// Offers all `events` with a single call into the C++ layer. Consecutive events with the same
+    /// event groups share one event group set, so large service catalogues are registered quickly.
+    pub fn offer_events(&self, events: &[EventDescriptor]) {
+        let events: Vec<ffi::event_descriptor> = events.iter().map(EventDescriptor::to_ffi).collect();
+        unsafe {
+            ffi::application_offer_events(self.app, events.as_ptr(), events.len() as u32)
+        }
+    }
+
+    /// Offers an event like [VSomeipApplication::offer_event()] with a provider side filter.
+    /// `epsilon` is invoked for each notification with the last sent and the new payload, the
+    /// notification is only sent when it returns true. Forced notifications are always sent.
+    /// Insignificant changes (e.g. sensor noise) thereby cost no network traffic and no work at
+    /// the consumers. `epsilon` is called on the thread calling notify. Offering the event again
+    /// replaces it, [VSomeipApplication::stop_offer_event()] drops it.
+    pub fn offer_event_with_epsilon<F>(&self, service_id: ServiceID, instance_id: InstanceID,
+                                       notifier_id: MethodID,
+                                       event_groups: Vec<EventGroupID>,
+                                       is_field: bool,
+                                       cycle: Option<Duration>,
+                                       change_resets_cycle: bool,
+                                       update_on_change: bool,
+                                       epsilon: F)
+        where F: Fn(&[u8], &[u8]) -> bool + Send + Sync + 'static
+    {
+        let epsilon: Arc<Box<EpsilonChange>> = Arc::new(Box::new(epsilon));
+        let context = Arc::into_raw(epsilon.clone()) as *const std::os::raw::c_void;
+        self.epsilon_filters.lock().unwrap()
+            .insert((service_id.id(), instance_id.id(), notifier_id.id()), epsilon);
+        unsafe {
+            ffi::application_offer_event_with_epsilon(self.app, service_id.id(), instance_id.id(),
+                                                      notifier_id.id(),
+                                                      event_groups.as_ptr() as *const ffi::eventgroup_id,
+                                                      event_groups.len() as u32,
+                                                      is_field,
+                                                      cycle.map(|x| x.as_millis() as u32).unwrap_or(0),
+                                                      change_resets_cycle, update_on_change,
+                                                      Some(epsilon_change_handler), context,
+                                                      Some(release_epsilon))
+        }
+    }
+
+    /// Registers all services, events and subscriptions of `catalogue`. Must be invoked after
+    /// the application is registered ([VSomeipMessage::RegistrationState]).
+    ///
+    /// The registrations are issued in dependency order: offered events (in one batch), offered
+    /// services, requested services, requested events (in one batch) and finally subscriptions.
+    /// Availability of the requested services is reported as for [VSomeipApplication::request_service()].
+    pub fn load_catalogue(&self, catalogue: &catalogue::CatalogueView) {
+        let groups: Vec<EventGroupID> = catalogue.event_groups().map(EventGroupID).collect();
+        let mut offered_events = Vec::new();
+        let mut requested_events = Vec::new();
+        for idx in 0..catalogue.event_count() {
+            let e = catalogue.event(idx);
+            let descriptor = EventDescriptor {
+                service_id: ServiceID(e.service),
+                instance_id: InstanceID(e.instance),
+                notifier_id: MethodID(e.notifier),
+                event_groups: &groups[e.first_group..e.first_group + e.groups],
+                is_field: e.is_field,
+                cycle: (e.cycle_ms > 0).then(|| Duration::from_millis(e.cycle_ms as u64)),
+                change_resets_cycle: e.change_resets_cycle,
+                update_on_change: e.update_on_change,
+            };
+            match e.role {
+                catalogue::Role::Offered => offered_events.push(descriptor),
+                catalogue::Role::Consumed => requested_events.push(descriptor),
+            }
+        }
+        self.offer_events(&offered_events);
+        let services = (0..catalogue.service_count()).map(|idx| catalogue.service(idx));
+        let (offered, requested): (Vec<_>, Vec<_>) = services.partition(|s| s.role == catalogue::Role::Offered);
+        for s in offered {
+            self.offer_service(ServiceID(s.service), InstanceID(s.instance),
+                               InterfaceVersion::make_version(s.major, s.minor));
+        }
+        for s in requested {
+            self.request_service(ServiceID(s.service), InstanceID(s.instance),
+                                 InterfaceVersion::make_version(s.major, s.minor));
+        }
+        self.request_events(&requested_events);
+        for idx in 0..catalogue.subscription_count() {
+            let s = catalogue.subscription(idx);
+            self.subscribe(ServiceID(s.service), InstanceID(s.instance), EventGroupID(s.event_group),
+                           MethodID(s.notifier), MajorVersion(s.major));
+        }
     }
 
     /// Stops offering of an event.
     pub fn stop_offer_event(&self, service_id: ServiceID, instance_id: InstanceID, notifier_id: MethodID)
     {
+        self.epsilon_filters.lock().unwrap().remove(&(service_id.id(), instance_id.id(), notifier_id.id()));
         unsafe {
             ffi::application_stop_offer_event(self.app, service_id.id(), instance_id.id(), notifier_id.id())
         }
     }
 
+    /// Reports the clients subscribing to or unsubscribing from an eventgroup of offered events
+    /// with [VSomeipMessage::Subscription] messages and counts them for
+    /// [VSomeipApplication::subscriber_count()]. This registers the vsomeip subscription handler of
+    /// the eventgroup, which accepts all subscriptions.
+    pub fn watch_subscriptions(&self, service_id: ServiceID, instance_id: InstanceID, event_group_id: EventGroupID) {
+        unsafe {
+            ffi::application_watch_subscriptions(self.app, service_id.id(), instance_id.id(), event_group_id.id(),
+                                                 Some(subscription_handler), self.sink_ptr())
+        }
+    }
+
+    /// Stops the [VSomeipMessage::Subscription] messages of an eventgroup, its subscribers are
+    /// still counted.
+    pub fn unwatch_subscriptions(&self, service_id: ServiceID, instance_id: InstanceID, event_group_id: EventGroupID) {
+        unsafe {
+            ffi::application_watch_subscriptions(self.app, service_id.id(), instance_id.id(), event_group_id.id(),
+                                                 None, std::ptr::null())
+        }
+    }
+
+    /// Returns the number of clients subscribed to an eventgroup of the offered event.
+    /// Only eventgroups watched with [VSomeipApplication::watch_subscriptions()] are counted, from
+    /// the first watch on.
+    pub fn subscriber_count(&self, service_id: ServiceID, instance_id: InstanceID, notifier_id: MethodID) -> u32 {
+        unsafe {
+            ffi::application_subscriber_count(self.app, service_id.id(), instance_id.id(), notifier_id.id())
+        }
+    }
+
+    /// Returns true if any client is subscribed to the offered event, counted as for
+    /// [VSomeipApplication::subscriber_count()]. Producers of expensive payloads can skip creating
+    /// them while nobody is subscribed.
+    pub fn has_subscribers(&self, service_id: ServiceID, instance_id: InstanceID, notifier_id: MethodID) -> bool {
+        self.subscriber_count(service_id, instance_id, notifier_id) > 0
+    }
+
     /// Consumers must request (configure) events from SOME/IP services before they can
     /// subscribe to the notifications of these events.
     /// It is important to configure ALL events defined for an event group even when the consumer
@@ -222,6 +839,16 @@ impl VSomeipApplication {
                        event_groups: Vec<EventGroupID>,
                        is_field: bool)
     {
+        self.request_event_slice(service_id, instance_id, notifier_id, &event_groups, is_field)
+    }
+
+    fn request_event_slice(&self,  service_id: ServiceID, instance_id: InstanceID, notifier_id: MethodID,
+                           event_groups: &[EventGroupID],
+                           is_field: bool)
+    {
+        if is_field {
+            self.fields.insert(service_id.id(), instance_id.id(), notifier_id.id());
+        }
         unsafe {
             ffi::application_request_event(self.app, service_id.id(), instance_id.id(), notifier_id.id(),
                    event_groups.as_ptr() as *const ffi::eventgroup_id, event_groups.len() as u32, is_field)
@@ -232,12 +859,25 @@ impl VSomeipApplication {
     pub fn request_event_seg(&self, service_id: ServiceID, instance_id: InstanceID, notifier_id: MethodID,
                              event_group: EventGroupID, is_field: bool)
     {
-        self.request_event(service_id, instance_id, notifier_id, vec![event_group], is_field)
+        self.request_event_slice(service_id, instance_id, notifier_id, std::slice::from_ref(&event_group), is_field)
+    }
+
+    /// Requests all `events` with a single call into the C++ layer, see
+    /// [VSomeipApplication::request_event()] and [VSomeipApplication::offer_events()].
+    pub fn request_events(&self, events: &[EventDescriptor]) {
+        for e in events.iter().filter(|e| e.is_field) {
+            self.fields.insert(e.service_id.id(), e.instance_id.id(), e.notifier_id.id());
+        }
+        let events: Vec<ffi::event_descriptor> = events.iter().map(EventDescriptor::to_ffi).collect();
+        unsafe {
+            ffi::application_request_events(self.app, events.as_ptr(), events.len() as u32)
+        }
     }
 
     /// Release a previously requested event.
     pub fn release_event(&self, service_id: ServiceID, instance_id: InstanceID, notifier_id: MethodID)
     {
+        self.fields.remove(service_id.id(), instance_id.id(), notifier_id.id());
         unsafe {
             ffi::application_release_event(self.app, service_id.id(), instance_id.id(), notifier_id.id())
         }
@@ -258,6 +898,30 @@ impl VSomeipApplication {
         }
     }
 
+    /// Subscribes to an event like [VSomeipApplication::subscribe()] but lets vsomeip drop the
+    /// notifications rejected by `filter` before they are dispatched to the application.
+    pub fn subscribe_with_debounce(&self, service_id: ServiceID, instance_id: InstanceID,
+                                   event_group_id: EventGroupID, notifier_id: MethodID,
+                                   major_version: MajorVersion, filter: &DebounceFilter)
+    {
+        let ignore: Vec<ffi::debounce_ignore> = filter.ignore.iter()
+            .map(|&(index, mask)| ffi::debounce_ignore { index, mask })
+            .collect();
+        let ffi_filter = ffi::debounce_filter {
+            on_change: filter.on_change,
+            on_change_resets_interval: filter.on_change_resets_interval,
+            send_current_value_after: filter.send_current_value_after,
+            interval_ms: filter.interval.map_or(-1, |t| t.as_millis().min(i64::MAX as u128) as i64),
+            ignore: ignore.as_ptr(),
+            ignore_size: ignore.len() as u32,
+        };
+        unsafe {
+            ffi::application_subscribe_with_debounce(self.app, service_id.id(), instance_id.id(),
+                                                     event_group_id.id(), notifier_id.id(),
+                                                     major_version.id(), &ffi_filter)
+        }
+    }
+
     /// Unsubscribe a consumer from a previously subscribed event group.
     pub fn unsubscribe(&self, service_id: ServiceID, instance_id: InstanceID, event_group_id: EventGroupID)
     {
@@ -267,6 +931,101 @@ impl VSomeipApplication {
         }
     }
 
+    /// Reports whether the provider accepted or rejected the subscriptions of an eventgroup with
+    /// [VSomeipMessage::SubscriptionStatus] messages. Should be called before subscribing.
+    pub fn watch_subscription_status(&self, service_id: ServiceID, instance_id: InstanceID,
+                                     event_group_id: EventGroupID, notifier_id: MethodID)
+    {
+        unsafe {
+            ffi::application_watch_subscription_status(self.app, service_id.id(), instance_id.id(),
+                                                       event_group_id.id(), notifier_id.id(),
+                                                       Some(subscription_status_handler), self.sink_ptr())
+        }
+    }
+
+    /// Stops the [VSomeipMessage::SubscriptionStatus] messages of an eventgroup.
+    pub fn unwatch_subscription_status(&self, service_id: ServiceID, instance_id: InstanceID,
+                                       event_group_id: EventGroupID, notifier_id: MethodID)
+    {
+        unsafe {
+            ffi::application_unwatch_subscription_status(self.app, service_id.id(), instance_id.id(),
+                                                         event_group_id.id(), notifier_id.id())
+        }
+    }
+
+    /// Keeps the last notified value of every offered field in the memory mapped file `path`, which
+    /// holds up to `slots` fields of at most `slot_size` bytes. After a restart the cached values
+    /// are notified as soon as their fields are offered again, so subscribers get initial events
+    /// before the provider has recomputed its state. A value torn by a crash is discarded.
+    /// Fields notified through shared memory ([ShmFrame::notify()]) are not cached,
+    /// their descriptors are not valid after a restart. A field is no longer cached once its offer
+    /// is stopped, see [VSomeipApplication::forget_cached_field()] for removing it from the file.
+    /// Must be called before fields are offered.
+    /// # Return
+    /// Returns false if the file cannot be created or mapped or a cache is already enabled.
+    pub fn enable_field_cache(&self, path: &std::path::Path, slots: u32, slot_size: u32) -> bool {
+        let Some(path) = path.to_str().and_then(|p| CString::new(p).ok()) else {
+            return false;
+        };
+        unsafe {
+            ffi::application_enable_field_cache(self.app, path.as_ptr(), slots, slot_size)
+        }
+    }
+
+    /// Removes the cached value of a field that will not be offered again, e.g. after an update
+    /// dropped it, and frees its slot in the cache file. Stopping the offer of a field only stops
+    /// caching it, its value is kept for the next run.
+    pub fn forget_cached_field(&self, service_id: ServiceID, instance_id: InstanceID, notifier_id: MethodID) {
+        unsafe {
+            ffi::application_forget_cached_field(self.app, service_id.id(), instance_id.id(), notifier_id.id())
+        }
+    }
+
+    /// Enables conflation for notifications of a field (or event).
+    /// Instead of queueing every notification only the latest one is kept in the C++ layer. When a
+    /// new value arrives after the previous one was taken, a [VSomeipMessage::FieldUpdated] message
+    /// is sent and the consumer fetches the value with [VSomeipApplication::take_field()].
+    /// A consumer that falls behind thereby skips stale values.
+    /// # Return
+    /// Returns false if the table of conflated fields is full.
+    pub fn conflate_field(&self, service_id: ServiceID, instance_id: InstanceID, notifier_id: MethodID) -> bool {
+        unsafe {
+            ffi::application_conflate_event(self.app, service_id.id(), instance_id.id(), notifier_id.id(),
+                                            Some(field_dirty_handler), self.sink_ptr())
+        }
+    }
+
+    /// Disables conflation for a field, further notifications are queued individually again.
+    pub fn unconflate_field(&self, service_id: ServiceID, instance_id: InstanceID, notifier_id: MethodID) {
+        unsafe {
+            ffi::application_unconflate_event(self.app, service_id.id(), instance_id.id(), notifier_id.id())
+        }
+    }
+
+    /// Returns the latest notification of a conflated field or `None` if no new value has arrived
+    /// since the last call.
+    /// # Return
+    /// Returns an error if no payload handle is free (`static-memory` feature, counted in
+    /// [PayloadPoolStats::exhausted]). The value is kept and returned by a later call once payloads
+    /// have been dropped, no further [VSomeipMessage::FieldUpdated] is sent for it.
+    pub fn take_field(&self, service_id: ServiceID, instance_id: InstanceID, notifier_id: MethodID)
+        -> Result<Option<MessageType>, ()>
+    {
+        let mut header = std::mem::MaybeUninit::<ffi::message_header>::uninit();
+        let mut exhausted = false;
+        let payload = unsafe {
+            ffi::application_take_conflated(self.app, service_id.id(), instance_id.id(), notifier_id.id(),
+                                            header.as_mut_ptr(), &mut exhausted)
+        };
+        if exhausted {
+            return Err(());
+        }
+        if payload.is_null() {
+            return Ok(None);
+        }
+        Ok(make_message(unsafe { header.assume_init_ref() }, payload))
+    }
+
     /// Updates the data for an event or field and sends a notification if changed or forced.
     pub fn notify(&self, service_id: ServiceID, instance_id: InstanceID, notifier_id: MethodID,
                   payload: &Bytes, force_notification: bool)
@@ -277,6 +1036,47 @@ impl VSomeipApplication {
         }
     }
 
+    /// Publishes several events with one call into the C layer per 32 events.
+    /// Each tuple is `(service, instance, notifier, payload, force_notification)`, the events are
+    /// passed to vsomeip in slice order. Whether they end up in one UDP datagram is decided by
+    /// vsomeip's nPDU configuration (`debounce-time`/`maximum-retention-time` per event).
+    pub fn notify_many(&self, events: &[(ServiceID, InstanceID, MethodID, &Bytes, bool)]) {
+        // the entries are built on the stack, a chunk at a time
+        const CHUNK: usize = 32;
+        let mut entries = [std::mem::MaybeUninit::<ffi::notify_entry>::uninit(); CHUNK];
+        for chunk in events.chunks(CHUNK) {
+            for (entry, (service_id, instance_id, notifier_id, payload, force)) in entries.iter_mut().zip(chunk) {
+                entry.write(ffi::notify_entry {
+                    service: service_id.id(),
+                    instance: instance_id.id(),
+                    notifier: notifier_id.id(),
+                    force: *force,
+                    data: payload.as_ptr(),
+                    data_len: payload.len() as u32,
+                });
+            }
+            unsafe {
+                ffi::application_notify_many(self.app, entries.as_ptr() as *const ffi::notify_entry,
+                                             chunk.len() as u32)
+            }
+        }
+    }
+
+    /// Same as [VSomeipApplication::notify()] but without copying the payload into a vsomeip
+    /// payload first. The `Bytes` object is kept alive until vsomeip has released the payload.
+    /// NOTE: This is not zero-copy. vsomeip copies the data of every notification into the event,
+    ///       only the wrapper's copy is saved. For small payloads the copy is cheaper than the
+    ///       bookkeeping.
+    pub fn notify_owned(&self, service_id: ServiceID, instance_id: InstanceID, notifier_id: MethodID,
+                        payload: Bytes, force_notification: bool)
+    {
+        let (data, len, context) = into_ffi_buffer(payload);
+        unsafe {
+            ffi::application_notify_buffer(self.app, service_id.id(), instance_id.id(), notifier_id.id(),
+                force_notification, data, len, Some(release_ffi_buffer), context)
+        }
+    }
+
     /// Sends a request message.
     /// # Return
     /// Returns the assigned session id. The response (or error) from the provider will carry the
@@ -292,6 +1092,80 @@ impl VSomeipApplication {
         )
     }
 
+    /// Sends a request and returns a future resolving to the payload of its response.
+    /// An ERROR response resolves to its return code, no response within `timeout` to
+    /// [ReturnCode::Timeout] and dropping the application to [ReturnCode::NotReachable].
+    ///
+    /// The response is not delivered to the receiver, it wakes only the task awaiting the future.
+    /// Pending calls are kept in a table indexed by (service, method, session) and their timeouts are
+    /// driven by a single timer wheel, so many calls in flight are cheap. The timeout resolution is
+    /// 10ms.
+    pub fn call(&self, service_id: ServiceID, instance_id: InstanceID, method_id: MethodID,
+                major: MajorVersion, payload: &Bytes, reliable: bool, timeout: Duration)
+        -> impl Future<Output = Result<VSomeipPayload, ReturnCode>>
+    {
+        let reply = self.sink.calls.register(service_id.id(), method_id.id(), timeout, || {
+            self.send_request(service_id, instance_id, method_id, major, payload, reliable).id()
+        });
+        async move {
+            reply.await.unwrap_or(Err(ReturnCode::NotReachable))
+        }
+    }
+
+    /// Sends the same request to several (instance, method) targets of a service and returns a
+    /// future resolving to their results, in the order of `targets`, like [VSomeipApplication::call()].
+    ///
+    /// All requests are sent with one call into the C++ layer and share one deadline, so the future
+    /// resolves after the slowest response, at the latest `timeout` after sending.
+    pub fn call_many(&self, service_id: ServiceID, targets: &[(InstanceID, MethodID)], major: MajorVersion,
+                     payload: &Bytes, reliable: bool, timeout: Duration)
+        -> impl Future<Output = Vec<Result<VSomeipPayload, ReturnCode>>>
+    {
+        let ffi_targets: Vec<ffi::request_target> = targets.iter()
+            .map(|(instance_id, method_id)| ffi::request_target { instance: instance_id.id(), method: method_id.id() })
+            .collect();
+        let methods: Vec<u16> = targets.iter().map(|(_, method_id)| method_id.id()).collect();
+        let replies = self.sink.calls.register_many(service_id.id(), &methods, timeout, |sessions| {
+            unsafe {
+                ffi::application_send_requests(self.app, service_id.id(), ffi_targets.as_ptr(),
+                                               ffi_targets.len() as u32, major.id(), reliable,
+                                               payload.as_ptr(), payload.len() as u32, sessions.as_mut_ptr())
+            }
+        });
+        async move {
+            let mut results = Vec::with_capacity(replies.len());
+            // all requests are in flight already, awaiting them in order costs no extra round trips
+            for reply in replies {
+                results.push(reply.await.unwrap_or(Err(ReturnCode::NotReachable)));
+            }
+            results
+        }
+    }
+
+    /// Creates a template for requests to a fixed service method.
+    /// Sending a request with [VSomeipApplication::send_with()] then only replaces the payload data
+    /// of the pre-built message instead of building a new message for every request.
+    pub fn create_request_template(&self, service_id: ServiceID, instance_id: InstanceID, method_id: MethodID,
+                                   major: MajorVersion, reliable: bool) -> Option<MessageTemplate>
+    {
+        let msg = unsafe {
+            ffi::application_create_request_template(self.app, service_id.id(), instance_id.id(),
+                                                     method_id.id(), major.id(), reliable)
+        };
+        if msg.is_null() { None } else { Some(MessageTemplate { msg }) }
+    }
+
+    /// Sends a request built from a template with the given payload.
+    /// # Return
+    /// Returns the assigned session id, see [VSomeipApplication::send_request()].
+    pub fn send_with(&self, template: &mut MessageTemplate, payload: &Bytes) -> SessionID {
+        SessionID::from(
+            unsafe {
+                ffi::application_send_with(self.app, template.msg, payload.as_ptr(), payload.len() as u32)
+            }
+        )
+    }
+
     /// Sends a response message.
     /// # Argument
     /// - source_request        The message header of the linked request.
@@ -327,21 +1201,44 @@ impl VSomeipApplication {
                                         return_code_to_ffi(return_code));
         }
     }
+
+    /// Returns the statistics of the application's payload handle pool.
+    pub fn payload_pool_stats(&self) -> PayloadPoolStats {
+        let stats = unsafe { ffi::application_payload_pool_stats(self.app) };
+        PayloadPoolStats {
+            hits: stats.hits,
+            misses: stats.misses,
+            exhausted: stats.exhausted,
+            available: stats.available,
+            outstanding: stats.outstanding,
+        }
+    }
+}
+
+/// Target object of the vsomeip callbacks: the sink for received messages and the pending
+/// calls which intercept the responses.
+struct MessageTarget {
+    sink: MessageSink,
+    calls: Arc<PendingCalls>,
+}
+
+impl MessageTarget {
+    fn send(&self, msg: VSomeipMessage) {
+        self.sink.send(msg)
+    }
 }
 
 macro_rules! to_sender {
     ($target:ident) => {
-        ($target as *mut UnboundedSender<VSomeipMessage>).as_ref().unwrap()
+        ($target as *const MessageTarget).as_ref().unwrap()
     };
 }
 
 extern "C"
 fn state_handler(state: ffi::state_type_ce, target: *const std::os::raw::c_void) {
     unsafe {
-        // TODO how to react on failed transmission?
-        // -> unwrap() ==> panic
         to_sender!(target).send(
-            VSomeipMessage::RegistrationState( state == ffi::state_type_ce_REGISTERED)).unwrap();
+            VSomeipMessage::RegistrationState( state == ffi::state_type_ce_REGISTERED));
     }
 }
 
@@ -349,14 +1246,103 @@ extern "C"
 fn avail_handler(svc_id: u16,
                  inst_id: u16,
                  avail: ffi::availability_state_e,
-                 target: *const std::os::raw::c_void)
+                 targets: *const std::os::raw::c_void)
+{
+    let targets = unsafe { (targets as *const RequestTargets).as_ref().unwrap() };
+    targets.report(svc_id, inst_id, avail == ffi::availability_state_e_AS_AVAILABLE)
+}
+
+extern "C"
+fn provider_role_handler(svc_id: u16,
+                         inst_id: u16,
+                         role: ffi::provider_role_e,
+                         target: *const std::os::raw::c_void)
 {
     unsafe {
-        // TODO how to react on failed transmission?
-        // -> unwrap() ==> panic
         to_sender!(target).send(
-    VSomeipMessage::ServiceAvailability { service_id: svc_id, instance_id: inst_id,
-                avail : avail == ffi::availability_state_e_AS_AVAILABLE }).unwrap()
+            VSomeipMessage::ProviderRole { service_id: svc_id, instance_id: inst_id,
+                active: role == ffi::provider_role_e_PR_ACTIVE })
+    }
+}
+
+extern "C"
+fn release_target(target: *const std::os::raw::c_void) {
+    drop(unsafe { Arc::from_raw(target as *const MessageTarget) })
+}
+
+extern "C"
+fn release_request(targets: *const std::os::raw::c_void) {
+    drop(unsafe { Arc::from_raw(targets as *const RequestTargets) })
+}
+
+extern "C"
+fn subscription_handler(svc_id: u16,
+                        inst_id: u16,
+                        eventgroup_id: u16,
+                        client_id: u16,
+                        subscribed: bool,
+                        target: *const std::os::raw::c_void)
+{
+    unsafe {
+        to_sender!(target).send(
+            VSomeipMessage::Subscription { service_id: svc_id, instance_id: inst_id, eventgroup_id, client_id,
+                subscribed })
+    }
+}
+
+extern "C"
+fn subscription_status_handler(svc_id: u16,
+                               inst_id: u16,
+                               eventgroup_id: u16,
+                               notifier_id: u16,
+                               accepted: bool,
+                               target: *const std::os::raw::c_void)
+{
+    unsafe {
+        to_sender!(target).send(
+            VSomeipMessage::SubscriptionStatus { service_id: svc_id, instance_id: inst_id, eventgroup_id,
+                notifier_id, accepted })
+    }
+}
+
+extern "C"
+fn batch_ready_handler(target: *const std::os::raw::c_void) {
+    unsafe {
+        (target as *const Notify).as_ref().unwrap().notify_one()
+    }
+}
+
+extern "C"
+fn field_dirty_handler(svc_id: u16, inst_id: u16, notifier_id: u16, target: *const std::os::raw::c_void) {
+    unsafe {
+        to_sender!(target).send(
+            VSomeipMessage::FieldUpdated { service_id: svc_id, instance_id: inst_id, notifier_id })
+    }
+}
+
+extern "C"
+fn epsilon_change_handler(old_data: *const u8, old_len: u32, new_data: *const u8, new_len: u32,
+                          context: *const std::os::raw::c_void) -> bool
+{
+    unsafe fn as_slice<'a>(data: *const u8, len: u32) -> &'a [u8] {
+        if data.is_null() || len == 0 { &[] } else { std::slice::from_raw_parts(data, len as usize) }
+    }
+    unsafe {
+        let epsilon = (context as *const Box<EpsilonChange>).as_ref().unwrap();
+        epsilon(as_slice(old_data, old_len), as_slice(new_data, new_len))
+    }
+}
+
+extern "C"
+fn release_epsilon(context: *const std::os::raw::c_void) {
+    drop(unsafe { Arc::from_raw(context as *const Box<EpsilonChange>) })
+}
+
+extern "C"
+fn message_filter_handler(header: *const ffi::message_header, context: *const std::os::raw::c_void) -> bool {
+    unsafe {
+        let filter = (context as *const Box<MessageFilter>).as_ref().unwrap();
+        filter(&make_header(&*header))
     }
 }
 
@@ -369,11 +1355,16 @@ fn make_header(hdr: &ffi::message_header) -> MessageHeader {
         session_id: SessionID::from(hdr.session),
         interface_version: InterfaceVersion::make_major(hdr.if_version),
         reliable: hdr.is_reliable,
+        trace: (hdr.received_ns != 0).then_some(MessageTrace {
+            received_ns: hdr.received_ns,
+            handoff_ns: hdr.handoff_ns,
+            ..MessageTrace::default()
+        }),
     }
 }
 
-fn map_return_code(rt: ffi::return_code) -> ReturnCode {
-    match rt {
+fn map_return_code(rt: u8) -> ReturnCode {
+    match rt as ffi::return_code {
         ffi::return_code_E_OK => ReturnCode::Ok,
         ffi::return_code_E_NOT_OK => ReturnCode::NotOk,
         ffi::return_code_E_UNKNOWN_SERVICE => ReturnCode::UnknownService,
@@ -407,16 +1398,13 @@ fn return_code_to_ffi(rc: ReturnCode) -> ffi::return_code {
     }
 }
 
-extern "C"
-fn message_handler2(
-    msg_header: ffi::message_header,
-    payload: ffi::payload_t,
-    target: *const std::os::raw::c_void)
-{
-    let data = VSomeipPayload::from(payload);
-    let header = make_header(&msg_header);
+/// Builds the message from the FFI header, takes ownership of `payload`.
+/// Returns `None` for message types that are not forwarded to the application.
+fn make_message(msg_header: &ffi::message_header, payload: ffi::payload_t) -> Option<MessageType> {
+    let data = VSomeipPayload::with_header_data(payload, msg_header);
+    let header = make_header(msg_header);
 
-    let msg = match msg_header.message_type {
+    let msg = match msg_header.message_type as ffi::message_type {
         ffi::message_type_MT_REQUEST => MessageType::Request {header, data},
         ffi::message_type_MT_REQUEST_NO_RETURN => MessageType::RequestNoReturn {header, data},
         ffi::message_type_MT_NOTIFICATION => MessageType::Notification {header, data,
@@ -427,46 +1415,88 @@ fn message_handler2(
 
         // the following vsomeip message types shouldn't be sent upstream from libvsomeip
         // so we ignore them
-        ffi::message_type_MT_REQUEST_ACK => { return /* ignored */ },
-        ffi::message_type_MT_REQUEST_NO_RETURN_ACK => { return /* ignored */ },
-        ffi::message_type_MT_NOTIFICATION_ACK => { return /* ignored */ },
-        ffi::message_type_MT_RESPONSE_ACK => { return /* ignored */ },
-        ffi::message_type_MT_ERROR_ACK => { return /* ignored */ },
-        ffi::message_type_MT_UNKNOWN => { return /* ignored */ },
+        ffi::message_type_MT_REQUEST_ACK => { return None /* ignored */ },
+        ffi::message_type_MT_REQUEST_NO_RETURN_ACK => { return None /* ignored */ },
+        ffi::message_type_MT_NOTIFICATION_ACK => { return None /* ignored */ },
+        ffi::message_type_MT_RESPONSE_ACK => { return None /* ignored */ },
+        ffi::message_type_MT_ERROR_ACK => { return None /* ignored */ },
+        ffi::message_type_MT_UNKNOWN => { return None /* ignored */ },
 
         // an unknown vsomeip message type usually indicates that vsomeip is in an undefined
         // state, or we have linked to an unsupported vsomeip version.
         val => { panic!("Unknown message type from vsomeip {}", val)}
     };
+    Some(msg)
+}
 
-    unsafe {
-        // TODO how to react on failed transmission?
-        // -> unwrap() ==> panic
-        to_sender!(target).send(VSomeipMessage::Message(msg)).unwrap()
+extern "C"
+fn message_handler2(
+    msg_header: *const ffi::message_header,
+    payload: ffi::payload_t,
+    target: *const std::os::raw::c_void)
+{
+    let (target, msg_header) = unsafe { (to_sender!(target), &*msg_header) };
+    if let Some(mut msg) = make_message(msg_header, payload).and_then(|msg| target.calls.complete(msg)) {
+        if let Some(trace) = msg.header_mut().trace.as_mut() {
+            trace.enqueued_ns = trace::now_ns();
+        }
+        target.send(VSomeipMessage::Message(msg))
     }
 }
 
+/// Pre-built request message, see [VSomeipApplication::create_request_template()].
+/// A template carries the session of its last request, so it must not be used by several
+/// senders at the same time (which [VSomeipApplication::send_with()] ensures by taking it mutably).
+pub struct MessageTemplate {
+    msg: ffi::message_t,
+}
+
+impl Drop for MessageTemplate {
+    fn drop(&mut self) {
+        unsafe { ffi::message_destroy(self.msg) }
+    }
+}
+
+unsafe impl Send for MessageTemplate {}
+
 /// Encapsulation of a vsomeip::payload object.
 pub struct VSomeipPayload {
     payload: ffi::payload_t,
-    bytes: Bytes
+    /// view of the payload data, taken from the message header or resolved on first access
+    bytes: OnceLock<Bytes>,
 }
 
 impl Drop for VSomeipPayload {
     fn drop(&mut self) {
-        unsafe { ffi::payload_destroy(self.payload) }
+        if !self.payload.is_null() {
+            unsafe { ffi::payload_destroy(self.payload) }
+        }
     }
 }
 
 impl From<ffi::payload_t> for VSomeipPayload {
     fn from(value: ffi::payload_t) -> Self {
-        Self{ payload: value, bytes: payload_to_bytes(value) }
+        Self{ payload: value, bytes: OnceLock::new() }
+    }
+}
+
+impl VSomeipPayload {
+    /// Wraps the payload of a received message, whose data the C++ side has put into its header.
+    fn with_header_data(payload: ffi::payload_t, hdr: &ffi::message_header) -> Self {
+        let bytes = if hdr.data == 0 || hdr.data_size == 0 {
+            Bytes::new()
+        } else {
+            // the data lives as long as the payload, which this object owns
+            unsafe { Bytes::from_static(std::slice::from_raw_parts(hdr.data as usize as *const u8,
+                                                                    hdr.data_size as usize)) }
+        };
+        Self{ payload, bytes: OnceLock::from(bytes) }
     }
 }
 
 impl Debug for VSomeipPayload {
     fn fmt(&self, f: &mut Formatter<'_>) -> std::fmt::Result {
-        write!(f, "{:?}", self.bytes)
+        write!(f, "{:?}", self.as_bytes_ref())
     }
 }
 
@@ -478,10 +1508,30 @@ impl VSomeipPayload {
 
     /// Returns the data within the payload as `Bytes` reference.
     /// NOTE: This involves no copying, but the reference's lifetime is bound to the
-    /// VSomeipPayload object.
+    /// VSomeipPayload object. Received payloads carry their data in the message header, so this
+    /// costs no call into the C++ layer.
     pub fn as_bytes_ref(&self) -> &Bytes  {
-        &self.bytes
+        self.bytes.get_or_init(|| payload_to_bytes(self.payload))
     }
+
+    /// Decodes the SOME/IP serialized payload, see [codec]. Strings and byte arrays of the result
+    /// borrow from the payload.
+    pub fn decode<'a, T: codec::SomeIpDeserialize<'a>>(&'a self) -> Result<T, codec::DecodeError> {
+        codec::decode(self.as_bytes_ref())
+    }
+}
+
+/// Moves `payload` to the heap so that the C++ side can refer to its data until it calls
+/// [release_ffi_buffer()] with the returned context.
+fn into_ffi_buffer(payload: Bytes) -> (*const u8, u32, *mut std::os::raw::c_void) {
+    let data = payload.as_ptr();
+    let len = payload.len() as u32;
+    (data, len, Box::into_raw(Box::new(payload)) as *mut std::os::raw::c_void)
+}
+
+extern "C"
+fn release_ffi_buffer(context: *mut std::os::raw::c_void) {
+    drop(unsafe { Box::from_raw(context as *mut Bytes) })
 }
 
 fn payload_to_bytes(payload: ffi::payload_t) -> Bytes {
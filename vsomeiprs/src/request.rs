@@ -0,0 +1,162 @@
+// SPDX-License-Identifier: MPL-2.0
+//
+// Copyright (C) 2024 Alexander Seifarth
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+use std::collections::HashMap;
+use std::sync::{Arc, Mutex};
+use super::{MessageTarget, VSomeipMessage};
+
+/// Service, instance and major version of a requested service.
+pub(crate) type RequestKey = (u16, u16, u8);
+
+/// The targets the availability of a requested service instance is reported to.
+/// A target is listed once per request it made.
+pub(crate) struct RequestTargets {
+    state: Mutex<(Vec<Arc<MessageTarget>>, Option<bool>)>,
+}
+
+impl RequestTargets {
+    /// Reports the availability to every target, the targets are sent to without the list locked.
+    pub(crate) fn report(&self, service_id: u16, instance_id: u16, avail: bool) {
+        let targets = {
+            let mut state = self.state.lock().unwrap();
+            state.1 = Some(avail);
+            state.0.clone()
+        };
+        for target in targets {
+            target.send(VSomeipMessage::ServiceAvailability { service_id, instance_id, avail });
+        }
+    }
+}
+
+/// The service requests of an application.
+///
+/// vsomeip keeps one request and one availability handler per service instance, so requests of the
+/// same instance from several targets share them: the service is requested with the first request
+/// and released with the last one, availability is reported to all requesters.
+pub(crate) struct ServiceRequests {
+    requests: Mutex<HashMap<RequestKey, Arc<RequestTargets>>>,
+}
+
+impl ServiceRequests {
+    pub(crate) fn new() -> Self {
+        ServiceRequests { requests: Mutex::new(HashMap::new()) }
+    }
+
+    /// Adds a request of `target`. For the first request of the instance `request` is invoked with
+    /// the table locked to request the service and register its availability handler. A later
+    /// requester gets the last reported availability.
+    pub(crate) fn add(&self, key: RequestKey, target: &Arc<MessageTarget>, request: impl FnOnce(&Arc<RequestTargets>)) {
+        let mut requests = self.requests.lock().unwrap();
+        if let Some(targets) = requests.get(&key) {
+            let avail = {
+                let mut state = targets.state.lock().unwrap();
+                state.0.push(target.clone());
+                state.1
+            };
+            drop(requests);
+            if let Some(avail) = avail {
+                target.send(VSomeipMessage::ServiceAvailability { service_id: key.0, instance_id: key.1, avail });
+            }
+            return;
+        }
+        let targets = Arc::new(RequestTargets { state: Mutex::new((vec![target.clone()], None)) });
+        request(&targets);
+        requests.insert(key, targets);
+    }
+
+    /// Removes one request of `target`. For the last request of the instance `release` is invoked
+    /// with the table locked to release the service.
+    /// Returns false if `target` has not requested the instance.
+    pub(crate) fn remove(&self, key: RequestKey, target: &Arc<MessageTarget>, release: impl FnOnce()) -> bool {
+        let mut requests = self.requests.lock().unwrap();
+        let Some(targets) = requests.get(&key) else {
+            return false;
+        };
+        let last = {
+            let mut state = targets.state.lock().unwrap();
+            let Some(pos) = state.0.iter().position(|t| Arc::ptr_eq(t, target)) else {
+                return false;
+            };
+            state.0.swap_remove(pos);
+            state.0.is_empty()
+        };
+        if last {
+            requests.remove(&key);
+            release();
+        }
+        true
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use super::*;
+    use tokio::sync::mpsc::{unbounded_channel, UnboundedReceiver};
+    use crate::call::PendingCalls;
+    use crate::channel::MessageSink;
+
+    fn target() -> (Arc<MessageTarget>, UnboundedReceiver<VSomeipMessage>) {
+        let (sender, receiver) = unbounded_channel();
+        (Arc::new(MessageTarget { sink: MessageSink::Unbounded(sender), calls: PendingCalls::new() }), receiver)
+    }
+
+    fn avail(receiver: &mut UnboundedReceiver<VSomeipMessage>) -> Option<bool> {
+        match receiver.try_recv() {
+            Ok(VSomeipMessage::ServiceAvailability { service_id: 0x1234, instance_id: 1, avail }) => Some(avail),
+            Ok(msg) => panic!("unexpected message {:?}", msg),
+            Err(_) => None,
+        }
+    }
+
+    #[test]
+    fn two_components_test() {
+        let requests = ServiceRequests::new();
+        let key = (0x1234, 1, 1);
+        let (first, mut first_rx) = target();
+        let (second, mut second_rx) = target();
+
+        let mut handler = None;
+        requests.add(key, &first, |targets| handler = Some(targets.clone()));
+        let handler = handler.expect("first request registers");
+        handler.report(0x1234, 1, true);
+        assert_eq!(avail(&mut first_rx), Some(true));
+
+        // the second requester shares the request and gets the current availability
+        requests.add(key, &second, |_| panic!("second request registers again"));
+        assert_eq!(avail(&mut second_rx), Some(true));
+        handler.report(0x1234, 1, false);
+        assert_eq!(avail(&mut first_rx), Some(false));
+        assert_eq!(avail(&mut second_rx), Some(false));
+
+        // releasing one keeps the service requested for the other
+        assert!(requests.remove(key, &first, || panic!("released with a requester left")));
+        assert!(!requests.remove(key, &first, || panic!("released twice")));
+        handler.report(0x1234, 1, true);
+        assert_eq!(avail(&mut first_rx), None);
+        assert_eq!(avail(&mut second_rx), Some(true));
+
+        let mut released = false;
+        assert!(requests.remove(key, &second, || released = true));
+        assert!(released);
+        assert!(!requests.remove(key, &second, || panic!("released twice")));
+    }
+
+    #[test]
+    fn repeated_request_test() {
+        let requests = ServiceRequests::new();
+        let key = (0x1234, 1, 1);
+        let (first, _first_rx) = target();
+        let mut registered = 0;
+        requests.add(key, &first, |_| registered += 1);
+        requests.add(key, &first, |_| registered += 1);
+        assert_eq!(registered, 1);
+        assert!(requests.remove(key, &first, || panic!("released with a request left")));
+        let mut released = false;
+        assert!(requests.remove(key, &first, || released = true));
+        assert!(released);
+    }
+}
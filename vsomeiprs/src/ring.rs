@@ -0,0 +1,328 @@
+// SPDX-License-Identifier: MPL-2.0
+//
+// Copyright (C) 2024 Alexander Seifarth
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+use std::cell::UnsafeCell;
+use std::mem::MaybeUninit;
+use std::ops::Deref;
+use std::sync::Arc;
+use std::sync::atomic::{fence, AtomicBool, AtomicU64, AtomicUsize, Ordering};
+use std::time::Duration;
+use tokio::sync::Notify;
+use super::channel::{is_control, stamp_dequeued, ChannelStats, OverflowPolicy};
+use super::trace::TraceRing;
+use super::VSomeipMessage;
+
+/// Keeps the producer and the consumer state on cache lines of their own.
+#[repr(align(64))]
+struct CachePadded<T>(T);
+
+impl<T> Deref for CachePadded<T> {
+    type Target = T;
+    fn deref(&self) -> &T {
+        &self.0
+    }
+}
+
+struct Producer {
+    /// index of the next slot to write
+    tail: AtomicUsize,
+    /// last seen `Consumer::head`, only accessed while `busy` is held
+    head: UnsafeCell<usize>,
+    /// held while a message is written
+    busy: AtomicBool,
+}
+
+struct Consumer {
+    /// index of the next slot to read
+    head: AtomicUsize,
+    /// last seen `Producer::tail`, only accessed by the receiver
+    tail: UnsafeCell<usize>,
+}
+
+/// Lock free single-producer/single-consumer ring of received messages.
+///
+/// The producer is the vsomeip dispatcher. vsomeip may start additional dispatcher threads when a
+/// handler blocks, so producers are serialized by a flag which is uncontended in the common case.
+/// The consumer is the one [crate::VSomeipReceiver] owning the ring. The consumer is only woken up
+/// when the ring turns from empty to non-empty, a burst of messages costs a single wakeup.
+///
+/// Only [OverflowPolicy::Block] and [OverflowPolicy::DropNewest] are supported. Registration and
+/// availability messages are never dropped, the producer waits for room instead.
+pub(crate) struct SpscRing {
+    producer: CachePadded<Producer>,
+    consumer: CachePadded<Consumer>,
+    slots: Box<[UnsafeCell<MaybeUninit<VSomeipMessage>>]>,
+    mask: usize,
+    policy: OverflowPolicy,
+    pub(crate) notify: Notify,
+    sender_alive: AtomicBool,
+    receiver_alive: AtomicBool,
+    dropped_newest: AtomicU64,
+    blocked: AtomicU64,
+    high_water: AtomicU64,
+    pub(crate) traces: TraceRing,
+}
+
+unsafe impl Send for SpscRing {}
+unsafe impl Sync for SpscRing {}
+
+struct ProducerGuard<'a>(&'a AtomicBool);
+
+impl Drop for ProducerGuard<'_> {
+    fn drop(&mut self) {
+        self.0.store(false, Ordering::Release);
+    }
+}
+
+impl SpscRing {
+    /// Creates a ring of at least `capacity` slots (rounded up to a power of two).
+    /// Fails for an overflow policy other than [OverflowPolicy::Block] and [OverflowPolicy::DropNewest].
+    pub(crate) fn new(capacity: usize, policy: OverflowPolicy) -> Result<Arc<Self>, ()> {
+        assert!(capacity > 0, "queue capacity must not be zero");
+        if !matches!(policy, OverflowPolicy::Block | OverflowPolicy::DropNewest) {
+            return Err(());
+        }
+        let capacity = capacity.next_power_of_two();
+        Ok(Arc::new(SpscRing {
+            producer: CachePadded(Producer { tail: AtomicUsize::new(0), head: UnsafeCell::new(0),
+                                             busy: AtomicBool::new(false) }),
+            consumer: CachePadded(Consumer { head: AtomicUsize::new(0), tail: UnsafeCell::new(0) }),
+            slots: (0..capacity).map(|_| UnsafeCell::new(MaybeUninit::uninit())).collect(),
+            mask: capacity - 1,
+            policy,
+            notify: Notify::new(),
+            sender_alive: AtomicBool::new(true),
+            receiver_alive: AtomicBool::new(true),
+            dropped_newest: AtomicU64::new(0),
+            blocked: AtomicU64::new(0),
+            high_water: AtomicU64::new(0),
+            traces: TraceRing::new(),
+        }))
+    }
+
+    fn lock_producer(&self) -> ProducerGuard<'_> {
+        // the holder may be waiting for room in a full ring, so only spin briefly
+        let mut backoff = 0u32;
+        while self.producer.busy.swap(true, Ordering::Acquire) {
+            if backoff < 16 {
+                std::hint::spin_loop();
+            } else if backoff < 80 {
+                std::thread::yield_now();
+            } else {
+                std::thread::sleep(Duration::from_micros(50));
+            }
+            backoff = backoff.saturating_add(1);
+        }
+        ProducerGuard(&self.producer.busy)
+    }
+
+    pub(crate) fn push(&self, msg: VSomeipMessage) {
+        if !self.receiver_alive.load(Ordering::Relaxed) {
+            return;
+        }
+        let _guard = self.lock_producer();
+        let cached_head = unsafe { &mut *self.producer.head.get() };
+        let tail = self.producer.tail.load(Ordering::Relaxed);
+        if tail - *cached_head > self.mask {
+            *cached_head = self.consumer.head.load(Ordering::Acquire);
+            if tail - *cached_head > self.mask {
+                if self.policy == OverflowPolicy::DropNewest && !is_control(&msg) {
+                    self.dropped_newest.fetch_add(1, Ordering::Relaxed);
+                    return;
+                }
+                self.blocked.fetch_add(1, Ordering::Relaxed);
+                let mut backoff = 0u32;
+                while tail - *cached_head > self.mask {
+                    if !self.receiver_alive.load(Ordering::Relaxed) {
+                        return;
+                    }
+                    if backoff < 64 {
+                        backoff += 1;
+                        std::thread::yield_now();
+                    } else {
+                        std::thread::sleep(Duration::from_micros(50));
+                    }
+                    *cached_head = self.consumer.head.load(Ordering::Acquire);
+                }
+            }
+        }
+        unsafe { (*self.slots[tail & self.mask].get()).write(msg); }
+        self.producer.tail.store(tail + 1, Ordering::Release);
+        self.high_water.fetch_max((tail + 1 - *cached_head) as u64, Ordering::Relaxed);
+
+        // pairs with the fence in pop(): either the consumer sees the new message or the producer
+        // sees that the consumer emptied the ring and may be about to wait
+        fence(Ordering::SeqCst);
+        *cached_head = self.consumer.head.load(Ordering::Relaxed);
+        if *cached_head == tail {
+            self.notify.notify_one();
+        }
+    }
+
+    /// Takes the next message. Must only be called by the receiver owning the ring.
+    pub(crate) fn pop(&self) -> Option<VSomeipMessage> {
+        let cached_tail = unsafe { &mut *self.consumer.tail.get() };
+        let head = self.consumer.head.load(Ordering::Relaxed);
+        if head == *cached_tail {
+            fence(Ordering::SeqCst);
+            *cached_tail = self.producer.tail.load(Ordering::Acquire);
+            if head == *cached_tail {
+                return None;
+            }
+        }
+        let mut msg = unsafe { (*self.slots[head & self.mask].get()).assume_init_read() };
+        self.consumer.head.store(head + 1, Ordering::Release);
+        stamp_dequeued(&mut msg, &self.traces);
+        Some(msg)
+    }
+
+    pub(crate) fn is_sender_alive(&self) -> bool {
+        self.sender_alive.load(Ordering::Acquire)
+    }
+
+    pub(crate) fn len(&self) -> usize {
+        let head = self.consumer.head.load(Ordering::Acquire);
+        self.producer.tail.load(Ordering::Acquire).saturating_sub(head)
+    }
+
+    pub(crate) fn stats(&self) -> ChannelStats {
+        ChannelStats {
+            dropped_newest: self.dropped_newest.load(Ordering::Relaxed),
+            blocked: self.blocked.load(Ordering::Relaxed),
+            high_water: self.high_water.load(Ordering::Relaxed),
+            ..ChannelStats::default()
+        }
+    }
+
+    pub(crate) fn close_sender(&self) {
+        self.sender_alive.store(false, Ordering::Release);
+        self.notify.notify_one();
+    }
+
+    /// Drops the queued messages. Must only be called by the receiver owning the ring.
+    pub(crate) fn close_receiver(&self) {
+        self.receiver_alive.store(false, Ordering::Relaxed);
+        while self.pop().is_some() {}
+    }
+}
+
+impl Drop for SpscRing {
+    fn drop(&mut self) {
+        // messages pushed after the receiver was closed
+        let tail = *self.producer.0.tail.get_mut();
+        for idx in *self.consumer.0.head.get_mut()..tail {
+            unsafe { self.slots[idx & self.mask].get_mut().assume_init_drop() }
+        }
+    }
+}
+
+/// The producer side of a ring, owned by the application.
+pub(crate) struct RingSender(pub(crate) Arc<SpscRing>);
+
+impl Drop for RingSender {
+    fn drop(&mut self) {
+        self.0.close_sender()
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use super::*;
+    use crate::channel::test::{notification, session_of};
+
+    #[test]
+    fn unsupported_policy_test() {
+        assert!(SpscRing::new(4, OverflowPolicy::DropOldest).is_err());
+        assert!(SpscRing::new(4, OverflowPolicy::CoalesceFields).is_err());
+    }
+
+    #[test]
+    fn drop_newest_test() {
+        let ring = SpscRing::new(2, OverflowPolicy::DropNewest).unwrap();
+        ring.push(VSomeipMessage::RegistrationState(true));
+        ring.push(notification(1, 1));
+        ring.push(notification(1, 2));
+        assert_eq!(ring.len(), 2);
+        assert!(matches!(ring.pop(), Some(VSomeipMessage::RegistrationState(true))));
+        assert_eq!(session_of(ring.pop()), (1, 1));
+        assert!(ring.pop().is_none());
+        assert_eq!(ring.stats().dropped_newest, 1);
+        assert_eq!(ring.stats().high_water, 2);
+    }
+
+    #[test]
+    fn capacity_rounding_test() {
+        let ring = SpscRing::new(3, OverflowPolicy::DropNewest).unwrap();
+        for session in 0..5 {
+            ring.push(notification(1, session));
+        }
+        assert_eq!(ring.len(), 4);
+        assert_eq!(ring.stats().dropped_newest, 1);
+    }
+
+    #[test]
+    fn block_test() {
+        let ring = SpscRing::new(4, OverflowPolicy::Block).unwrap();
+        let producer = {
+            let ring = ring.clone();
+            std::thread::spawn(move || {
+                for session in 0..1000 {
+                    ring.push(notification(1, session));
+                }
+            })
+        };
+        let mut next = 0;
+        while next < 1000 {
+            if let Some(msg) = ring.pop() {
+                assert_eq!(session_of(Some(msg)), (1, next));
+                next += 1;
+            }
+        }
+        producer.join().unwrap();
+        assert!(ring.pop().is_none());
+    }
+
+    #[tokio::test]
+    async fn wakeup_test() {
+        let ring = SpscRing::new(8, OverflowPolicy::Block).unwrap();
+        let producer = {
+            let ring = ring.clone();
+            std::thread::spawn(move || {
+                for session in 0..100 {
+                    ring.push(notification(1, session));
+                }
+                drop(RingSender(ring));
+            })
+        };
+        let mut received = 0;
+        loop {
+            if let Some(_) = ring.pop() {
+                received += 1;
+                continue;
+            }
+            if !ring.is_sender_alive() {
+                while ring.pop().is_some() {
+                    received += 1;
+                }
+                break;
+            }
+            ring.notify.notified().await;
+        }
+        producer.join().unwrap();
+        assert_eq!(received, 100);
+    }
+
+    #[test]
+    fn drop_queued_test() {
+        let ring = SpscRing::new(4, OverflowPolicy::Block).unwrap();
+        ring.push(notification(1, 1));
+        ring.push(notification(1, 2));
+        ring.close_receiver();
+        ring.push(notification(1, 3));
+        assert_eq!(ring.len(), 0);
+    }
+}
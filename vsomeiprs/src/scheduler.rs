@@ -0,0 +1,204 @@
+// SPDX-License-Identifier: MPL-2.0
+//
+// Copyright (C) 2024 Alexander Seifarth
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+use std::sync::{Arc, Condvar, Mutex, MutexGuard};
+use std::thread::JoinHandle;
+use std::time::{Duration, Instant};
+use bytes::Bytes;
+use super::{CyclicID, InstanceID, MethodID, ServiceID, VSomeipApplication};
+
+type Producer = Box<dyn FnMut() -> Option<Bytes> + Send>;
+type Publisher = Box<dyn FnMut(&[(ServiceID, InstanceID, MethodID, &Bytes, bool)]) + Send>;
+
+struct Entry {
+    id: CyclicID,
+    service_id: ServiceID,
+    instance_id: InstanceID,
+    notifier_id: MethodID,
+    /// period in ticks
+    period: u64,
+    force: bool,
+    producer: Producer,
+}
+
+struct State {
+    entries: Vec<Entry>,
+    next_id: u64,
+    running: bool,
+}
+
+struct Shared {
+    state: Mutex<State>,
+    changed: Condvar,
+}
+
+/// Publishes cyclic events of a provider from one timer.
+///
+/// Each event is registered with a period and a closure producing its payload. Periods are rounded
+/// to multiples of the scheduler's tick and all events are aligned to the same tick grid: an event
+/// with period `p` ticks is due on every tick divisible by `p`, so events with commensurate periods
+/// are notified together. The timer thread only wakes up on ticks where some event is due and
+/// publishes all due events with one [VSomeipApplication::notify_many()] call. Ticks are counted
+/// from the creation of the scheduler and do not drift; ticks missed because the thread was
+/// delayed are skipped, not replayed.
+///
+/// Producers run on the scheduler thread. They return `None` to skip the event in a cycle and
+/// must not call back into the scheduler.
+pub struct CyclicScheduler {
+    shared: Arc<Shared>,
+    tick: Duration,
+    thread: Option<JoinHandle<()>>,
+}
+
+impl Drop for CyclicScheduler {
+    fn drop(&mut self) {
+        self.lock().running = false;
+        self.shared.changed.notify_one();
+        if let Some(thread) = self.thread.take() {
+            let _ = thread.join();
+        }
+    }
+}
+
+/// Returns the first tick after `after` on which an event of one of the `periods` is due.
+fn next_due(after: u64, periods: impl Iterator<Item = u64>) -> Option<u64> {
+    periods.map(|p| (after / p + 1) * p).min()
+}
+
+impl CyclicScheduler {
+    /// Creates a scheduler publishing through `app` on a grid of `tick`.
+    pub fn new(app: Arc<VSomeipApplication>, tick: Duration) -> Self {
+        Self::with_publisher(tick, Box::new(move |events| app.notify_many(events)))
+    }
+
+    fn with_publisher(tick: Duration, publish: Publisher) -> Self {
+        assert!(!tick.is_zero(), "scheduler tick must not be zero");
+        let shared = Arc::new(Shared {
+            state: Mutex::new(State { entries: Vec::new(), next_id: 1, running: true }),
+            changed: Condvar::new(),
+        });
+        let thread = {
+            let shared = shared.clone();
+            std::thread::Builder::new()
+                .name("vsomeiprs-cyclic".to_string())
+                .spawn(move || run(&shared, tick, publish))
+                .expect("cannot start scheduler thread")
+        };
+        CyclicScheduler { shared, tick, thread: Some(thread) }
+    }
+
+    fn lock(&self) -> MutexGuard<'_, State> {
+        self.shared.state.lock().unwrap_or_else(|e| e.into_inner())
+    }
+
+    /// Registers an event notified every `period` (rounded to the nearest multiple of the tick,
+    /// at least one tick) with the payload returned by `producer`.
+    pub fn add<F>(&self, service_id: ServiceID, instance_id: InstanceID, notifier_id: MethodID, period: Duration,
+                  force: bool, producer: F) -> CyclicID
+        where F: FnMut() -> Option<Bytes> + Send + 'static
+    {
+        let tick = self.tick.as_nanos();
+        let period = ((period.as_nanos() + tick / 2) / tick).max(1) as u64;
+        let mut state = self.lock();
+        let id = CyclicID(state.next_id);
+        state.next_id += 1;
+        state.entries.push(Entry { id, service_id, instance_id, notifier_id, period, force,
+                                   producer: Box::new(producer) });
+        drop(state);
+        self.shared.changed.notify_one();
+        id
+    }
+
+    /// Removes an event, returns false if it is not registered.
+    pub fn remove(&self, id: CyclicID) -> bool {
+        let mut state = self.lock();
+        match state.entries.iter().position(|e| e.id == id) {
+            Some(pos) => {
+                state.entries.swap_remove(pos);
+                true
+            }
+            None => false,
+        }
+    }
+}
+
+fn run(shared: &Shared, tick: Duration, mut publish: Publisher) {
+    let start = Instant::now();
+    let mut last = 0u64;
+    let mut payloads: Vec<(ServiceID, InstanceID, MethodID, Bytes, bool)> = Vec::new();
+    let mut state = shared.state.lock().unwrap_or_else(|e| e.into_inner());
+    while state.running {
+        let Some(due) = next_due(last, state.entries.iter().map(|e| e.period)) else {
+            state = shared.changed.wait(state).unwrap_or_else(|e| e.into_inner());
+            continue;
+        };
+        let deadline = start + Duration::from_nanos((tick.as_nanos() * due as u128) as u64);
+        let now = Instant::now();
+        if now < deadline {
+            // added or removed events change the next due tick
+            state = shared.changed.wait_timeout(state, deadline - now).unwrap_or_else(|e| e.into_inner()).0;
+            continue;
+        }
+        for entry in state.entries.iter_mut().filter(|e| due % e.period == 0) {
+            if let Some(payload) = (entry.producer)() {
+                payloads.push((entry.service_id, entry.instance_id, entry.notifier_id, payload, entry.force));
+            }
+        }
+        drop(state);
+        if !payloads.is_empty() {
+            let events: Vec<_> = payloads.iter().map(|(s, i, n, p, f)| (*s, *i, *n, p, *f)).collect();
+            publish(&events);
+            payloads.clear();
+        }
+        last = due.max((start.elapsed().as_nanos() / tick.as_nanos()) as u64);
+        state = shared.state.lock().unwrap_or_else(|e| e.into_inner());
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use super::*;
+
+    #[test]
+    fn next_due_test() {
+        assert_eq!(next_due(0, [2u64, 3].into_iter()), Some(2));
+        assert_eq!(next_due(2, [2u64, 3].into_iter()), Some(3));
+        assert_eq!(next_due(3, [2u64, 3].into_iter()), Some(4));
+        assert_eq!(next_due(5, [2u64, 3].into_iter()), Some(6));
+        assert_eq!(next_due(5, std::iter::empty()), None);
+    }
+
+    #[test]
+    fn aligned_batches_test() {
+        let batches = Arc::new(Mutex::new(Vec::<Vec<u16>>::new()));
+        let scheduler = {
+            let batches = batches.clone();
+            CyclicScheduler::with_publisher(Duration::from_millis(1), Box::new(move |events| {
+                batches.lock().unwrap().push(events.iter().map(|e| e.2.id()).collect());
+            }))
+        };
+        scheduler.add(ServiceID(1), InstanceID(1), MethodID(0x8001), Duration::from_millis(2), false,
+                      || Some(Bytes::from_static(b"a")));
+        scheduler.add(ServiceID(1), InstanceID(1), MethodID(0x8002), Duration::from_millis(4), false,
+                      || Some(Bytes::from_static(b"b")));
+        let skipped = scheduler.add(ServiceID(1), InstanceID(1), MethodID(0x8003), Duration::from_millis(4), false,
+                                    || None);
+        std::thread::sleep(Duration::from_millis(40));
+        assert!(scheduler.remove(skipped));
+        assert!(!scheduler.remove(skipped));
+        drop(scheduler);
+
+        let batches = batches.lock().unwrap();
+        assert!(batches.len() >= 2, "{:?}", batches);
+        for batch in batches.iter() {
+            // the 4 ms event is always published together with the 2 ms event
+            assert!(batch.contains(&0x8001), "{:?}", batch);
+            assert!(!batch.contains(&0x8003));
+        }
+        assert!(batches.iter().any(|b| b == &[0x8001, 0x8002]));
+    }
+}
@@ -0,0 +1,97 @@
+// SPDX-License-Identifier: MPL-2.0
+//
+// Copyright (C) 2024 Alexander Seifarth
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+use std::ffi::CString;
+use std::ops::{Deref, DerefMut};
+use super::{ffi, InstanceID, MethodID, ServiceID, VSomeipApplication};
+
+/// A segment of the application's shared memory pool being written, see
+/// [VSomeipApplication::shm_frame()]. The frame dereferences to the whole segment, the number of
+/// bytes actually used is given when notifying it. A frame dropped without notifying is given back.
+pub struct ShmFrame<'a> {
+    app: &'a VSomeipApplication,
+    segment: i32,
+    data: *mut u8,
+    capacity: usize,
+}
+
+impl Deref for ShmFrame<'_> {
+    type Target = [u8];
+    fn deref(&self) -> &[u8] {
+        unsafe { std::slice::from_raw_parts(self.data, self.capacity) }
+    }
+}
+
+impl DerefMut for ShmFrame<'_> {
+    fn deref_mut(&mut self) -> &mut [u8] {
+        unsafe { std::slice::from_raw_parts_mut(self.data, self.capacity) }
+    }
+}
+
+impl Drop for ShmFrame<'_> {
+    fn drop(&mut self) {
+        if self.segment >= 0 {
+            unsafe { ffi::application_shm_discard(self.app.app, self.segment) }
+        }
+    }
+}
+
+impl ShmFrame<'_> {
+    /// Notifies the first `len` bytes of the frame. Consumers which attached the event to the pool
+    /// receive a payload referring to the segment, see [VSomeipApplication::attach_shm_pool()].
+    pub fn notify(mut self, service_id: ServiceID, instance_id: InstanceID, notifier_id: MethodID, len: usize,
+                  force: bool)
+    {
+        assert!(len <= self.capacity, "frame length exceeds the segment size");
+        unsafe {
+            ffi::application_notify_shm(self.app.app, service_id.id(), instance_id.id(), notifier_id.id(),
+                                        self.segment, len as u32, force);
+        }
+        self.segment = -1;
+    }
+}
+
+impl VSomeipApplication {
+    /// Creates the shared memory pool `name` of `segments` segments of `segment_size` bytes for
+    /// notifying large payloads to consumers on the same host without copying them through the
+    /// routing manager. Only a small descriptor of the segment is sent as notification payload.
+    /// Returns false if the pool cannot be created or the application has created one already.
+    pub fn create_shm_pool(&self, name: &str, segments: u32, segment_size: u32) -> bool {
+        let Ok(name) = CString::new(name) else { return false };
+        unsafe { ffi::application_create_shm_pool(self.app, name.as_ptr(), segments, segment_size) }
+    }
+
+    /// Takes a free segment of the shared memory pool for writing a payload.
+    /// Returns `None` if there is no pool or all segments are still held by consumers.
+    pub fn shm_frame(&self) -> Option<ShmFrame<'_>> {
+        let mut data: *mut u8 = std::ptr::null_mut();
+        let mut capacity = 0u32;
+        let segment = unsafe { ffi::application_shm_acquire(self.app, &mut data, &mut capacity) };
+        (segment >= 0).then(|| ShmFrame { app: self, segment, data, capacity: capacity as usize })
+    }
+
+    /// Maps the notifications of an event to the segments of the provider's shared memory pool
+    /// `name`. The payload of a received notification refers to the segment directly and keeps it
+    /// until the payload is dropped. Payloads should therefore be dropped soon: the provider reuses
+    /// segments round robin, a notification whose segment was reused before it was received is
+    /// dropped (see [VSomeipApplication::shm_lost()]). Returns false if the pool does not exist.
+    pub fn attach_shm_pool(&self, service_id: ServiceID, instance_id: InstanceID, notifier_id: MethodID,
+                           name: &str) -> bool
+    {
+        let Ok(name) = CString::new(name) else { return false };
+        unsafe {
+            ffi::application_attach_shm_pool(self.app, service_id.id(), instance_id.id(), notifier_id.id(),
+                                             name.as_ptr())
+        }
+    }
+
+    /// Returns the number of received shared memory notifications dropped because the provider
+    /// had reused their segment already.
+    pub fn shm_lost(&self) -> u64 {
+        unsafe { ffi::application_shm_lost(self.app) }
+    }
+}
@@ -0,0 +1,202 @@
+// SPDX-License-Identifier: MPL-2.0
+//
+// Copyright (C) 2024 Alexander Seifarth
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::time::Duration;
+use super::ffi;
+
+const SUB_BUCKET_BITS: u32 = 2;
+const SUB_BUCKETS: u64 = 1 << SUB_BUCKET_BITS;
+const BUCKETS: usize = ffi::VSOMEIPC_HISTOGRAM_BUCKETS as usize;
+
+/// Log-linear histogram of durations with the bucket layout of the vsomeipc histograms.
+/// Each power of two is split into 4 buckets, so a value is at most 25% above its bucket's lower bound.
+pub(crate) struct Histogram {
+    buckets: [AtomicU64; BUCKETS],
+    count: AtomicU64,
+    sum_ns: AtomicU64,
+    max_ns: AtomicU64,
+}
+
+fn bucket_of(value_ns: u64) -> usize {
+    if value_ns < SUB_BUCKETS {
+        return value_ns as usize;
+    }
+    let shift = 63 - value_ns.leading_zeros() - SUB_BUCKET_BITS;
+    ((shift as u64 + 1) * SUB_BUCKETS + ((value_ns >> shift) & (SUB_BUCKETS - 1))) as usize
+}
+
+/// Returns the smallest value of bucket `idx`.
+fn lower_bound(idx: usize) -> u64 {
+    let idx = idx as u64;
+    if idx < SUB_BUCKETS {
+        return idx;
+    }
+    let shift = idx / SUB_BUCKETS - 1;
+    (SUB_BUCKETS + idx % SUB_BUCKETS) << shift
+}
+
+impl Histogram {
+    pub(crate) fn new() -> Self {
+        Histogram {
+            buckets: std::array::from_fn(|_| AtomicU64::new(0)),
+            count: AtomicU64::new(0),
+            sum_ns: AtomicU64::new(0),
+            max_ns: AtomicU64::new(0),
+        }
+    }
+
+    pub(crate) fn record(&self, value: Duration) {
+        let ns = value.as_nanos().min(u64::MAX as u128) as u64;
+        self.buckets[bucket_of(ns)].fetch_add(1, Ordering::Relaxed);
+        self.count.fetch_add(1, Ordering::Relaxed);
+        self.sum_ns.fetch_add(ns, Ordering::Relaxed);
+        self.max_ns.fetch_max(ns, Ordering::Relaxed);
+    }
+
+    pub(crate) fn snapshot(&self) -> HistogramSnapshot {
+        HistogramSnapshot {
+            count: self.count.load(Ordering::Relaxed),
+            sum_ns: self.sum_ns.load(Ordering::Relaxed),
+            max_ns: self.max_ns.load(Ordering::Relaxed),
+            buckets: self.buckets.iter().map(|b| b.load(Ordering::Relaxed)).collect(),
+        }
+    }
+}
+
+/// Snapshot of a latency histogram.
+#[derive(Debug, Clone, Default, Eq, PartialEq)]
+pub struct HistogramSnapshot {
+    /// Number of recorded values.
+    pub count: u64,
+    sum_ns: u64,
+    max_ns: u64,
+    buckets: Vec<u64>,
+}
+
+impl From<&ffi::latency_histogram> for HistogramSnapshot {
+    fn from(h: &ffi::latency_histogram) -> Self {
+        HistogramSnapshot { count: h.count, sum_ns: h.sum_ns, max_ns: h.max_ns, buckets: h.buckets.to_vec() }
+    }
+}
+
+impl HistogramSnapshot {
+    /// Returns the largest recorded value.
+    pub fn max(&self) -> Duration {
+        Duration::from_nanos(self.max_ns)
+    }
+
+    /// Returns the average of the recorded values.
+    pub fn mean(&self) -> Duration {
+        if self.count == 0 {
+            Duration::ZERO
+        } else {
+            Duration::from_nanos(self.sum_ns / self.count)
+        }
+    }
+
+    /// Returns the value below which the fraction `p` (0.0 to 1.0) of the recorded values lies.
+    /// The result is the lower bound of the bucket holding that rank (but not above the maximum).
+    pub fn percentile(&self, p: f64) -> Duration {
+        if self.count == 0 {
+            return Duration::ZERO;
+        }
+        let rank = ((self.count as f64 * p.clamp(0.0, 1.0)).ceil() as u64).max(1);
+        let mut seen = 0;
+        for (idx, n) in self.buckets.iter().enumerate() {
+            seen += n;
+            if seen >= rank {
+                return Duration::from_nanos(lower_bound(idx).min(self.max_ns));
+            }
+        }
+        self.max()
+    }
+}
+
+/// Number of messages per SOME/IP message type.
+#[derive(Debug, Clone, Copy, Default, Eq, PartialEq)]
+pub struct MessageCounts {
+    pub request: u64,
+    pub request_no_return: u64,
+    pub notification: u64,
+    pub response: u64,
+    pub error: u64,
+    pub other: u64,
+}
+
+impl From<&[u64; ffi::VSOMEIPC_MESSAGE_TYPE_COUNT as usize]> for MessageCounts {
+    fn from(c: &[u64; ffi::VSOMEIPC_MESSAGE_TYPE_COUNT as usize]) -> Self {
+        MessageCounts { request: c[0], request_no_return: c[1], notification: c[2], response: c[3], error: c[4],
+                        other: c[5] }
+    }
+}
+
+/// Snapshot of the hot path statistics of an application, see `VSomeipApplication::stats()`.
+/// The values are updated lock free and independently, so a snapshot is not an exact cut.
+#[derive(Debug, Clone, Default)]
+pub struct ApplicationStats {
+    /// Messages received from vsomeip.
+    pub messages_in: MessageCounts,
+    /// Messages sent (notifications are counted in `notify_calls`).
+    pub messages_out: MessageCounts,
+    /// Payload bytes received.
+    pub bytes_in: u64,
+    /// Payload bytes of sent messages and notifications.
+    pub bytes_out: u64,
+    /// Number of notify calls (each event of a batched notify counts).
+    pub notify_calls: u64,
+    /// Number of vsomeip payloads created by the wrapper (`notify_owned` creates none).
+    pub payload_allocations: u64,
+    /// Received messages discarded at full dispatch worker queues, see
+    /// `ApplicationOptions::dispatch_workers`.
+    pub dispatch_dropped: u64,
+    /// Time spent delivering a received message from the vsomeip dispatcher to its receive queue.
+    pub handler_time: HistogramSnapshot,
+    /// Highest number of messages queued in the receive queue (bounded queues only).
+    pub queue_high_water: u64,
+    /// Time messages spent in the receive queue until received (bounded queues only).
+    pub queue_latency: HistogramSnapshot,
+}
+
+#[cfg(test)]
+mod test {
+    use super::*;
+
+    #[test]
+    fn bucket_test() {
+        for v in 0..4 {
+            assert_eq!(bucket_of(v), v as usize);
+        }
+        assert_eq!(bucket_of(4), 4);
+        assert_eq!(bucket_of(7), 7);
+        assert_eq!(bucket_of(8), 8);
+        assert_eq!(bucket_of(9), 8);
+        assert_eq!(bucket_of(10), 9);
+        assert_eq!(bucket_of(15), 11);
+        assert_eq!(bucket_of(16), 12);
+        assert_eq!(bucket_of(u64::MAX), BUCKETS - 1);
+        for idx in 0..BUCKETS {
+            assert_eq!(bucket_of(lower_bound(idx)), idx);
+        }
+    }
+
+    #[test]
+    fn percentile_test() {
+        let h = Histogram::new();
+        assert_eq!(h.snapshot().percentile(0.5), Duration::ZERO);
+        for us in 1..=100 {
+            h.record(Duration::from_micros(us));
+        }
+        let s = h.snapshot();
+        assert_eq!(s.count, 100);
+        assert_eq!(s.max(), Duration::from_micros(100));
+        assert_eq!(s.mean(), Duration::from_nanos(50_500));
+        let p50 = s.percentile(0.5);
+        assert!(p50 <= Duration::from_micros(50) && p50 * 5 >= Duration::from_micros(50) * 4, "{:?}", p50);
+        assert_eq!(s.percentile(1.0), Duration::from_nanos(lower_bound(bucket_of(100_000))));
+    }
+}
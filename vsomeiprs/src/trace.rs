@@ -0,0 +1,191 @@
+// SPDX-License-Identifier: MPL-2.0
+//
+// Copyright (C) 2024 Alexander Seifarth
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+use std::collections::VecDeque;
+use std::io::{self, Write};
+use std::sync::Mutex;
+use std::time::Duration;
+use super::ffi;
+
+/// Number of trace records kept per receive queue, older ones are overwritten.
+const TRACE_RING_CAPACITY: usize = 1024;
+
+/// Size of a [TraceRecord] in its binary form.
+pub const TRACE_RECORD_SIZE: usize = 40;
+
+/// Stage timestamps of a received message sampled for tracing.
+///
+/// The stamps are nanoseconds of the monotonic clock used by vsomeipc, a stamp is 0 if the
+/// message did not pass the stage (yet).
+#[derive(Eq, PartialEq, Ord, PartialOrd, Debug, Clone, Copy, Default)]
+pub struct MessageTrace {
+    /// Entry of the vsomeip message handler, on the vsomeip dispatcher thread.
+    pub received_ns: u64,
+    /// Call of the Rust message handler, after the dispatch pool and the route lookup.
+    pub handoff_ns: u64,
+    /// Push to the receive channel.
+    pub enqueued_ns: u64,
+    /// Return from the receive queue (bounded queues only).
+    pub dequeued_ns: u64,
+}
+
+pub(crate) fn now_ns() -> u64 {
+    unsafe { ffi::vsomeipc_now_ns() }
+}
+
+fn span(from_ns: u64, to_ns: u64) -> Duration {
+    if from_ns == 0 || to_ns < from_ns {
+        Duration::ZERO
+    } else {
+        Duration::from_nanos(to_ns - from_ns)
+    }
+}
+
+impl MessageTrace {
+    /// Time between the vsomeip message handler and the Rust handler (dispatch pool, routing).
+    pub fn dispatch_time(&self) -> Duration {
+        span(self.received_ns, self.handoff_ns)
+    }
+
+    /// Time spent in the Rust handler until the message was queued.
+    pub fn handler_time(&self) -> Duration {
+        span(self.handoff_ns, self.enqueued_ns)
+    }
+
+    /// Time the message spent in the receive queue.
+    pub fn queue_time(&self) -> Duration {
+        span(self.enqueued_ns, self.dequeued_ns)
+    }
+
+    /// Time from the vsomeip message handler to the last stage reached.
+    pub fn total(&self) -> Duration {
+        let last = self.dequeued_ns.max(self.enqueued_ns).max(self.handoff_ns);
+        span(self.received_ns, last)
+    }
+}
+
+/// A traced message as kept in the trace ring of a receive queue.
+#[derive(Eq, PartialEq, Debug, Clone, Copy, Default)]
+pub struct TraceRecord {
+    pub service_id: u16,
+    pub instance_id: u16,
+    pub method_id: u16,
+    pub session_id: u16,
+    pub trace: MessageTrace,
+}
+
+impl TraceRecord {
+    /// Returns the binary form: the ids and stamps in field order, little endian.
+    pub fn to_bytes(&self) -> [u8; TRACE_RECORD_SIZE] {
+        let mut out = [0u8; TRACE_RECORD_SIZE];
+        out[0..2].copy_from_slice(&self.service_id.to_le_bytes());
+        out[2..4].copy_from_slice(&self.instance_id.to_le_bytes());
+        out[4..6].copy_from_slice(&self.method_id.to_le_bytes());
+        out[6..8].copy_from_slice(&self.session_id.to_le_bytes());
+        out[8..16].copy_from_slice(&self.trace.received_ns.to_le_bytes());
+        out[16..24].copy_from_slice(&self.trace.handoff_ns.to_le_bytes());
+        out[24..32].copy_from_slice(&self.trace.enqueued_ns.to_le_bytes());
+        out[32..40].copy_from_slice(&self.trace.dequeued_ns.to_le_bytes());
+        out
+    }
+
+    /// Reads a record from its binary form, see [TraceRecord::to_bytes()].
+    pub fn from_bytes(bytes: &[u8; TRACE_RECORD_SIZE]) -> Self {
+        let u16_at = |i: usize| u16::from_le_bytes([bytes[i], bytes[i + 1]]);
+        let u64_at = |i: usize| u64::from_le_bytes(bytes[i..i + 8].try_into().unwrap());
+        TraceRecord {
+            service_id: u16_at(0),
+            instance_id: u16_at(2),
+            method_id: u16_at(4),
+            session_id: u16_at(6),
+            trace: MessageTrace {
+                received_ns: u64_at(8),
+                handoff_ns: u64_at(16),
+                enqueued_ns: u64_at(24),
+                dequeued_ns: u64_at(32),
+            },
+        }
+    }
+}
+
+/// The last traced messages of a receive queue.
+pub(crate) struct TraceRing {
+    records: Mutex<VecDeque<TraceRecord>>,
+}
+
+impl TraceRing {
+    pub(crate) fn new() -> Self {
+        TraceRing { records: Mutex::new(VecDeque::new()) }
+    }
+
+    pub(crate) fn push(&self, record: TraceRecord) {
+        let mut records = self.records.lock().unwrap_or_else(|e| e.into_inner());
+        if records.len() == TRACE_RING_CAPACITY {
+            records.pop_front();
+        }
+        records.push_back(record);
+    }
+
+    pub(crate) fn records(&self) -> Vec<TraceRecord> {
+        self.records.lock().unwrap_or_else(|e| e.into_inner()).iter().copied().collect()
+    }
+
+    /// Writes the records oldest first in their binary form and removes them from the ring.
+    pub(crate) fn dump(&self, out: &mut dyn Write) -> io::Result<usize> {
+        let records: Vec<TraceRecord> = self.records.lock().unwrap_or_else(|e| e.into_inner()).drain(..).collect();
+        for record in &records {
+            out.write_all(&record.to_bytes())?;
+        }
+        Ok(records.len())
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use super::*;
+
+    fn record(session_id: u16) -> TraceRecord {
+        TraceRecord {
+            service_id: 0x1234,
+            instance_id: 0x0001,
+            method_id: 0x8001,
+            session_id,
+            trace: MessageTrace { received_ns: 1_000, handoff_ns: 1_500, enqueued_ns: 1_700, dequeued_ns: 4_700 },
+        }
+    }
+
+    #[test]
+    fn stage_times_test() {
+        let trace = record(1).trace;
+        assert_eq!(trace.dispatch_time(), Duration::from_nanos(500));
+        assert_eq!(trace.handler_time(), Duration::from_nanos(200));
+        assert_eq!(trace.queue_time(), Duration::from_nanos(3_000));
+        assert_eq!(trace.total(), Duration::from_nanos(3_700));
+        let partial = MessageTrace { dequeued_ns: 0, ..trace };
+        assert_eq!(partial.queue_time(), Duration::ZERO);
+        assert_eq!(partial.total(), Duration::from_nanos(700));
+        assert_eq!(MessageTrace::default().total(), Duration::ZERO);
+    }
+
+    #[test]
+    fn ring_dump_test() {
+        let ring = TraceRing::new();
+        for session in 0..(TRACE_RING_CAPACITY + 2) as u16 {
+            ring.push(record(session));
+        }
+        let records = ring.records();
+        assert_eq!(records.len(), TRACE_RING_CAPACITY);
+        assert_eq!(records[0].session_id, 2);
+
+        let mut out = Vec::new();
+        assert_eq!(ring.dump(&mut out).unwrap(), TRACE_RING_CAPACITY);
+        assert_eq!(out.len(), TRACE_RING_CAPACITY * TRACE_RECORD_SIZE);
+        let first = TraceRecord::from_bytes(out[..TRACE_RECORD_SIZE].try_into().unwrap());
+        assert_eq!(first, record(2));
+        assert!(ring.records().is_empty());
+    }
+}
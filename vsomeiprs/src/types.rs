@@ -7,10 +7,12 @@
 
 use std::fmt;
 use super::VSomeipPayload;
+use super::trace::MessageTrace;
 
 macro_rules! base_type {
     ($name:ident, $base_type:ty) => {
         #[derive(Eq, PartialEq, Ord, PartialOrd, Debug, Copy, Clone)]
+        #[repr(transparent)]
         pub struct $name (pub $base_type);
 
         impl $name {
@@ -58,6 +60,12 @@ pub const ANY_MINOR_VERSION: MinorVersion = MinorVersion(0xffff_ffff);
 
 base_type!(ProtocolVersion, u8);
 
+// identifies a message route of an application, see VSomeipApplication::add_route()
+base_type!(RouteID, u32);
+
+// identifies an event of a CyclicScheduler
+base_type!(CyclicID, u64);
+
 /// Version (major, minor) for service interfaces
 #[derive(Eq, PartialEq, Ord, PartialOrd, Debug, Clone, Copy)]
 pub struct InterfaceVersion {
@@ -121,6 +129,9 @@ pub struct MessageHeader {
     pub interface_version: InterfaceVersion,
     /// Indicates whether the message was sent on reliable transport (TCP) or not (UDP).
     pub reliable: bool,
+    /// Stage timestamps of a received message sampled for tracing, see
+    /// `VSomeipApplication::set_trace_sampling()`. Always `None` for messages to be sent.
+    pub trace: Option<MessageTrace>,
 }
 
 impl fmt::Display for MessageHeader {
@@ -145,6 +156,25 @@ pub enum MessageType {
     Notification{ header: MessageHeader, is_initial: bool, data: VSomeipPayload },
 }
 
+impl MessageType {
+    /// Returns the common header of the message.
+    pub fn header(&self) -> &MessageHeader {
+        match self {
+            MessageType::Request { header, .. } | MessageType::RequestNoReturn { header, .. }
+            | MessageType::Response { header, .. } | MessageType::Error { header, .. }
+            | MessageType::Notification { header, .. } => header,
+        }
+    }
+
+    pub(crate) fn header_mut(&mut self) -> &mut MessageHeader {
+        match self {
+            MessageType::Request { header, .. } | MessageType::RequestNoReturn { header, .. }
+            | MessageType::Response { header, .. } | MessageType::Error { header, .. }
+            | MessageType::Notification { header, .. } => header,
+        }
+    }
+}
+
 impl fmt::Display for MessageType {
     fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
         match self {
@@ -163,7 +193,7 @@ impl fmt::Display for MessageType {
 }
 
 /// return codes corresponding to SOME/IP return code
-#[derive(Eq, PartialEq, Ord, PartialOrd, Debug)]
+#[derive(Eq, PartialEq, Ord, PartialOrd, Debug, Clone, Copy)]
 pub enum ReturnCode {
     Ok,
     NotOk,
@@ -239,4 +269,24 @@ mod test {
         assert_eq!(ServiceID(2), ServiceID::from(2));
         assert_ne!(ServiceID(0x23), ServiceID::from(23));
     }
+
+    /// The receive header layout is a contract with vsomeipc.h, which checks the same offsets.
+    #[test]
+    fn message_header_layout_test() {
+        use std::mem::{align_of, offset_of, size_of};
+        use crate::ffi::message_header;
+        assert_eq!(size_of::<message_header>(), crate::ffi::VSOMEIPC_MESSAGE_HEADER_SIZE as usize);
+        assert_eq!(align_of::<message_header>(), align_of::<u64>());
+        assert_eq!(offset_of!(message_header, data), 0);
+        assert_eq!(offset_of!(message_header, data_size), 8);
+        assert_eq!(offset_of!(message_header, service), 12);
+        assert_eq!(offset_of!(message_header, session), 20);
+        assert_eq!(offset_of!(message_header, message_type), 24);
+        assert_eq!(offset_of!(message_header, is_reliable), 27);
+        assert_eq!(offset_of!(message_header, reserved), 28);
+        assert_eq!(offset_of!(message_header, received_ns), 32);
+        assert_eq!(offset_of!(message_header, handoff_ns), 40);
+        assert_eq!(size_of::<ServiceID>(), size_of::<u16>());
+        assert_eq!(size_of::<MajorVersion>(), size_of::<u8>());
+    }
 }
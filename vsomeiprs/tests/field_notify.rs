@@ -100,6 +100,10 @@ async fn consumer() -> (u32, u32) {
                                 capp.subscribe(SERVICE_ID, INSTANCE_ID, EVENT_GROUP, NOTIFIER_ID, MajorVersion(MAJOR));
                             }
                         }
+                        VSomeipMessage::FieldUpdated{ .. } => {}
+                        VSomeipMessage::ProviderRole{ .. } => {}
+                        VSomeipMessage::Subscription{ .. } => {}
+                        VSomeipMessage::SubscriptionStatus{ .. } => {}
                         VSomeipMessage::Message(m) => {
                             // println!("Received: {}", m);
                             match m {
@@ -54,6 +54,10 @@ async fn provider() {
                     match msg {
                         VSomeipMessage::RegistrationState(rs) => { assert!(rs) }
                         VSomeipMessage::ServiceAvailability{ .. } => {}
+                        VSomeipMessage::FieldUpdated{ .. } => { panic!("Unexpected FieldUpdated") }
+                        VSomeipMessage::ProviderRole{ .. } => { panic!("Unexpected ProviderRole") }
+                        VSomeipMessage::Subscription{ .. } => { panic!("Unexpected Subscription") }
+                        VSomeipMessage::SubscriptionStatus{ .. } => { panic!("Unexpected SubscriptionStatus") }
                         VSomeipMessage::Message(m) => {
                             // println!("P: {}", m);
                             match m {
@@ -116,6 +120,10 @@ async fn consumer() {
                                 available = avail;
                             }
                         }
+                        VSomeipMessage::FieldUpdated{ .. } => { panic!("Unexpected FieldUpdated") }
+                        VSomeipMessage::ProviderRole{ .. } => { panic!("Unexpected ProviderRole") }
+                        VSomeipMessage::Subscription{ .. } => { panic!("Unexpected Subscription") }
+                        VSomeipMessage::SubscriptionStatus{ .. } => { panic!("Unexpected SubscriptionStatus") }
                         VSomeipMessage::Message(m) => {
                             // println!("C: {}", m);
                             match m {
@@ -8,32 +8,163 @@
 #include "application.h"
 
 #include <cassert>
+#include <cctype>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <unistd.h>
 
-std::shared_ptr<application> application::create(std::string const& name) {
+namespace {
+
+/// Generates a vsomeip configuration with the thread and transport settings of `config` for
+/// application `name` and returns its folder, or an empty path if none is needed.
+///
+/// vsomeip only takes these settings from its configuration, so the folder gets a copy of the base
+/// configuration plus files configuring the application and the transport. The folder is passed to
+/// vsomeip when the application is created, the process environment is not modified.
+std::filesystem::path configure_application(std::string const& name, application_config const& config) {
+    namespace fs = std::filesystem;
+    bool threads = config.io_threads != 0 || config.max_dispatchers != 0 || config.max_dispatch_time_ms != 0;
+    if (!threads && !config.transport_config) {
+        return {};
+    }
+    for (auto c : name) {
+        if (!std::isalnum(static_cast<unsigned char>(c)) && c != '_') {
+            std::cerr << "Cannot configure vsomeip for [" << name << "], name not usable in a file name\n";
+            return {};
+        }
+    }
+    auto env_name = "VSOMEIP_CONFIGURATION_" + name;
+    if (std::getenv(env_name.c_str())) {
+        // the user's application specific configuration takes precedence
+        std::cerr << env_name << " is set, ignoring the " << (threads ? "thread" : "")
+                  << (threads && config.transport_config ? " and " : "")
+                  << (config.transport_config ? "transport" : "") << " settings of [" << name << "]\n";
+        return {};
+    }
+
+    std::error_code ec;
+    auto base = std::getenv("VSOMEIP_CONFIGURATION");
+    fs::path base_path = base ? base : "/etc/vsomeip.json";
+    if (!base && !fs::exists(base_path, ec)) {
+        base_path = "/etc/vsomeip";
+    }
+    auto dir = fs::temp_directory_path(ec) / ("vsomeiprs-" + std::to_string(::getpid()) + "-" + name);
+    fs::remove_all(dir, ec);
+    fs::create_directories(dir, ec);
+    if (ec) {
+        std::cerr << "Cannot create vsomeip configuration folder " << dir << ": " << ec.message() << "\n";
+        return {};
+    }
+    if (fs::is_directory(base_path, ec)) {
+        for (auto const& entry : fs::directory_iterator(base_path, ec)) {
+            if (entry.path().extension() == ".json") {
+                fs::copy_file(entry.path(), dir / entry.path().filename(), ec);
+            }
+        }
+    } else if (fs::is_regular_file(base_path, ec)) {
+        fs::copy_file(base_path, dir / base_path.filename(), ec);
+    }
+
+    std::ofstream out;
+    if (threads) {
+        out.open((dir / "vsomeiprs-threads.json").string());
+        out << "{\n  \"applications\": [ {\n    \"name\": \"" << name << "\"";
+        if (config.io_threads) {
+            out << ",\n    \"threads\": \"" << config.io_threads << "\"";
+        }
+        if (config.max_dispatchers) {
+            out << ",\n    \"max_dispatchers\": \"" << config.max_dispatchers << "\"";
+        }
+        if (config.max_dispatch_time_ms) {
+            out << ",\n    \"max_dispatch_time\": \"" << config.max_dispatch_time_ms << "\"";
+        }
+        out << "\n  } ]\n}\n";
+        out.close();
+    }
+    if (out && config.transport_config) {
+        out.open((dir / "vsomeiprs-transport.json").string());
+        out << config.transport_config;
+        out.close();
+    }
+    if (!out) {
+        std::cerr << "Cannot write vsomeip configuration to " << dir << "\n";
+        fs::remove_all(dir, ec);
+        return {};
+    }
+    return dir;
+}
+
+}
+
+
+std::shared_ptr<application> application::create(std::string const& name, application_config const& config) {
+    auto config_dir = configure_application(name, config);
     auto runtime = vsomeip::runtime::get();
     assert(runtime);
-    auto application= runtime->create_application(name);
-    if (!application) {
-        std::cerr << "FAILED to create vsomeip::application object [" << name << "]\n";
+    auto application = config_dir.empty() ? runtime->create_application(name)
+                                          : runtime->create_application(name, config_dir.string());
+    if (!application || !application->init()) {
+        std::cerr << "FAILED to " << (application ? "initialize" : "create") << " vsomeip::application ["
+                  << name << "]\n";
+        if (application) {
+            runtime->remove_application(name);
+        }
+        std::error_code ec;
+        std::filesystem::remove_all(config_dir, ec);
         return nullptr;
     }
-    if (!application->init()) {
-        std::cerr << "FAILED to initialize vsomeip::application [" << name << "]\n";
-        return nullptr;
+    auto af = std::make_shared<::application>(runtime, application,
+        config.payload_handles > 0 ? config.payload_handles : payload_pool::default_capacity);
+    af->_config_dir = std::move(config_dir);
+    if (config.dispatch_workers > 0) {
+        af->_workers = std::make_unique<dispatch_pool>(config.dispatch_workers, config.dispatch_queue_capacity,
+            config.dispatch_overflow,
+            [a = af.get()](std::shared_ptr<vsomeip::message> const& msg, uint64_t trace_ns) {
+                a->dispatch(msg, trace_ns); });
+    }
+    if (config.batch_capacity > 0) {
+        assert(config.batch_ready_handler);
+        af->enable_batch(config.batch_capacity,
+            [handler = config.batch_ready_handler, object = config.batch_ready_object]() { handler(object); });
     }
-    auto af = std::make_shared<::application>(runtime, application);
     af->start();
     return af;
 }
 
 application::application(
         std::shared_ptr<vsomeip::runtime> runtime,
-        std::shared_ptr<vsomeip::application> application)
+        std::shared_ptr<vsomeip::application> application,
+        std::size_t payload_handles)
         : _runtime{ std::move(runtime) }
         , _application{ std::move(application) }
         , _dispatch_thread{}
         , _state_connected{false}
+        , _payload_pool{ new payload_pool{payload_handles} }
+        , _conflation{}
+        , _routes{}
+        , _standby{}
+        , _standby_timer{}
+        , _standby_mutex{}
+        , _standby_wakeup{}
+        , _standby_stop{false}
+        , _subscribers{}
+        , _on_msg{}
+        , _batch{nullptr}
+        , _field_cache{nullptr}
+        , _filter{nullptr}
+        , _trace_every{0}
+        , _trace_count{0}
+        , _shm_mutex{}
+        , _shm_provider{}
+        , _shm_consumers{nullptr}
+        , _shm_snapshots{}
+        , _shm_lost{0}
+        , _on_batch_ready{}
+        , _workers{}
+        , _stats{}
+        , _config_dir{}
 {}
 
 application::~application() {
@@ -43,7 +174,16 @@ application::~application() {
         _runtime->remove_application(_application->get_name());
         _application.reset();
     }
+    // outstanding payload handles keep the pool alive until the Rust side drops them
+    delete _batch.load();
+    delete _field_cache.load();
+    delete _filter.load();
+    _payload_pool->close();
     _runtime.reset();
+    if (!_config_dir.empty()) {
+        std::error_code ec;
+        std::filesystem::remove_all(_config_dir, ec);
+    }
 }
 
 std::shared_ptr<vsomeip::runtime>& application::runtime() {
@@ -55,10 +195,12 @@ std::string const& application::name() const {
 }
 
 std::shared_ptr<vsomeip::payload> application::create_payload_empty() const {
+    _stats.count_payload_allocation();
     return _runtime->create_payload();
 }
 
 std::shared_ptr<vsomeip::payload> application::create_payload(uint8_t const* data, uint32_t size) {
+    _stats.count_payload_allocation();
     return _runtime->create_payload(data, size);
 }
 
@@ -70,10 +212,21 @@ void application::start() {
 }
 
 void application::stop() {
+    {
+        std::lock_guard<std::mutex> lock{_standby_mutex};
+        _standby_stop = true;
+    }
+    _standby_wakeup.notify_one();
+    if (_standby_timer.joinable()) {
+        _standby_timer.join();
+    }
     _application->stop();
     if (_dispatch_thread.joinable()) {
         _dispatch_thread.join();
     }
+    if (_workers) {
+        _workers->stop();
+    }
 }
 
 void application::request_service(vsomeip::service_t service, vsomeip::instance_t instance,
@@ -161,18 +314,195 @@ void application::offer_event(vsomeip::service_t service, vsomeip::instance_t in
 {
     _application->offer_event(service, instance, notifier, event_groups, type, cycle, change_resets_cycle,
                               update_on_change, epsilon_change_func, reliability);
+    _subscribers.offer(service, instance, notifier, event_groups);
+    auto cache = _field_cache.load(std::memory_order_acquire);
+    if (cache && type == vsomeip::event_type_e::ET_FIELD) {
+        std::vector<vsomeip::byte_t> value;
+        if (cache->track(service, instance, notifier, value)) {
+            // vsomeip sends the value as initial event to subscribers, no need to wait for the provider
+            _stats.count_notify(static_cast<uint32_t>(value.size()));
+            _application->notify(service, instance, notifier,
+                                 create_payload(value.data(), static_cast<uint32_t>(value.size())), false);
+        }
+    }
 }
 
 void application::stop_offer_event(vsomeip::service_t service, vsomeip::instance_t instance, vsomeip::event_t event)
 {
     _application->stop_offer_event(service, instance, event);
+    _subscribers.withdraw(service, instance, event);
+    if (auto cache = _field_cache.load(std::memory_order_acquire)) {
+        cache->untrack(service, instance, event);
+    }
+}
+
+void application::track_subscribers(vsomeip::service_t service, vsomeip::instance_t instance,
+                                    vsomeip::eventgroup_t group)
+{
+    _application->register_subscription_handler(service, instance, group,
+            [this, service, instance, group](vsomeip::client_t client, vsomeip_sec_client_t const*,
+                                             std::string const&, bool subscribed) {
+                _subscribers.update(service, instance, group, client, subscribed);
+                return true;
+            });
+}
+
+void application::watch_subscriptions(vsomeip::service_t service, vsomeip::instance_t instance,
+                                      vsomeip::eventgroup_t group, subscriber_table::subscription_callback_t callback)
+{
+    if (_subscribers.watch(service, instance, group, std::move(callback))) {
+        track_subscribers(service, instance, group);
+    }
+}
+
+uint32_t application::subscriber_count(vsomeip::service_t service, vsomeip::instance_t instance,
+                                       vsomeip::event_t event) const
+{
+    return _subscribers.subscribers(service, instance, event);
+}
+
+void application::watch_subscription_status(vsomeip::service_t service, vsomeip::instance_t instance,
+                                            vsomeip::eventgroup_t group, vsomeip::event_t event,
+                                            on_subscription_status_callback_t callback)
+{
+    _application->register_subscription_status_handler(service, instance, group, event,
+            [c = std::move(callback)](vsomeip::service_t svc, vsomeip::instance_t inst, vsomeip::eventgroup_t eg,
+                                      vsomeip::event_t ev, uint16_t error) {
+                // error is 0x00 for an acknowledged subscription and 0x07 for a rejected one
+                c(svc, inst, eg, ev, error == 0);
+            });
+}
+
+void application::unwatch_subscription_status(vsomeip::service_t service, vsomeip::instance_t instance,
+                                              vsomeip::eventgroup_t group, vsomeip::event_t event)
+{
+    _application->unregister_subscription_status_handler(service, instance, group, event);
+}
+
+void application::offer_service_standby(vsomeip::service_t service, vsomeip::instance_t instance,
+                                        vsomeip::major_version_t major, vsomeip::minor_version_t minor,
+                                        std::chrono::milliseconds initial_wait,
+                                        standby_table::role_callback_t callback)
+{
+    // a remote active provider is only known once its service discovery offer arrived
+    if (!_standby.add(service, instance, major, minor, standby_table::clock::now() + initial_wait,
+                      std::move(callback))) {
+        return;
+    }
+    // the instance turns unavailable when the active provider stops offering it or is lost
+    _application->register_availability_handler(service, instance,
+            [this](vsomeip::service_t svc, vsomeip::instance_t inst, bool avail) {
+                if (_standby.availability(svc, inst, avail)) {
+                    take_over(svc, inst);
+                }
+            },
+            major, vsomeip::ANY_MINOR);
+    _application->request_service(service, instance, major, minor);
+    _standby.report_standby(service, instance);
+    std::lock_guard<std::mutex> lock{_standby_mutex};
+    if (_standby_stop) {
+        return;
+    }
+    if (!_standby_timer.joinable()) {
+        _standby_timer = std::thread([this] { run_standby_timer(); });
+    }
+    _standby_wakeup.notify_one();
+}
+
+void application::run_standby_timer()
+{
+    std::unique_lock<std::mutex> lock{_standby_mutex};
+    while (!_standby_stop) {
+        std::optional<standby_table::clock::time_point> next;
+        auto expired = _standby.expired(standby_table::clock::now(), next);
+        if (!expired.empty()) {
+            lock.unlock();
+            for (auto [service, instance] : expired) {
+                take_over(service, instance);
+            }
+            lock.lock();
+            continue;
+        }
+        if (next) {
+            _standby_wakeup.wait_until(lock, *next);
+        } else {
+            _standby_wakeup.wait(lock);
+        }
+    }
+}
+
+void application::stop_offer_service_standby(vsomeip::service_t service, vsomeip::instance_t instance)
+{
+    vsomeip::major_version_t major;
+    vsomeip::minor_version_t minor;
+    bool active;
+    if (!_standby.remove(service, instance, major, minor, active)) {
+        return;
+    }
+    _application->unregister_availability_handler(service, instance, major);
+    _application->release_service(service, instance);
+    if (active) {
+        _application->stop_offer_service(service, instance, major, minor);
+    }
+}
+
+void application::take_over(vsomeip::service_t service, vsomeip::instance_t instance)
+{
+    auto takeover = _standby.activate(service, instance);
+    if (!takeover) {
+        return;
+    }
+    _application->offer_service(service, instance, takeover->major, takeover->minor);
+    // vsomeip keeps the values as initial events for the consumers subscribing to the new offer
+    for (auto const& f : takeover->fields) {
+        notify(service, instance, f.event, true, create_payload(f.data.data(), static_cast<uint32_t>(f.data.size())));
+    }
+    _standby.report_active(service, instance);
+}
+
+void application::prepare_field(vsomeip::service_t service, vsomeip::instance_t instance, vsomeip::event_t event,
+                                bool force, uint8_t const* data, uint32_t data_len)
+{
+    if (_standby.prepare(service, instance, event, data, data_len)) {
+        notify(service, instance, event, force, data, data_len);
+    }
 }
 
 void application::notify(vsomeip::service_t service, vsomeip::instance_t instance, vsomeip::event_t event,
                          bool force, uint8_t const* data, uint32_t data_len)
 {
-    auto payload = _runtime->create_payload(data, data_len);
-    _application->notify(service, instance, event, payload, force);
+    notify(service, instance, event, force, create_payload(data, data_len));
+}
+
+void application::notify(vsomeip::service_t service, vsomeip::instance_t instance, vsomeip::event_t event,
+                         bool force, std::shared_ptr<vsomeip::payload> payload)
+{
+    _stats.count_notify(payload ? payload->get_length() : 0);
+    if (auto cache = _field_cache.load(std::memory_order_acquire); cache && payload) {
+        cache->store(service, instance, event, payload->get_data(), payload->get_length());
+    }
+    _application->notify(service, instance, event, std::move(payload), force);
+}
+
+void application::notify_many(notify_entry const* entries, std::size_t count) {
+    // reused per calling thread so that the steady state does not allocate the payload list
+    thread_local std::vector<std::shared_ptr<vsomeip::payload>> payloads;
+    payloads.clear();
+    payloads.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        payloads.emplace_back(create_payload(entries[i].data, entries[i].data_len));
+    }
+    auto cache = _field_cache.load(std::memory_order_acquire);
+    for (std::size_t i = 0; i < count; ++i) {
+        _stats.count_notify(entries[i].data_len);
+        if (cache) {
+            cache->store(entries[i].service, entries[i].instance, entries[i].notifier, entries[i].data,
+                         entries[i].data_len);
+        }
+        _application->notify(entries[i].service, entries[i].instance, entries[i].notifier,
+                             std::move(payloads[i]), entries[i].force);
+    }
+    payloads.clear();
 }
 
 void application::setup_state_handler(on_state_callback_t callback) {
@@ -206,24 +536,286 @@ void application::clear_avail_handler(vsomeip::service_t service, vsomeip::insta
 }
 
 void application::setup_msg_handler(on_msg_callback_t callback) {
+    _on_msg = std::move(callback);
     _application->register_message_handler(
     vsomeip::ANY_SERVICE, vsomeip::ANY_INSTANCE, vsomeip::ANY_METHOD,
-    [c = std::move(callback)](std::shared_ptr<vsomeip::message> const& msg) {
-                c(msg);
+    [this](std::shared_ptr<vsomeip::message> const& msg) {
+                _stats.count_in(*msg);
+                if (auto filter = _filter.load(std::memory_order_acquire); filter && !(*filter)(msg)) {
+                    return;
+                }
+                uint64_t trace_ns = sample_trace();
+                if (_workers) {
+                    _workers->post(msg, trace_ns);
+                } else {
+                    dispatch(msg, trace_ns);
+                }
         });
 }
 
+namespace {
+    // receive time of the sampled message being delivered on this thread
+    thread_local uint64_t delivering_trace_ns = 0;
+}
+
+void application::set_message_filter(filter_callback_t filter) {
+    assert(!_filter.load());
+    _filter.store(new filter_callback_t{std::move(filter)}, std::memory_order_release);
+}
+
+void application::set_trace_sampling(uint32_t every) {
+    _trace_every.store(every, std::memory_order_relaxed);
+}
+
+uint64_t application::sample_trace() {
+    uint32_t every = _trace_every.load(std::memory_order_relaxed);
+    if (every == 0 || _trace_count.fetch_add(1, std::memory_order_relaxed) % every != 0) {
+        return 0;
+    }
+    return vsomeipc_now_ns();
+}
+
+uint64_t application::current_trace() {
+    return delivering_trace_ns;
+}
+
+void application::dispatch(std::shared_ptr<vsomeip::message> const& msg, uint64_t trace_ns) {
+    auto start = stats_recorder::clock::now();
+    delivering_trace_ns = trace_ns;
+    deliver(msg);
+    delivering_trace_ns = 0;
+    _stats.record_handler_time(stats_recorder::clock::now() - start);
+}
+
+void application::deliver(std::shared_ptr<vsomeip::message> const& msg) {
+    if (_shm_consumers.load(std::memory_order_acquire) && !resolve_shm(msg)) {
+        return;
+    }
+    if (_routes.dispatch(msg)) {
+        return;
+    }
+    if (_conflation.offer(msg)) {
+        return;
+    }
+    if (auto ring = _batch.load(std::memory_order_acquire)) {
+        if (ring->push(msg) == message_ring::push_result::first) {
+            _on_batch_ready();
+        }
+        return;
+    }
+    _on_msg(msg);
+}
+
+route_table::route_id_t application::add_route(vsomeip::service_t service, vsomeip::instance_t instance,
+                                               vsomeip::method_t first, vsomeip::method_t last,
+                                               route_table::callback_t callback)
+{
+    return _routes.add(service, instance, first, last, std::move(callback));
+}
+
+void application::remove_route(route_table::route_id_t id) {
+    _routes.remove(id);
+}
+
+bool application::enable_field_cache(std::string const& path, uint32_t slots, uint32_t slot_size) {
+    if (_field_cache.load(std::memory_order_acquire)) {
+        return false;
+    }
+    auto cache = field_cache::open(path, slots, slot_size);
+    if (!cache) {
+        return false;
+    }
+    field_cache* expected = nullptr;
+    if (!_field_cache.compare_exchange_strong(expected, cache.get(), std::memory_order_acq_rel)) {
+        return false;
+    }
+    cache.release();
+    return true;
+}
+
+void application::forget_cached_field(vsomeip::service_t service, vsomeip::instance_t instance,
+                                     vsomeip::event_t event)
+{
+    if (auto cache = _field_cache.load(std::memory_order_acquire)) {
+        cache->forget(service, instance, event);
+    }
+}
+
+namespace {
+    uint64_t shm_key(vsomeip::service_t service, vsomeip::instance_t instance, vsomeip::event_t event) {
+        return static_cast<uint64_t>(service) << 32 | static_cast<uint64_t>(instance) << 16 | event;
+    }
+}
+
+bool application::create_shm_pool(std::string const& name, uint32_t segments, uint32_t segment_size) {
+    // checked before creating, creating a pool replaces an existing one of the same name
+    std::lock_guard<std::mutex> lock{_shm_mutex};
+    if (_shm_provider) {
+        return false;
+    }
+    _shm_provider = shm_pool::create(name, segments, segment_size);
+    return _shm_provider != nullptr;
+}
+
+int32_t application::shm_acquire(uint8_t*& data, uint32_t& capacity) {
+    std::lock_guard<std::mutex> lock{_shm_mutex};
+    return _shm_provider ? _shm_provider->acquire(data, capacity) : -1;
+}
+
+void application::notify_shm(vsomeip::service_t service, vsomeip::instance_t instance, vsomeip::event_t event,
+                             int32_t segment, uint32_t length, bool force)
+{
+    std::shared_ptr<shm_pool> pool;
+    {
+        std::lock_guard<std::mutex> lock{_shm_mutex};
+        pool = _shm_provider;
+    }
+    assert(pool);
+    auto d = pool->describe(segment, length);
+    // the descriptor refers to this process' pool and is stale after a restart, so it is not cached
+    if (auto cache = _field_cache.load(std::memory_order_acquire)) {
+        cache->clear(service, instance, event);
+    }
+    _stats.count_notify(sizeof(d));
+    _application->notify(service, instance, event,
+                         create_payload(reinterpret_cast<uint8_t const*>(&d), sizeof(d)), force);
+    pool->release(segment);
+}
+
+void application::shm_discard(int32_t segment) {
+    std::lock_guard<std::mutex> lock{_shm_mutex};
+    assert(_shm_provider);
+    _shm_provider->release(segment);
+}
+
+bool application::attach_shm_pool(vsomeip::service_t service, vsomeip::instance_t instance, vsomeip::event_t event,
+                                  std::string const& name)
+{
+    auto pool = shm_pool::attach(name);
+    if (!pool) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock{_shm_mutex};
+    auto current = _shm_consumers.load(std::memory_order_relaxed);
+    auto next = std::make_unique<shm_consumers_t>(current ? *current : shm_consumers_t{});
+    (*next)[shm_key(service, instance, event)] = std::move(pool);
+    // receiving threads may still read the previous snapshot
+    _shm_consumers.store(next.get(), std::memory_order_release);
+    _shm_snapshots.push_back(std::move(next));
+    return true;
+}
+
+bool application::resolve_shm(std::shared_ptr<vsomeip::message> const& msg) {
+    if (msg->get_message_type() != vsomeip::message_type_e::MT_NOTIFICATION) {
+        return true;
+    }
+    auto consumers = _shm_consumers.load(std::memory_order_acquire);
+    auto it = consumers->find(shm_key(msg->get_service(), msg->get_instance(), msg->get_method()));
+    if (it == consumers->end()) {
+        return true;
+    }
+    // the snapshot keeps the pool alive
+    auto pool = it->second.get();
+    auto descriptor = msg->get_payload();
+    auto payload = descriptor ? pool->resolve(descriptor->get_data(), descriptor->get_length()) : nullptr;
+    if (!payload) {
+        _shm_lost.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    msg->set_payload(payload);
+    return true;
+}
+
+uint64_t application::shm_lost() const {
+    return _shm_lost.load(std::memory_order_relaxed);
+}
+
+void application::enable_batch(std::size_t capacity, on_batch_ready_callback_t callback) {
+    assert(!_batch.load());
+    _on_batch_ready = std::move(callback);
+    _batch.store(new message_ring{capacity}, std::memory_order_release);
+}
+
+std::size_t application::drain(std::shared_ptr<vsomeip::message>* out, std::size_t max) {
+    auto ring = _batch.load(std::memory_order_acquire);
+    return ring ? ring->drain(out, max) : 0;
+}
+
+uint64_t application::batch_dropped() const {
+    auto ring = _batch.load(std::memory_order_acquire);
+    return ring ? ring->dropped() : 0;
+}
+
+bool application::conflate_event(vsomeip::service_t service, vsomeip::instance_t instance, vsomeip::event_t event,
+                                 on_dirty_callback_t callback)
+{
+    return _conflation.enable(service, instance, event, std::move(callback));
+}
+
+void application::unconflate_event(vsomeip::service_t service, vsomeip::instance_t instance, vsomeip::event_t event)
+{
+    _conflation.disable(service, instance, event);
+}
+
+void application::restore_conflated(std::shared_ptr<vsomeip::message> msg)
+{
+    _conflation.restore(std::move(msg));
+}
+
+std::shared_ptr<vsomeip::message> application::take_conflated(vsomeip::service_t service, vsomeip::instance_t instance,
+                                                              vsomeip::event_t event)
+{
+    return _conflation.take(service, instance, event);
+}
+
 vsomeip::session_t
 application::send_request(vsomeip::service_t service, vsomeip::instance_t instance, vsomeip::method_t method,
                           major_version major, uint8_t const* data, uint32_t data_len, bool reliable)
 {
-    auto payload = _runtime->create_payload(data, data_len);
+    return send_request(service, instance, method, major, create_payload(data, data_len), reliable);
+}
+
+vsomeip::session_t
+application::send_request(vsomeip::service_t service, vsomeip::instance_t instance, vsomeip::method_t method,
+                          major_version major, std::shared_ptr<vsomeip::payload> payload, bool reliable)
+{
     auto msg = _runtime->create_request(reliable);
     msg->set_service(service);
     msg->set_instance(instance);
     msg->set_method(method);
     msg->set_payload(payload);
     msg->set_interface_version(major);
+    _stats.count_out(*msg);
+    _application->send(msg);
+    return msg->get_session();
+}
+
+void application::send_requests(vsomeip::service_t service, request_target const* targets, std::size_t count,
+                                major_version major, bool reliable, uint8_t const* data, uint32_t data_len,
+                                vsomeip::session_t* sessions)
+{
+    // vsomeip serializes the payload of each message when sending it, the messages can share it
+    auto payload = create_payload(data, data_len);
+    for (std::size_t i = 0; i < count; ++i) {
+        sessions[i] = send_request(service, targets[i].instance, targets[i].method, major, payload, reliable);
+    }
+}
+
+vsomeip::session_t
+application::forward_request(vsomeip::service_t service, vsomeip::instance_t instance, vsomeip::method_t method,
+                             major_version major, bool reliable, bool no_return,
+                             std::shared_ptr<vsomeip::payload> payload)
+{
+    auto msg = _runtime->create_request(reliable);
+    msg->set_service(service);
+    msg->set_instance(instance);
+    msg->set_method(method);
+    msg->set_payload(std::move(payload));
+    msg->set_interface_version(major);
+    if (no_return) {
+        msg->set_message_type(vsomeip::message_type_e::MT_REQUEST_NO_RETURN);
+    }
+    _stats.count_out(*msg);
     _application->send(msg);
     return msg->get_session();
 }
@@ -232,7 +824,14 @@ void application::send_response(service_id service, instance_id instance, method
                    client_id client, session_id session, major_version major, bool reliable,
                     vsomeip::return_code_e rc, uint8_t const* data, uint32_t data_len)
 {
-    auto payload = _runtime->create_payload(data, data_len);
+    send_response(service, instance, method, client, session, major, reliable, rc,
+                  create_payload(data, data_len));
+}
+
+void application::send_response(service_id service, instance_id instance, method_id method,
+                   client_id client, session_id session, major_version major, bool reliable,
+                    vsomeip::return_code_e rc, std::shared_ptr<vsomeip::payload> payload)
+{
     auto msg = _runtime->create_message(reliable);
     msg->set_service(service);
     msg->set_instance(instance);
@@ -243,6 +842,7 @@ void application::send_response(service_id service, instance_id instance, method
     msg->set_message_type(vsomeip::message_type_e::MT_RESPONSE);
     msg->set_return_code(rc);
     msg->set_payload(payload);
+    _stats.count_out(*msg);
     _application->send(msg);
 }
 
@@ -258,9 +858,51 @@ void application::send_error(service_id service, instance_id instance, method_id
     msg->set_interface_version(major);
     msg->set_message_type(vsomeip::message_type_e::MT_RESPONSE);
     msg->set_return_code(rc);
+    _stats.count_out(*msg);
     _application->send(msg);
 }
 
 std::shared_ptr<vsomeip::message> application::create_message() {
     return _runtime->create_message();
 }
+
+std::shared_ptr<vsomeip::message>
+application::create_request_template(vsomeip::service_t service, vsomeip::instance_t instance,
+                                     vsomeip::method_t method, major_version major, bool reliable)
+{
+    auto msg = _runtime->create_request(reliable);
+    msg->set_service(service);
+    msg->set_instance(instance);
+    msg->set_method(method);
+    msg->set_interface_version(major);
+    msg->set_payload(create_payload_empty());
+    return msg;
+}
+
+vsomeip::session_t application::send_with(std::shared_ptr<vsomeip::message> const& msg,
+                                          uint8_t const* data, uint32_t data_len)
+{
+    msg->get_payload()->set_data(data, data_len);
+    // vsomeip assigns client and session of requests on send and serializes the message immediately
+    _stats.count_out(*msg);
+    _application->send(msg);
+    return msg->get_session();
+}
+
+void application::send(std::shared_ptr<vsomeip::message> const& msg) {
+    _stats.count_out(*msg);
+    _application->send(msg);
+}
+
+payload_t application::make_payload_handle(std::shared_ptr<vsomeip::payload> payload) {
+    return _payload_pool->acquire(std::move(payload));
+}
+
+void application::stats(application_stats& out) const {
+    _stats.snapshot(out);
+    out.dispatch_dropped = _workers ? _workers->dropped() : 0;
+}
+
+payload_pool_stats application::pool_stats() const {
+    return _payload_pool->stats();
+}
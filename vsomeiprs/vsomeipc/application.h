@@ -9,41 +9,189 @@
 #define APPLICATION_H_
 
 #include "vsomeipc.h"
+#include "payload_pool.h"
+#include "conflation_table.h"
+#include "message_ring.h"
+#include "route_table.h"
+#include "dispatch_pool.h"
+#include "stats_recorder.h"
+#include "standby_table.h"
+#include "field_cache.h"
+#include "subscriber_table.h"
+#include "shm_pool.h"
 
 #include <vsomeip/vsomeip.hpp>
 
+#include <atomic>
+#include <condition_variable>
+#include <filesystem>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <thread>
+#include <vector>
 
 class application {
     std::shared_ptr<vsomeip::runtime> _runtime;
     std::shared_ptr<vsomeip::application> _application;
     std::thread _dispatch_thread;
     bool _state_connected;
+    payload_pool* _payload_pool;
+    conflation_table _conflation;
+    route_table _routes;
+    standby_table _standby;
+    std::thread _standby_timer;             // takes standby instances over after their initial wait
+    std::mutex _standby_mutex;
+    std::condition_variable _standby_wakeup;
+    bool _standby_stop;
+    subscriber_table _subscribers;
 
     using on_state_callback_t = std::function<void(state_type_ce)>;
     using on_avail_callback_t = std::function<void(vsomeip::service_t, vsomeip::instance_t, bool)>;
     using on_msg_callback_t = std::function<void (const std::shared_ptr< vsomeip::message > &)>;
+    using on_dirty_callback_t = conflation_table::dirty_callback_t;
+    using on_batch_ready_callback_t = std::function<void()>;
+    using filter_callback_t = std::function<bool(std::shared_ptr<vsomeip::message> const&)>;
+    using on_subscription_status_callback_t = std::function<void(vsomeip::service_t, vsomeip::instance_t,
+                                                                 vsomeip::eventgroup_t, vsomeip::event_t, bool)>;
+
+    on_msg_callback_t _on_msg;
+    std::atomic<message_ring*> _batch;
+    std::atomic<field_cache*> _field_cache;
+    std::atomic<filter_callback_t*> _filter;
+    std::atomic<uint32_t> _trace_every;
+    std::atomic<uint32_t> _trace_count;
+    using shm_consumers_t = std::map<uint64_t, std::shared_ptr<shm_pool>>;    // key service << 32 | instance << 16 | event
+    std::mutex _shm_mutex;
+    std::shared_ptr<shm_pool> _shm_provider;
+    // the attached pools, replaced by a copy on every attach so that receiving reads them without
+    // locking; replaced snapshots are kept until the application is deleted
+    std::atomic<shm_consumers_t const*> _shm_consumers;
+    std::vector<std::unique_ptr<shm_consumers_t const>> _shm_snapshots;
+    std::atomic<uint64_t> _shm_lost;
+    on_batch_ready_callback_t _on_batch_ready;
+    std::unique_ptr<dispatch_pool> _workers;
+    mutable stats_recorder _stats;
+    std::filesystem::path _config_dir;      // generated vsomeip configuration, removed with the application
 
     void start();
     void stop();
 
+    /// Passes a received message to deliver() and records the time spent there.
+    /// `trace_ns` is the time the message was received if it is sampled for tracing, else 0.
+    void dispatch(std::shared_ptr<vsomeip::message> const& msg, uint64_t trace_ns);
+
+    /// Returns the current time if the next received message is sampled for tracing, else 0.
+    uint64_t sample_trace();
+
+    /// Passes a received message to its route, or through conflation and batching to the message callback.
+    void deliver(std::shared_ptr<vsomeip::message> const& msg);
+
+    /// Replaces the descriptor payload of a notification of an event attached to a shm pool by the
+    /// segment it refers to. Returns false if the segment has been reused already.
+    bool resolve_shm(std::shared_ptr<vsomeip::message> const& msg);
+
+    /// Offers a standby instance and publishes its prepared fields.
+    void take_over(vsomeip::service_t service, vsomeip::instance_t instance);
+
+    /// Takes over the standby instances whose initial wait has passed, until stop().
+    void run_standby_timer();
+
+    /// Registers the vsomeip subscription handler of an eventgroup which records its subscribers.
+    void track_subscribers(vsomeip::service_t service, vsomeip::instance_t instance, vsomeip::eventgroup_t group);
+
 public:
-    application(std::shared_ptr<vsomeip::runtime> runtime, std::shared_ptr<vsomeip::application> application);
+    application(std::shared_ptr<vsomeip::runtime> runtime, std::shared_ptr<vsomeip::application> application,
+                std::size_t payload_handles = payload_pool::default_capacity);
     application(application const&) = delete;
     ~application();
 
     [[nodiscard]]
-    static std::shared_ptr<application> create(std::string const& name);
+    static std::shared_ptr<application> create(std::string const& name, application_config const& config = {});
 
     void setup_state_handler(on_state_callback_t callback);
     void setup_avail_handler(on_avail_callback_t callback);
     void setup_msg_handler(on_msg_callback_t callback);
 
+    /// Passes on only the received messages for which `filter` returns true. The filter runs before the
+    /// message is handed to the dispatch workers, routes or the message callback. Must be called at
+    /// most once.
+    void set_message_filter(filter_callback_t filter);
+
+    /// Samples every `every`th received message for tracing, 0 disables tracing.
+    void set_trace_sampling(uint32_t every);
+
+    /// Returns the receive time of the message being delivered on the calling thread if it is
+    /// sampled for tracing, else 0.
+    [[nodiscard]]
+    static uint64_t current_trace();
+
+    /// Delivers messages of the method range to `callback` instead of the message callback.
+    /// Returns 0 if the range overlaps an existing route, see route_table.
+    route_table::route_id_t add_route(vsomeip::service_t service, vsomeip::instance_t instance,
+                                      vsomeip::method_t first, vsomeip::method_t last,
+                                      route_table::callback_t callback);
+    void remove_route(route_table::route_id_t id);
+
     void setup_avail_handler(vsomeip::service_t service, vsomeip::instance_t instance, vsomeip::major_version_t  major,
                              on_avail_callback_t callback);
     void clear_avail_handler(vsomeip::service_t service, vsomeip::instance_t instance, vsomeip::major_version_t  major);
 
+    /// Keeps only the latest notification of the event instead of passing each one to the message
+    /// handler. `callback` is invoked when a new value arrives while the previous one was taken.
+    bool conflate_event(vsomeip::service_t service, vsomeip::instance_t instance, vsomeip::event_t event,
+                        on_dirty_callback_t callback);
+    void unconflate_event(vsomeip::service_t service, vsomeip::instance_t instance, vsomeip::event_t event);
+
+    [[nodiscard]]
+    std::shared_ptr<vsomeip::message> take_conflated(vsomeip::service_t service, vsomeip::instance_t instance,
+                                                     vsomeip::event_t event);
+
+    /// Puts back a conflated notification taken by take_conflated(), see conflation_table::restore().
+    void restore_conflated(std::shared_ptr<vsomeip::message> msg);
+
+    /// Switches to the batched receive mode: messages are collected in a ring buffer of `capacity`
+    /// instead of being passed to the message handler. `callback` is invoked when the ring turns
+    /// non-empty. Called by create() before the application is started.
+    void enable_batch(std::size_t capacity, on_batch_ready_callback_t callback);
+
+    /// Keeps the last notified value of each offered field in the memory mapped file `path`. Values
+    /// cached by a previous run are notified again when their field is offered, so consumers get
+    /// initial events right after a restart. Values notified by notify_shm() are not cached.
+    /// Must be called before offering fields, returns false if a cache is already enabled.
+    bool enable_field_cache(std::string const& path, uint32_t slots, uint32_t slot_size);
+
+    /// Removes a field that is no longer offered from the field cache file, see field_cache::forget().
+    void forget_cached_field(vsomeip::service_t service, vsomeip::instance_t instance, vsomeip::event_t event);
+
+    /// Creates the shm pool `name` for sending large payloads to consumers on the same host, see
+    /// shm_pool. Returns false if it cannot be created or the application has a pool already.
+    bool create_shm_pool(std::string const& name, uint32_t segments, uint32_t segment_size);
+
+    /// Takes a segment of the shm pool for writing a payload, returns -1 if none is free.
+    int32_t shm_acquire(uint8_t*& data, uint32_t& capacity);
+
+    /// Notifies the payload of `length` bytes written to an acquired segment and gives the segment back.
+    void notify_shm(vsomeip::service_t service, vsomeip::instance_t instance, vsomeip::event_t event,
+                    int32_t segment, uint32_t length, bool force);
+
+    /// Gives an acquired segment back without notifying it.
+    void shm_discard(int32_t segment);
+
+    /// Maps the notifications of the event to the segments of the shm pool `name` of its provider.
+    bool attach_shm_pool(vsomeip::service_t service, vsomeip::instance_t instance, vsomeip::event_t event,
+                         std::string const& name);
+
+    /// Returns the number of received shm notifications dropped because their segment was reused.
+    [[nodiscard]]
+    uint64_t shm_lost() const;
+
+    /// Moves up to `max` messages from the batch ring to `out`, returns their number.
+    std::size_t drain(std::shared_ptr<vsomeip::message>* out, std::size_t max);
+
+    [[nodiscard]]
+    uint64_t batch_dropped() const;
+
     [[nodiscard]]
     std::shared_ptr<vsomeip::runtime>& runtime();
 
@@ -59,6 +207,16 @@ public:
     [[nodiscard]]
     std::shared_ptr<vsomeip::message> create_message();
 
+    /// Wraps `payload` into a handle from the application's payload pool.
+    /// The handle must be released with payload_destroy().
+    [[nodiscard]]
+    payload_t make_payload_handle(std::shared_ptr<vsomeip::payload> payload);
+
+    [[nodiscard]]
+    payload_pool_stats pool_stats() const;
+
+    void stats(application_stats& out) const;
+
     void request_service(vsomeip::service_t service, vsomeip::instance_t instance,
                          vsomeip::major_version_t major = vsomeip::ANY_MAJOR,
                          vsomeip::minor_version_t minor = vsomeip::ANY_MINOR);
@@ -101,18 +259,84 @@ public:
 
     void stop_offer_event(vsomeip::service_t service, vsomeip::instance_t instance, vsomeip::event_t event);
 
+    /// Reports the subscribers of an eventgroup of offered events joining or leaving to `callback`,
+    /// an empty callback stops reporting. The first call registers the vsomeip subscription handler
+    /// of the eventgroup, which accepts all subscriptions.
+    void watch_subscriptions(vsomeip::service_t service, vsomeip::instance_t instance, vsomeip::eventgroup_t group,
+                             subscriber_table::subscription_callback_t callback);
+
+    /// Returns the number of clients subscribed to the watched eventgroups of an offered event.
+    [[nodiscard]]
+    uint32_t subscriber_count(vsomeip::service_t service, vsomeip::instance_t instance, vsomeip::event_t event) const;
+
+    /// Reports whether subscriptions of the eventgroup are accepted or rejected by the provider.
+    void watch_subscription_status(vsomeip::service_t service, vsomeip::instance_t instance,
+                                   vsomeip::eventgroup_t group, vsomeip::event_t event,
+                                   on_subscription_status_callback_t callback);
+    void unwatch_subscription_status(vsomeip::service_t service, vsomeip::instance_t instance,
+                                     vsomeip::eventgroup_t group, vsomeip::event_t event);
+
+    /// Offers the instance in hot-standby: it starts in standby role and is offered when another
+    /// provider's offer is lost, or after `initial_wait` if no other provider has been seen by then.
+    /// `callback` reports the role, standby or active. The instance's events must be offered
+    /// beforehand, so that the takeover only has to offer the service.
+    void offer_service_standby(vsomeip::service_t service, vsomeip::instance_t instance,
+                               vsomeip::major_version_t major, vsomeip::minor_version_t minor,
+                               std::chrono::milliseconds initial_wait, standby_table::role_callback_t callback);
+
+    void stop_offer_service_standby(vsomeip::service_t service, vsomeip::instance_t instance);
+
+    /// Notifies a field, for an instance in standby role the value is only kept for the takeover.
+    void prepare_field(vsomeip::service_t service, vsomeip::instance_t instance, vsomeip::event_t event,
+                       bool force, uint8_t const* data, uint32_t data_len);
+
     void notify(vsomeip::service_t service, vsomeip::instance_t instance, vsomeip::event_t event,
                 bool force, uint8_t const* data, uint32_t data_len);
 
+    void notify(vsomeip::service_t service, vsomeip::instance_t instance, vsomeip::event_t event,
+                bool force, std::shared_ptr<vsomeip::payload> payload);
+
+    /// Creates the payloads of all entries first, then passes them to vsomeip back-to-back.
+    void notify_many(notify_entry const* entries, std::size_t count);
+
     vsomeip::session_t send_request(vsomeip::service_t service, vsomeip::instance_t instance, vsomeip::method_t method,
                       major_version major, uint8_t const* data, uint32_t data_len, bool reliable);
 
+    vsomeip::session_t send_request(vsomeip::service_t service, vsomeip::instance_t instance, vsomeip::method_t method,
+                      major_version major, std::shared_ptr<vsomeip::payload> payload, bool reliable);
+
+    /// Sends one request to each target, all sharing one payload. Writes the sessions to `sessions`.
+    void send_requests(vsomeip::service_t service, request_target const* targets, std::size_t count,
+                       major_version major, bool reliable, uint8_t const* data, uint32_t data_len,
+                       vsomeip::session_t* sessions);
+
+    /// Sends the payload of a received request on to the provider, a fire-and-forget request stays one.
+    vsomeip::session_t forward_request(vsomeip::service_t service, vsomeip::instance_t instance,
+                                       vsomeip::method_t method, major_version major, bool reliable, bool no_return,
+                                       std::shared_ptr<vsomeip::payload> payload);
+
     void send_response(service_id service, instance_id instance, method_id method,
             client_id client, session_id session, major_version major, bool reliable,
             vsomeip::return_code_e rc, uint8_t const* data, uint32_t data_len);
 
+    void send_response(service_id service, instance_id instance, method_id method,
+            client_id client, session_id session, major_version major, bool reliable,
+            vsomeip::return_code_e rc, std::shared_ptr<vsomeip::payload> payload);
+
     void send_error(service_id service, instance_id instance, method_id method, client_id client, session_id session,
                     major_version major, bool reliable, vsomeip::return_code_e rc);
+
+    /// Creates a request message with an empty payload that can be sent repeatedly with send_with().
+    [[nodiscard]]
+    std::shared_ptr<vsomeip::message> create_request_template(vsomeip::service_t service, vsomeip::instance_t instance,
+                                                              vsomeip::method_t method, major_version major,
+                                                              bool reliable);
+
+    /// Replaces the payload data of the request template `msg` and sends it.
+    /// The payload object is reused, so only its data is copied. Returns the assigned session.
+    vsomeip::session_t send_with(std::shared_ptr<vsomeip::message> const& msg, uint8_t const* data, uint32_t data_len);
+
+    void send(std::shared_ptr<vsomeip::message> const& msg);
 };
 
 #endif // APPLICATION_H_
@@ -0,0 +1,85 @@
+// SPDX-License-Identifier: MPL-2.0
+//
+// Copyright (C) 2024 Alexander Seifarth
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include "buffer_payload.h"
+
+#include <cstring>
+
+buffer_payload::buffer_payload(uint8_t const* data, uint32_t size, release_t release, void* context)
+        : _data{data}
+        , _size{size}
+        , _release{release}
+        , _context{context}
+        , _owned{}
+{}
+
+buffer_payload::~buffer_payload() {
+    release();
+}
+
+void buffer_payload::release() {
+    if (_release) {
+        _release(_context);
+        _release = nullptr;
+    }
+    _context = nullptr;
+}
+
+bool buffer_payload::operator==(const vsomeip::payload& other) {
+    return _size == other.get_length()
+        && (_size == 0 || std::memcmp(_data, other.get_data(), _size) == 0);
+}
+
+vsomeip::byte_t* buffer_payload::get_data() {
+    // vsomeip only reads through this accessor (e.g. to compare field values), writes always go
+    // through set_data() which detaches from the caller's buffer.
+    return const_cast<vsomeip::byte_t*>(_data);
+}
+
+const vsomeip::byte_t* buffer_payload::get_data() const {
+    return _data;
+}
+
+void buffer_payload::set_data(const vsomeip::byte_t* data, vsomeip::length_t length) {
+    _owned.assign(data, data + length);
+    release();
+    _data = _owned.data();
+    _size = static_cast<uint32_t>(_owned.size());
+}
+
+void buffer_payload::set_data(const std::shared_ptr<vsomeip::payload>& data) {
+    set_data(data->get_data(), data->get_length());
+}
+
+void buffer_payload::set_data(std::vector<vsomeip::byte_t>&& data) {
+    _owned = std::move(data);
+    release();
+    _data = _owned.data();
+    _size = static_cast<uint32_t>(_owned.size());
+}
+
+void buffer_payload::set_data(const std::vector<vsomeip::byte_t>& data) {
+    set_data(data.data(), static_cast<vsomeip::length_t>(data.size()));
+}
+
+vsomeip::length_t buffer_payload::get_length() const {
+    return _size;
+}
+
+void buffer_payload::set_capacity(vsomeip::length_t length) {
+    _owned.reserve(length);
+}
+
+bool buffer_payload::serialize(vsomeip::serializer* to) const {
+    // the serializer is not part of vsomeip's public API, only its own payloads can write to it
+    return to && vsomeip::runtime::get()->create_payload(_data, _size)->serialize(to);
+}
+
+bool buffer_payload::deserialize(vsomeip::deserializer*) {
+    // buffer payloads are only used for sending
+    return false;
+}
@@ -0,0 +1,61 @@
+// SPDX-License-Identifier: MPL-2.0
+//
+// Copyright (C) 2024 Alexander Seifarth
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef BUFFER_PAYLOAD_H_
+#define BUFFER_PAYLOAD_H_
+
+#include <vsomeip/vsomeip.hpp>
+
+#include <cstdint>
+#include <vector>
+
+/// vsomeip payload that refers to a caller-owned buffer instead of copying it.
+///
+/// The buffer must stay valid and unmodified until `release(context)` is invoked, which happens
+/// when vsomeip drops the payload. Modifying the payload through one of the set_data() methods
+/// copies the data into an owned buffer and releases the caller's buffer early.
+///
+/// The buffer only saves a copy where vsomeip reads the data through get_data(), i.e. for notified
+/// values (vsomeip copies them into its event) and resolved shared memory payloads. serialize()
+/// goes through a vsomeip payload made from the buffer because vsomeip's serializer is not public,
+/// so buffer payloads are not used for requests and responses.
+class buffer_payload : public vsomeip::payload {
+public:
+    using release_t = void (*)(void* context);
+
+    buffer_payload(uint8_t const* data, uint32_t size, release_t release, void* context);
+    buffer_payload(buffer_payload const&) = delete;
+    ~buffer_payload() override;
+
+    bool operator==(const vsomeip::payload& other) override;
+
+    vsomeip::byte_t* get_data() override;
+    const vsomeip::byte_t* get_data() const override;
+
+    void set_data(const vsomeip::byte_t* data, vsomeip::length_t length) override;
+    void set_data(const std::shared_ptr<vsomeip::payload>& data) override;
+    void set_data(std::vector<vsomeip::byte_t>&& data) override;
+    void set_data(const std::vector<vsomeip::byte_t>& data) override;
+
+    vsomeip::length_t get_length() const override;
+    void set_capacity(vsomeip::length_t length) override;
+
+    bool serialize(vsomeip::serializer* to) const override;
+    bool deserialize(vsomeip::deserializer* from) override;
+
+private:
+    /// Gives the caller's buffer back, afterwards the payload only refers to `_owned`.
+    void release();
+
+    uint8_t const* _data;
+    uint32_t _size;
+    release_t _release;
+    void* _context;
+    std::vector<vsomeip::byte_t> _owned;
+};
+
+#endif // BUFFER_PAYLOAD_H_
@@ -0,0 +1,126 @@
+// SPDX-License-Identifier: MPL-2.0
+//
+// Copyright (C) 2024 Alexander Seifarth
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include "conflation_table.h"
+
+conflation_table::conflation_table(std::size_t capacity)
+        : _mutex{}
+        , _slots(capacity)
+        , _enabled{0}
+{}
+
+uint64_t conflation_table::make_key(vsomeip::service_t service, vsomeip::instance_t instance, vsomeip::event_t event) {
+    return (uint64_t(service) << 32) | (uint64_t(instance) << 16) | uint64_t(event);
+}
+
+conflation_table::slot* conflation_table::find(uint64_t key, bool insert) {
+    if (_slots.empty()) {
+        return nullptr;
+    }
+    // open addressing with linear probing, slots are never released so no tombstones are needed
+    auto const size = _slots.size();
+    auto idx = std::size_t((key * 0x9E3779B97F4A7C15ull) >> 32) % size;
+    for (std::size_t n = 0; n < size; ++n, idx = (idx + 1) % size) {
+        auto& s = _slots[idx];
+        if (!s.used) {
+            if (!insert) {
+                return nullptr;
+            }
+            s.used = true;
+            s.key = key;
+            return &s;
+        }
+        if (s.key == key) {
+            return &s;
+        }
+    }
+    return nullptr;
+}
+
+bool conflation_table::enable(vsomeip::service_t service, vsomeip::instance_t instance, vsomeip::event_t event,
+                              dirty_callback_t callback)
+{
+    std::lock_guard<std::mutex> lock{_mutex};
+    auto s = find(make_key(service, instance, event), true);
+    if (!s) {
+        return false;
+    }
+    if (!s->enabled) {
+        s->enabled = true;
+        ++_enabled;
+    }
+    s->on_dirty = std::move(callback);
+    return true;
+}
+
+void conflation_table::disable(vsomeip::service_t service, vsomeip::instance_t instance, vsomeip::event_t event) {
+    std::shared_ptr<vsomeip::message> latest;
+    dirty_callback_t callback;
+    {
+        std::lock_guard<std::mutex> lock{_mutex};
+        auto s = find(make_key(service, instance, event), false);
+        if (!s || !s->enabled) {
+            return;
+        }
+        s->enabled = false;
+        s->dirty = false;
+        --_enabled;
+        latest = std::move(s->latest);
+        callback = std::move(s->on_dirty);
+    }
+}
+
+bool conflation_table::offer(std::shared_ptr<vsomeip::message> const& msg) {
+    if (_enabled.load(std::memory_order_relaxed) == 0
+        || msg->get_message_type() != vsomeip::message_type_e::MT_NOTIFICATION) {
+        return false;
+    }
+    dirty_callback_t callback;
+    std::shared_ptr<vsomeip::message> replaced;
+    {
+        std::lock_guard<std::mutex> lock{_mutex};
+        auto s = find(make_key(msg->get_service(), msg->get_instance(), msg->get_method()), false);
+        if (!s || !s->enabled) {
+            return false;
+        }
+        // the replaced message is released outside the lock
+        replaced = std::move(s->latest);
+        s->latest = msg;
+        if (!s->dirty) {
+            s->dirty = true;
+            callback = s->on_dirty;
+        }
+    }
+    if (callback) {
+        callback(msg->get_service(), msg->get_instance(), msg->get_method());
+    }
+    return true;
+}
+
+std::shared_ptr<vsomeip::message> conflation_table::take(vsomeip::service_t service, vsomeip::instance_t instance,
+                                                         vsomeip::event_t event)
+{
+    std::lock_guard<std::mutex> lock{_mutex};
+    auto s = find(make_key(service, instance, event), false);
+    if (!s || !s->dirty) {
+        return nullptr;
+    }
+    s->dirty = false;
+    return std::move(s->latest);
+}
+
+void conflation_table::restore(std::shared_ptr<vsomeip::message> msg)
+{
+    std::lock_guard<std::mutex> lock{_mutex};
+    auto s = find(make_key(msg->get_service(), msg->get_instance(), msg->get_method()), false);
+    if (!s || !s->enabled || s->dirty) {
+        return;
+    }
+    // the consumer asked for the value already, it is not signalled again
+    s->dirty = true;
+    s->latest = std::move(msg);
+}
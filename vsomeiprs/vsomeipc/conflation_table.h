@@ -0,0 +1,74 @@
+// SPDX-License-Identifier: MPL-2.0
+//
+// Copyright (C) 2024 Alexander Seifarth
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef CONFLATION_TABLE_H_
+#define CONFLATION_TABLE_H_
+
+#include <vsomeip/vsomeip.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/// Fixed slot table keeping only the latest notification of "conflated" events.
+///
+/// A notification of a conflated event is not forwarded to the message handler, it replaces the
+/// value kept in the event's slot instead. Only when a slot turns from clean to dirty the dirty
+/// callback is invoked, the consumer then fetches the latest message with take().
+/// Slots are never freed: disabling an event keeps its slot reserved for a later re-enable.
+class conflation_table {
+public:
+    using dirty_callback_t = std::function<void(vsomeip::service_t, vsomeip::instance_t, vsomeip::event_t)>;
+
+    static constexpr std::size_t default_capacity = 256;
+
+    explicit conflation_table(std::size_t capacity = default_capacity);
+    conflation_table(conflation_table const&) = delete;
+
+    /// Enables conflation for the event. Returns false if the table has no free slot.
+    bool enable(vsomeip::service_t service, vsomeip::instance_t instance, vsomeip::event_t event,
+                dirty_callback_t callback);
+
+    void disable(vsomeip::service_t service, vsomeip::instance_t instance, vsomeip::event_t event);
+
+    /// Stores `msg` if it is a notification of a conflated event.
+    /// Returns true when the message has been consumed by the table.
+    bool offer(std::shared_ptr<vsomeip::message> const& msg);
+
+    /// Returns the latest notification of the event and marks it clean, or nullptr if it is clean.
+    [[nodiscard]]
+    std::shared_ptr<vsomeip::message> take(vsomeip::service_t service, vsomeip::instance_t instance,
+                                           vsomeip::event_t event);
+
+    /// Puts back a message returned by take() that could not be passed on, so that it is taken
+    /// again. A newer notification stored meanwhile is kept instead.
+    void restore(std::shared_ptr<vsomeip::message> msg);
+
+private:
+    struct slot {
+        uint64_t key;
+        bool used;
+        bool enabled;
+        bool dirty;
+        std::shared_ptr<vsomeip::message> latest;
+        dirty_callback_t on_dirty;
+    };
+
+    static uint64_t make_key(vsomeip::service_t service, vsomeip::instance_t instance, vsomeip::event_t event);
+
+    /// Returns the slot for `key` (if `insert` a free slot is reserved), nullptr if not found/full.
+    slot* find(uint64_t key, bool insert);
+
+    std::mutex _mutex;
+    std::vector<slot> _slots;
+    std::atomic<std::size_t> _enabled;
+};
+
+#endif // CONFLATION_TABLE_H_
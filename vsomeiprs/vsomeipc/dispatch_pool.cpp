@@ -0,0 +1,93 @@
+// SPDX-License-Identifier: MPL-2.0
+//
+// Copyright (C) 2024 Alexander Seifarth
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include "dispatch_pool.h"
+
+#include <cassert>
+
+dispatch_pool::dispatch_pool(std::size_t workers, std::size_t capacity, overflow_policy_e overflow, handler_t handler)
+        : _capacity{capacity > 0 ? capacity : default_capacity}
+        , _overflow{overflow}
+        , _handler{std::move(handler)}
+        , _workers{}
+        , _dropped{0}
+{
+    assert(workers > 0);
+    _workers.reserve(workers);
+    for (std::size_t i = 0; i < workers; ++i) {
+        _workers.emplace_back(std::make_unique<worker>());
+    }
+    for (auto& w : _workers) {
+        w->thread = std::thread([this, w = w.get()] { run(*w); });
+    }
+}
+
+dispatch_pool::~dispatch_pool() {
+    stop();
+}
+
+void dispatch_pool::post(std::shared_ptr<vsomeip::message> const& msg, uint64_t trace_ns) {
+    auto& w = *_workers[msg->get_service() % _workers.size()];
+    bool wake;
+    {
+        std::unique_lock<std::mutex> lock{w.mutex};
+        if (_overflow == OP_BLOCK) {
+            w.not_full.wait(lock, [this, &w] { return w.stopped || w.queue.size() < _capacity; });
+        }
+        if (w.stopped) {
+            return;
+        }
+        if (w.queue.size() >= _capacity) {
+            _dropped.fetch_add(1, std::memory_order_relaxed);
+            if (_overflow == OP_DROP_NEWEST) {
+                return;
+            }
+            w.queue.pop_front();
+        }
+        wake = w.queue.empty();
+        w.queue.push_back(item{msg, trace_ns});
+    }
+    if (wake) {
+        w.cv.notify_one();
+    }
+}
+
+uint64_t dispatch_pool::dropped() const {
+    return _dropped.load(std::memory_order_relaxed);
+}
+
+void dispatch_pool::stop() {
+    for (auto& w : _workers) {
+        std::lock_guard<std::mutex> lock{w->mutex};
+        w->stopped = true;
+        w->queue.clear();
+    }
+    for (auto& w : _workers) {
+        w->cv.notify_one();
+        w->not_full.notify_all();
+        if (w->thread.joinable()) {
+            w->thread.join();
+        }
+    }
+}
+
+void dispatch_pool::run(worker& w) {
+    std::unique_lock<std::mutex> lock{w.mutex};
+    while (true) {
+        w.cv.wait(lock, [&w] { return w.stopped || !w.queue.empty(); });
+        if (w.stopped) {
+            return;
+        }
+        auto next = std::move(w.queue.front());
+        w.queue.pop_front();
+        lock.unlock();
+        w.not_full.notify_one();
+        _handler(next.msg, next.trace_ns);
+        next.msg.reset();
+        lock.lock();
+    }
+}
@@ -0,0 +1,77 @@
+// SPDX-License-Identifier: MPL-2.0
+//
+// Copyright (C) 2024 Alexander Seifarth
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef DISPATCH_POOL_H_
+#define DISPATCH_POOL_H_
+
+#include <vsomeip/vsomeip.hpp>
+
+#include "vsomeipc.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// Worker threads executing the message callback off the vsomeip dispatcher.
+///
+/// Messages are sharded by service id, so all messages of a service are handled by the same worker
+/// in arrival order while different services are handled in parallel. A slow callback then only
+/// stalls the services of its worker.
+///
+/// Each worker queues at most `capacity` messages, `overflow` decides what happens when a message
+/// is posted to a full queue.
+class dispatch_pool {
+public:
+    /// Invoked with the message and the trace stamp passed to post().
+    using handler_t = std::function<void(std::shared_ptr<vsomeip::message> const&, uint64_t)>;
+
+    static constexpr std::size_t default_capacity = 1024;
+
+    dispatch_pool(std::size_t workers, std::size_t capacity, overflow_policy_e overflow, handler_t handler);
+    dispatch_pool(dispatch_pool const&) = delete;
+    ~dispatch_pool();
+
+    /// Queues `msg` at the worker of its service. With OP_BLOCK it waits while the queue is full.
+    void post(std::shared_ptr<vsomeip::message> const& msg, uint64_t trace_ns);
+
+    /// Returns the number of messages discarded at full queues.
+    uint64_t dropped() const;
+
+    /// Stops and joins the workers, messages not yet handled are discarded.
+    void stop();
+
+private:
+    struct item {
+        std::shared_ptr<vsomeip::message> msg;
+        uint64_t trace_ns;
+    };
+
+    struct worker {
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::condition_variable not_full;
+        std::deque<item> queue;
+        bool stopped = false;
+        std::thread thread;
+    };
+
+    void run(worker& w);
+
+    std::size_t _capacity;
+    overflow_policy_e _overflow;
+    handler_t _handler;
+    std::vector<std::unique_ptr<worker>> _workers;
+    std::atomic<uint64_t> _dropped;
+};
+
+#endif // DISPATCH_POOL_H_
@@ -0,0 +1,200 @@
+// SPDX-License-Identifier: MPL-2.0
+//
+// Copyright (C) 2024 Alexander Seifarth
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include "field_cache.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free,
+              "the field cache requires lock free atomics in shared memory");
+
+std::unique_ptr<field_cache> field_cache::open(std::string const& path, uint32_t slots, uint32_t slot_size) {
+    if (slots == 0) {
+        return nullptr;
+    }
+    std::size_t size = sizeof(header) + alignof(slot) + stride_of(slot_size) * slots;
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0600);
+    if (fd < 0) {
+        std::cerr << "Cannot open field cache " << path << ": " << std::strerror(errno) << "\n";
+        return nullptr;
+    }
+    struct stat st{};
+    bool reinit = ::fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) != size;
+    // truncating to 0 first zeroes the file
+    if (reinit && (::ftruncate(fd, 0) != 0 || ::ftruncate(fd, static_cast<off_t>(size)) != 0)) {
+        std::cerr << "Cannot resize field cache " << path << ": " << std::strerror(errno) << "\n";
+        ::close(fd);
+        return nullptr;
+    }
+    void* base = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED) {
+        std::cerr << "Cannot map field cache " << path << ": " << std::strerror(errno) << "\n";
+        return nullptr;
+    }
+    auto hdr = static_cast<header*>(base);
+    if (hdr->magic != magic || hdr->version != version || hdr->slots != slots || hdr->slot_size != slot_size) {
+        std::memset(base, 0, size);
+        *hdr = header{magic, version, slots, slot_size};
+    }
+    return std::unique_ptr<field_cache>{new field_cache(base, size, slots, slot_size)};
+}
+
+field_cache::field_cache(void* base, std::size_t size, uint32_t slots, uint32_t slot_size)
+        : _base{base}
+        , _size{size}
+        , _slots{slots}
+        , _slot_size{slot_size}
+        , _stride{stride_of(slot_size)}
+        , _tracked{new std::atomic<bool>[slots]{}}
+        , _mutex{}
+{
+    for (std::size_t idx = 0; idx < _slots; ++idx) {
+        auto s = slot_at(idx);
+        uint32_t seq = s->sequence.load(std::memory_order_relaxed);
+        if (seq % 2 != 0) {
+            // the previous process crashed while writing the value
+            s->length = no_value;
+            s->sequence.store(seq + 1, std::memory_order_relaxed);
+        }
+    }
+}
+
+field_cache::~field_cache() {
+    ::munmap(_base, _size);
+}
+
+std::size_t field_cache::stride_of(uint32_t slot_size) {
+    return (sizeof(slot) + slot_size + alignof(slot) - 1) / alignof(slot) * alignof(slot);
+}
+
+uint64_t field_cache::make_key(vsomeip::service_t service, vsomeip::instance_t instance, vsomeip::event_t event) {
+    return 1ull << 63 | static_cast<uint64_t>(service) << 32 | static_cast<uint64_t>(instance) << 16 | event;
+}
+
+field_cache::slot* field_cache::slot_at(std::size_t idx) const {
+    auto first = reinterpret_cast<uintptr_t>(_base) + sizeof(header);
+    first = (first + alignof(slot) - 1) / alignof(slot) * alignof(slot);
+    return reinterpret_cast<slot*>(first + idx * _stride);
+}
+
+std::size_t field_cache::find(uint64_t key, bool insert) {
+    std::size_t start = static_cast<std::size_t>((key * 0x9e3779b97f4a7c15ull) >> 32) % _slots;
+    std::size_t probes = std::min<std::size_t>(_slots, max_probes);
+    std::size_t reuse = npos;
+    for (std::size_t n = 0; n < probes; ++n) {
+        std::size_t idx = (start + n) % _slots;
+        uint64_t k = slot_at(idx)->key.load(std::memory_order_acquire);
+        if (k == key) {
+            return idx;
+        }
+        if (k == 0) {
+            // keys are inserted at the first usable slot, none follows a free one
+            if (reuse == npos) {
+                reuse = idx;
+            }
+            break;
+        }
+        if (reuse == npos && (k == removed || !_tracked[idx].load(std::memory_order_relaxed))) {
+            reuse = idx;
+        }
+    }
+    if (!insert || reuse == npos) {
+        return npos;
+    }
+    auto s = slot_at(reuse);
+    write(s, nullptr, no_value);
+    s->key.store(key, std::memory_order_release);
+    return reuse;
+}
+
+bool field_cache::track(vsomeip::service_t service, vsomeip::instance_t instance, vsomeip::event_t event,
+                        std::vector<vsomeip::byte_t>& value)
+{
+    std::size_t idx;
+    {
+        std::lock_guard<std::mutex> lock{_mutex};
+        idx = find(make_key(service, instance, event), true);
+        if (idx == npos) {
+            std::cerr << "Field cache is full, field " << std::hex << service << "." << instance << "." << event
+                      << std::dec << " is not cached\n";
+            return false;
+        }
+        _tracked[idx].store(true, std::memory_order_release);
+    }
+    auto s = slot_at(idx);
+    auto data = reinterpret_cast<vsomeip::byte_t const*>(s + 1);
+    for (;;) {
+        uint32_t before = s->sequence.load(std::memory_order_acquire);
+        if (before % 2 == 0) {
+            uint32_t length = s->length;
+            if (length != no_value && length <= _slot_size) {
+                value.assign(data, data + length);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (s->sequence.load(std::memory_order_relaxed) == before) {
+                return length != no_value && length <= _slot_size;
+            }
+        }
+    }
+}
+
+void field_cache::untrack(vsomeip::service_t service, vsomeip::instance_t instance, vsomeip::event_t event) {
+    std::lock_guard<std::mutex> lock{_mutex};
+    if (auto idx = find(make_key(service, instance, event), false); idx != npos) {
+        _tracked[idx].store(false, std::memory_order_release);
+    }
+}
+
+void field_cache::forget(vsomeip::service_t service, vsomeip::instance_t instance, vsomeip::event_t event) {
+    std::lock_guard<std::mutex> lock{_mutex};
+    if (auto idx = find(make_key(service, instance, event), false); idx != npos) {
+        _tracked[idx].store(false, std::memory_order_release);
+        auto s = slot_at(idx);
+        write(s, nullptr, no_value);
+        // a free slot would end the probing for keys inserted behind it
+        s->key.store(removed, std::memory_order_release);
+    }
+}
+
+void field_cache::store(vsomeip::service_t service, vsomeip::instance_t instance, vsomeip::event_t event,
+                        vsomeip::byte_t const* data, uint32_t data_len)
+{
+    if (auto idx = find(make_key(service, instance, event), false);
+        idx != npos && _tracked[idx].load(std::memory_order_acquire)) {
+        write(slot_at(idx), data, data_len);
+    }
+}
+
+void field_cache::clear(vsomeip::service_t service, vsomeip::instance_t instance, vsomeip::event_t event) {
+    if (auto idx = find(make_key(service, instance, event), false); idx != npos) {
+        write(slot_at(idx), nullptr, no_value);
+    }
+}
+
+void field_cache::write(slot* s, vsomeip::byte_t const* data, uint32_t data_len) {
+    // writers of the same field exclude each other by moving the sequence from even to odd
+    uint32_t seq = s->sequence.load(std::memory_order_relaxed);
+    do {
+        seq &= ~1u;
+    } while (!s->sequence.compare_exchange_weak(seq, seq + 1, std::memory_order_acquire));
+    std::atomic_thread_fence(std::memory_order_release);
+    if (data_len <= _slot_size) {
+        std::memcpy(reinterpret_cast<vsomeip::byte_t*>(s + 1), data, data_len);
+        s->length = data_len;
+    } else {
+        s->length = no_value;
+    }
+    s->sequence.store(seq + 2, std::memory_order_release);
+}
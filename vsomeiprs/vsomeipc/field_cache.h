@@ -0,0 +1,109 @@
+// SPDX-License-Identifier: MPL-2.0
+//
+// Copyright (C) 2024 Alexander Seifarth
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef FIELD_CACHE_H_
+#define FIELD_CACHE_H_
+
+#include <vsomeip/vsomeip.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/// Memory mapped file keeping the last notified value of each offered field across restarts.
+///
+/// The file holds a fixed number of slots of fixed size, found by open addressing on the key
+/// `service << 32 | instance << 16 | event` within `max_probes` slots. Each slot is written under a
+/// sequence lock: the sequence is odd while the value is written, so a value torn by a crash of the
+/// process is detected and discarded when the file is opened again. Values larger than the slot
+/// size are not cached.
+///
+/// Only the fields tracked by this process are stored, so notifying other events costs a short
+/// lookup. Slots of fields a previous run cached but this process does not track are reused
+/// when a new field finds no free slot.
+class field_cache {
+public:
+    field_cache(field_cache const&) = delete;
+    ~field_cache();
+
+    /// Opens or creates the cache file. A file with a different layout is reinitialized.
+    /// Returns nullptr if the file cannot be mapped.
+    [[nodiscard]]
+    static std::unique_ptr<field_cache> open(std::string const& path, uint32_t slots, uint32_t slot_size);
+
+    /// Starts caching the field and returns its cached value in `value` if there is one.
+    bool track(vsomeip::service_t service, vsomeip::instance_t instance, vsomeip::event_t event,
+               std::vector<vsomeip::byte_t>& value);
+
+    /// Stops caching the field, e.g. when it is no longer offered. The cached value is kept for the
+    /// next run.
+    void untrack(vsomeip::service_t service, vsomeip::instance_t instance, vsomeip::event_t event);
+
+    /// Removes the field and its cached value from the file and frees its slot.
+    void forget(vsomeip::service_t service, vsomeip::instance_t instance, vsomeip::event_t event);
+
+    /// Stores the value of a field that is tracked, other events are ignored.
+    void store(vsomeip::service_t service, vsomeip::instance_t instance, vsomeip::event_t event,
+               vsomeip::byte_t const* data, uint32_t data_len);
+
+    /// Discards the cached value of a tracked field, e.g. when it was notified with a value that
+    /// is only valid while this process runs.
+    void clear(vsomeip::service_t service, vsomeip::instance_t instance, vsomeip::event_t event);
+
+private:
+    struct header {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t slots;
+        uint32_t slot_size;
+    };
+
+    struct slot {
+        std::atomic<uint64_t> key;      // 0 for a free slot, removed for a forgotten one, else the key with bit 63 set
+        std::atomic<uint32_t> sequence;
+        uint32_t length;                // no_value if the slot has no valid value
+        // followed by slot_size bytes of data
+    };
+
+    static constexpr uint32_t magic = 0x46434143;   // "CACF"
+    static constexpr uint32_t version = 2;
+    static constexpr uint32_t no_value = UINT32_MAX;
+    static constexpr uint64_t removed = UINT64_MAX;
+    static constexpr std::size_t max_probes = 16;
+    static constexpr std::size_t npos = SIZE_MAX;
+
+    field_cache(void* base, std::size_t size, uint32_t slots, uint32_t slot_size);
+
+    static std::size_t stride_of(uint32_t slot_size);
+
+    static uint64_t make_key(vsomeip::service_t service, vsomeip::instance_t instance, vsomeip::event_t event);
+
+    /// Returns the index of the slot for `key`, npos if not found. If `insert` a free, forgotten
+    /// or untracked slot is claimed for a new key, npos then means that none is left.
+    /// Inserting requires `_mutex`.
+    std::size_t find(uint64_t key, bool insert);
+
+    slot* slot_at(std::size_t idx) const;
+
+    /// Writes a value to `s` under its sequence lock, a value larger than the slot invalidates it.
+    void write(slot* s, vsomeip::byte_t const* data, uint32_t data_len);
+
+    void* _base;
+    std::size_t _size;
+    uint32_t _slots;
+    uint32_t _slot_size;
+    std::size_t _stride;
+    /// Whether this process tracks the field of a slot.
+    std::unique_ptr<std::atomic<bool>[]> _tracked;
+    /// Serializes tracking, untracking and forgetting fields.
+    std::mutex _mutex;
+};
+
+#endif // FIELD_CACHE_H_
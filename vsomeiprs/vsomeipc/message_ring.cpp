@@ -0,0 +1,44 @@
+// SPDX-License-Identifier: MPL-2.0
+//
+// Copyright (C) 2024 Alexander Seifarth
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include "message_ring.h"
+
+#include <cassert>
+
+message_ring::message_ring(std::size_t capacity)
+        : _mutex{}
+        , _slots(capacity)
+        , _head{0}
+        , _size{0}
+        , _dropped{0}
+{
+    assert(capacity > 0);
+}
+
+message_ring::push_result message_ring::push(std::shared_ptr<vsomeip::message> const& msg) {
+    std::lock_guard<std::mutex> lock{_mutex};
+    if (_size == _slots.size()) {
+        _dropped.fetch_add(1, std::memory_order_relaxed);
+        return push_result::dropped;
+    }
+    _slots[(_head + _size) % _slots.size()] = msg;
+    return ++_size == 1 ? push_result::first : push_result::queued;
+}
+
+std::size_t message_ring::drain(std::shared_ptr<vsomeip::message>* out, std::size_t max) {
+    std::lock_guard<std::mutex> lock{_mutex};
+    std::size_t n = 0;
+    for (; n < max && _size > 0; ++n, --_size) {
+        out[n] = std::move(_slots[_head]);
+        _head = (_head + 1) % _slots.size();
+    }
+    return n;
+}
+
+uint64_t message_ring::dropped() const {
+    return _dropped.load(std::memory_order_relaxed);
+}
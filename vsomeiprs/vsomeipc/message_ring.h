@@ -0,0 +1,47 @@
+// SPDX-License-Identifier: MPL-2.0
+//
+// Copyright (C) 2024 Alexander Seifarth
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef MESSAGE_RING_H_
+#define MESSAGE_RING_H_
+
+#include <vsomeip/vsomeip.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/// Fixed capacity ring buffer of received messages for the batched receive mode.
+///
+/// Messages are pushed on the vsomeip dispatch thread and drained in bulk by the consumer.
+/// A message arriving at a full ring is dropped and counted.
+class message_ring {
+    std::mutex _mutex;
+    std::vector<std::shared_ptr<vsomeip::message>> _slots;
+    std::size_t _head;
+    std::size_t _size;
+    std::atomic<uint64_t> _dropped;
+
+public:
+    explicit message_ring(std::size_t capacity);
+    message_ring(message_ring const&) = delete;
+
+    enum class push_result { first, queued, dropped };
+
+    /// Appends `msg`. Returns push_result::first when the ring was empty before, i.e. the consumer
+    /// has to be woken up.
+    push_result push(std::shared_ptr<vsomeip::message> const& msg);
+
+    /// Moves up to `max` messages in arrival order to `out` and returns their number.
+    std::size_t drain(std::shared_ptr<vsomeip::message>* out, std::size_t max);
+
+    [[nodiscard]]
+    uint64_t dropped() const;
+};
+
+#endif // MESSAGE_RING_H_
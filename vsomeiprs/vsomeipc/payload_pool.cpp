@@ -0,0 +1,112 @@
+// SPDX-License-Identifier: MPL-2.0
+//
+// Copyright (C) 2024 Alexander Seifarth
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include "payload_pool.h"
+
+#include <cassert>
+
+payload_pool::payload_pool(std::size_t capacity)
+        : _mutex{}
+        , _free{}
+        , _capacity{ capacity }
+        , _outstanding{0}
+        , _hits{0}
+        , _misses{0}
+        , _exhausted{0}
+        , _closed{false}
+{
+    _free.reserve(_capacity);
+#ifdef VSOMEIPC_STATIC_MEMORY
+    _arena.reset(new payload_handle[_capacity]);
+    for (std::size_t i = _capacity; i > 0; --i) {
+        _arena[i - 1].owner = this;
+        _free.push_back(&_arena[i - 1]);
+    }
+#endif
+}
+
+payload_pool::~payload_pool() {
+#ifndef VSOMEIPC_STATIC_MEMORY
+    for (auto handle : _free) {
+        delete handle;
+    }
+#endif
+}
+
+payload_handle* payload_pool::acquire(std::shared_ptr<vsomeip::payload> payload) {
+    payload_handle* handle = nullptr;
+    {
+        std::lock_guard<std::mutex> lock{_mutex};
+        assert(!_closed);
+        ++_outstanding;
+        if (!_free.empty()) {
+            handle = _free.back();
+            _free.pop_back();
+            ++_hits;
+        } else {
+#ifdef VSOMEIPC_STATIC_MEMORY
+            --_outstanding;
+            ++_exhausted;
+            return nullptr;
+#else
+            ++_misses;
+#endif
+        }
+    }
+    if (!handle) {
+        handle = new payload_handle{ nullptr, this };
+    }
+    handle->payload = std::move(payload);
+    return handle;
+}
+
+void payload_pool::release(payload_handle* handle) {
+    assert(handle && handle->owner == this);
+    // drop the vsomeip payload outside the lock, this may free the message buffer
+    handle->payload.reset();
+
+    bool last = false;
+    {
+        std::lock_guard<std::mutex> lock{_mutex};
+        assert(_outstanding > 0);
+        --_outstanding;
+#ifdef VSOMEIPC_STATIC_MEMORY
+        // arena handles are freed with the arena
+        _free.push_back(handle);
+        handle = nullptr;
+#else
+        if (!_closed && _free.size() < _capacity) {
+            _free.push_back(handle);
+            handle = nullptr;
+        }
+#endif
+        last = _closed && _outstanding == 0;
+    }
+    delete handle;
+    if (last) {
+        delete this;
+    }
+}
+
+void payload_pool::close() {
+    bool last = false;
+    {
+        std::lock_guard<std::mutex> lock{_mutex};
+        assert(!_closed);
+        _closed = true;
+        last = _outstanding == 0;
+    }
+    if (last) {
+        delete this;
+    }
+}
+
+payload_pool_stats payload_pool::stats() {
+    std::lock_guard<std::mutex> lock{_mutex};
+    return payload_pool_stats{ _hits, _misses, _exhausted,
+                               static_cast<uint32_t>(_free.size()), static_cast<uint32_t>(_outstanding) };
+}
@@ -0,0 +1,74 @@
+// SPDX-License-Identifier: MPL-2.0
+//
+// Copyright (C) 2024 Alexander Seifarth
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef PAYLOAD_POOL_H_
+#define PAYLOAD_POOL_H_
+
+#include "vsomeipc.h"
+
+#include <vsomeip/vsomeip.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class payload_pool;
+
+/// The object behind a payload_t handle.
+/// Pooled handles remember the pool they have to be returned to, unpooled handles have no owner.
+struct payload_handle {
+    std::shared_ptr<vsomeip::payload> payload;
+    payload_pool* owner;
+};
+
+/// Free list of payload handles that are recycled instead of being allocated for each message.
+///
+/// Handles are acquired on the vsomeip dispatch thread and released from whatever thread drops
+/// the payload on the Rust side. The pool must therefore outlive its application: the owning
+/// application calls close() on destruction and the pool deletes itself once the last
+/// outstanding handle has been released.
+///
+/// With VSOMEIPC_STATIC_MEMORY all `capacity` handles are allocated up front in one arena and
+/// acquire() returns nullptr when none is free (counted as exhausted) instead of allocating.
+class payload_pool {
+    std::mutex _mutex;
+    std::vector<payload_handle*> _free;
+    std::size_t const _capacity;
+    std::size_t _outstanding;
+    uint64_t _hits;
+    uint64_t _misses;
+    uint64_t _exhausted;
+    bool _closed;
+#ifdef VSOMEIPC_STATIC_MEMORY
+    std::unique_ptr<payload_handle[]> _arena;
+#endif
+
+    ~payload_pool();
+
+public:
+    static constexpr std::size_t default_capacity = 1024;
+
+    explicit payload_pool(std::size_t capacity = default_capacity);
+    payload_pool(payload_pool const&) = delete;
+
+    /// Returns a handle for `payload`, taken from the free list when possible.
+    /// Returns nullptr if the arena is exhausted (VSOMEIPC_STATIC_MEMORY only).
+    [[nodiscard]]
+    payload_handle* acquire(std::shared_ptr<vsomeip::payload> payload);
+
+    /// Returns a handle to the free list (or deletes it if the free list is full or the pool closed).
+    void release(payload_handle* handle);
+
+    /// Detaches the pool from its application. No further handles must be acquired afterwards.
+    void close();
+
+    [[nodiscard]]
+    payload_pool_stats stats();
+};
+
+#endif // PAYLOAD_POOL_H_
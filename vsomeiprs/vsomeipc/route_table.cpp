@@ -0,0 +1,93 @@
+// SPDX-License-Identifier: MPL-2.0
+//
+// Copyright (C) 2024 Alexander Seifarth
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include "route_table.h"
+
+#include <algorithm>
+#include <mutex>
+
+route_table::route_table()
+        : _mutex{}
+        , _ranges{}
+        , _entries{}
+        , _count{0}
+        , _last_id{0}
+{}
+
+uint64_t route_table::make_key(vsomeip::service_t service, vsomeip::instance_t instance, vsomeip::method_t method) {
+    return (uint64_t(service) << 32) | (uint64_t(instance) << 16) | uint64_t(method);
+}
+
+std::ptrdiff_t route_table::find(uint64_t key) const {
+    // first range starting behind key, its predecessor is the only candidate
+    auto it = std::upper_bound(_ranges.begin(), _ranges.end(), key,
+                               [](uint64_t k, range const& r) { return k < r.first; });
+    if (it == _ranges.begin()) {
+        return -1;
+    }
+    --it;
+    return key <= it->last ? it - _ranges.begin() : -1;
+}
+
+route_table::route_id_t route_table::add(vsomeip::service_t service, vsomeip::instance_t instance,
+                                         vsomeip::method_t first, vsomeip::method_t last, callback_t callback)
+{
+    if (first > last) {
+        return 0;
+    }
+    range r{make_key(service, instance, first), make_key(service, instance, last)};
+
+    std::unique_lock<std::shared_mutex> lock{_mutex};
+    auto it = std::lower_bound(_ranges.begin(), _ranges.end(), r.first,
+                               [](range const& x, uint64_t k) { return x.first < k; });
+    if ((it != _ranges.end() && it->first <= r.last) || (it != _ranges.begin() && std::prev(it)->last >= r.first)) {
+        return 0;
+    }
+    auto id = ++_last_id;
+    auto pos = it - _ranges.begin();
+    _ranges.insert(it, r);
+    _entries.insert(_entries.begin() + pos, entry{id, std::make_shared<callback_t>(std::move(callback))});
+    _count.store(_ranges.size(), std::memory_order_relaxed);
+    return id;
+}
+
+bool route_table::remove(route_id_t id) {
+    std::shared_ptr<callback_t> callback;
+    {
+        std::unique_lock<std::shared_mutex> lock{_mutex};
+        auto it = std::find_if(_entries.begin(), _entries.end(), [id](entry const& e) { return e.id == id; });
+        if (it == _entries.end()) {
+            return false;
+        }
+        // the callback's captures are released outside the lock
+        callback = std::move(it->callback);
+        _ranges.erase(_ranges.begin() + (it - _entries.begin()));
+        _entries.erase(it);
+        _count.store(_ranges.size(), std::memory_order_relaxed);
+    }
+    return true;
+}
+
+bool route_table::dispatch(std::shared_ptr<vsomeip::message> const& msg) {
+    if (_count.load(std::memory_order_relaxed) == 0) {
+        return false;
+    }
+    std::shared_ptr<callback_t> callback;
+    {
+        std::shared_lock<std::shared_mutex> lock{_mutex};
+        auto idx = find(make_key(msg->get_service(), msg->get_instance(), msg->get_method()));
+        if (idx < 0) {
+            idx = find(make_key(msg->get_service(), vsomeip::ANY_INSTANCE, msg->get_method()));
+            if (idx < 0) {
+                return false;
+            }
+        }
+        callback = _entries[idx].callback;
+    }
+    (*callback)(msg);
+    return true;
+}
@@ -0,0 +1,75 @@
+// SPDX-License-Identifier: MPL-2.0
+//
+// Copyright (C) 2024 Alexander Seifarth
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef ROUTE_TABLE_H_
+#define ROUTE_TABLE_H_
+
+#include <vsomeip/vsomeip.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <shared_mutex>
+#include <vector>
+
+/// Dispatch table delivering received messages of a (service, instance, method range) to the
+/// route's own callback instead of the application's message callback.
+///
+/// Routes are kept as a sorted array of non-overlapping ranges on the 48 bit key
+/// `service << 32 | instance << 16 | method`, so a lookup is a binary search over a flat array.
+/// A route with instance vsomeip::ANY_INSTANCE matches all instances of the service that have no
+/// route of their own.
+/// Callbacks are invoked without the table locked, a callback blocked in a full receive queue does
+/// not block adding or removing routes.
+class route_table {
+public:
+    using callback_t = std::function<void(std::shared_ptr<vsomeip::message> const&)>;
+    using route_id_t = uint32_t;
+
+    route_table();
+    route_table(route_table const&) = delete;
+
+    /// Adds a route for methods `first` to `last` (inclusive) of the service instance.
+    /// Returns the route's id or 0 if the range overlaps an existing route.
+    route_id_t add(vsomeip::service_t service, vsomeip::instance_t instance,
+                   vsomeip::method_t first, vsomeip::method_t last, callback_t callback);
+
+    /// Removes the route. No invocation of the route's callback starts after this method returned,
+    /// one still running completes on its thread. The callback is destroyed after its last invocation.
+    bool remove(route_id_t id);
+
+    /// Passes `msg` to the matching route. Returns false if no route matches.
+    bool dispatch(std::shared_ptr<vsomeip::message> const& msg);
+
+private:
+    struct range {
+        uint64_t first;
+        uint64_t last;
+    };
+
+    struct entry {
+        route_id_t id;
+        // shared by the running invocations, which hold a copy while the table is unlocked
+        std::shared_ptr<callback_t> callback;
+    };
+
+    static uint64_t make_key(vsomeip::service_t service, vsomeip::instance_t instance, vsomeip::method_t method);
+
+    /// Returns the index of the range containing `key` or -1.
+    [[nodiscard]]
+    std::ptrdiff_t find(uint64_t key) const;
+
+    std::shared_mutex _mutex;
+    // kept apart from the entries so that the binary search touches only the keys
+    std::vector<range> _ranges;
+    std::vector<entry> _entries;
+    std::atomic<std::size_t> _count;
+    route_id_t _last_id;
+};
+
+#endif // ROUTE_TABLE_H_
@@ -0,0 +1,200 @@
+// SPDX-License-Identifier: MPL-2.0
+//
+// Copyright (C) 2024 Alexander Seifarth
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include "shm_pool.h"
+#include "buffer_payload.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "the shm pool requires lock free atomics in shared memory");
+
+namespace {
+    constexpr std::size_t line = 64;
+
+    constexpr std::size_t round_up(std::size_t n) {
+        return (n + line - 1) / line * line;
+    }
+
+    constexpr uint64_t make_state(uint32_t sequence, uint32_t pins) {
+        return static_cast<uint64_t>(sequence) << 32 | pins;
+    }
+
+    constexpr uint32_t sequence_of(uint64_t state) {
+        return static_cast<uint32_t>(state >> 32);
+    }
+
+    constexpr uint32_t pins_of(uint64_t state) {
+        return static_cast<uint32_t>(state);
+    }
+
+    /// Returns the shm object name of pool `name`, empty if `name` cannot be used.
+    std::string object_name(std::string const& name) {
+        if (name.empty() || name.find('/') != std::string::npos) {
+            std::cerr << "Invalid shm pool name [" << name << "]\n";
+            return {};
+        }
+        return "/vsomeiprs-" + name;
+    }
+
+    struct pin {
+        std::shared_ptr<shm_pool> pool;
+        std::atomic<uint64_t>* state;
+    };
+}
+
+std::shared_ptr<shm_pool> shm_pool::create(std::string const& name, uint32_t segments, uint32_t segment_size) {
+    auto object = object_name(name);
+    if (object.empty() || segments == 0 || segments > INT32_MAX || segment_size == 0) {
+        return nullptr;
+    }
+    std::size_t size = size_of(segments, segment_size);
+    ::shm_unlink(object.c_str());
+    int fd = ::shm_open(object.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) {
+        std::cerr << "Cannot create shm pool " << object << ": " << std::strerror(errno) << "\n";
+        return nullptr;
+    }
+    if (::ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        std::cerr << "Cannot resize shm pool " << object << ": " << std::strerror(errno) << "\n";
+        ::close(fd);
+        ::shm_unlink(object.c_str());
+        return nullptr;
+    }
+    void* base = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED) {
+        std::cerr << "Cannot map shm pool " << object << ": " << std::strerror(errno) << "\n";
+        ::shm_unlink(object.c_str());
+        return nullptr;
+    }
+    // the segment states are zero (sequence 0, no pins) after ftruncate
+    *static_cast<header*>(base) = header{magic, version, segments, segment_size};
+    return std::shared_ptr<shm_pool>{new shm_pool(object, true, base, size)};
+}
+
+std::shared_ptr<shm_pool> shm_pool::attach(std::string const& name) {
+    auto object = object_name(name);
+    if (object.empty()) {
+        return nullptr;
+    }
+    int fd = ::shm_open(object.c_str(), O_RDWR, 0);
+    if (fd < 0) {
+        std::cerr << "Cannot open shm pool " << object << ": " << std::strerror(errno) << "\n";
+        return nullptr;
+    }
+    struct stat st{};
+    if (::fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < sizeof(header)) {
+        ::close(fd);
+        return nullptr;
+    }
+    auto size = static_cast<std::size_t>(st.st_size);
+    void* base = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED) {
+        std::cerr << "Cannot map shm pool " << object << ": " << std::strerror(errno) << "\n";
+        return nullptr;
+    }
+    auto hdr = static_cast<header const*>(base);
+    if (hdr->magic != magic || hdr->version != version || hdr->segments == 0
+            || size_of(hdr->segments, hdr->segment_size) != size) {
+        std::cerr << "Shm pool " << object << " has an unknown layout\n";
+        ::munmap(base, size);
+        return nullptr;
+    }
+    return std::shared_ptr<shm_pool>{new shm_pool(object, false, base, size)};
+}
+
+shm_pool::shm_pool(std::string name, bool owner, void* base, std::size_t size)
+        : _name{std::move(name)}
+        , _owner{owner}
+        , _base{base}
+        , _size{size}
+        , _header{static_cast<header const*>(base)}
+        , _next{0}
+{
+}
+
+shm_pool::~shm_pool() {
+    ::munmap(_base, _size);
+    if (_owner) {
+        // attached consumers keep their mapping, new ones cannot attach anymore
+        ::shm_unlink(_name.c_str());
+    }
+}
+
+std::size_t shm_pool::size_of(uint32_t segments, uint32_t segment_size) {
+    return line + segments * line + segments * round_up(segment_size);
+}
+
+std::atomic<uint64_t>& shm_pool::state_of(uint32_t segment) const {
+    return *reinterpret_cast<std::atomic<uint64_t>*>(static_cast<uint8_t*>(_base) + line + segment * line);
+}
+
+uint8_t* shm_pool::data_of(uint32_t segment) const {
+    return static_cast<uint8_t*>(_base) + line + _header->segments * line + segment * round_up(_header->segment_size);
+}
+
+int32_t shm_pool::acquire(uint8_t*& data, uint32_t& capacity) {
+    uint32_t segments = _header->segments;
+    uint32_t start = _next.load(std::memory_order_relaxed);
+    for (uint32_t n = 0; n < segments; ++n) {
+        uint32_t segment = (start + n) % segments;
+        auto& state = state_of(segment);
+        uint64_t s = state.load(std::memory_order_relaxed);
+        if (pins_of(s) == 0
+                && state.compare_exchange_strong(s, make_state(sequence_of(s) + 1, 1), std::memory_order_acquire)) {
+            _next.store(segment + 1, std::memory_order_relaxed);
+            data = data_of(segment);
+            capacity = _header->segment_size;
+            return static_cast<int32_t>(segment);
+        }
+    }
+    return -1;
+}
+
+shm_pool::descriptor shm_pool::describe(int32_t segment, uint32_t length) const {
+    auto index = static_cast<uint32_t>(segment);
+    return descriptor{descriptor_magic, index, sequence_of(state_of(index).load(std::memory_order_relaxed)),
+                      std::min(length, _header->segment_size)};
+}
+
+void shm_pool::release(int32_t segment) {
+    state_of(static_cast<uint32_t>(segment)).fetch_sub(1, std::memory_order_release);
+}
+
+std::shared_ptr<vsomeip::payload> shm_pool::resolve(uint8_t const* data, uint32_t length) {
+    descriptor d{};
+    if (length != sizeof(d)) {
+        return nullptr;
+    }
+    std::memcpy(&d, data, sizeof(d));
+    if (d.magic != descriptor_magic || d.segment >= _header->segments || d.length > _header->segment_size) {
+        return nullptr;
+    }
+    auto& state = state_of(d.segment);
+    uint64_t s = state.load(std::memory_order_relaxed);
+    do {
+        if (sequence_of(s) != d.sequence || pins_of(s) == UINT32_MAX) {
+            return nullptr;
+        }
+    } while (!state.compare_exchange_weak(s, s + 1, std::memory_order_acquire));
+    auto p = new pin{shared_from_this(), &state};
+    return std::make_shared<buffer_payload>(data_of(d.segment), d.length, &shm_pool::unpin, p);
+}
+
+void shm_pool::unpin(void* context) {
+    auto p = static_cast<pin*>(context);
+    p->state->fetch_sub(1, std::memory_order_release);
+    delete p;
+}
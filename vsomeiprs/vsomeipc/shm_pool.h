@@ -0,0 +1,100 @@
+// SPDX-License-Identifier: MPL-2.0
+//
+// Copyright (C) 2024 Alexander Seifarth
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef SHM_POOL_H_
+#define SHM_POOL_H_
+
+#include <vsomeip/vsomeip.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+/// Pool of fixed size segments in POSIX shared memory for passing large payloads between
+/// applications on the same host.
+///
+/// The provider writes a payload into a segment and notifies a small descriptor (segment index,
+/// sequence and length) instead of the payload. A consumer attached to the pool replaces the
+/// received descriptor by a payload referring to the segment, which stays pinned until the payload
+/// is dropped. Each segment has one 64 bit state word: the sequence of the payload it holds and the
+/// number of pins. The provider takes free segments round robin and drops its own pin after
+/// notifying, so a consumer must pin a payload before the provider has published `segments - 1`
+/// further payloads; later descriptors no longer match the segment and are reported as lost.
+/// Segments pinned by a crashed consumer are not reclaimed.
+class shm_pool : public std::enable_shared_from_this<shm_pool> {
+public:
+    /// Descriptor sent as payload of the notification.
+    struct descriptor {
+        uint32_t magic;
+        uint32_t segment;
+        uint32_t sequence;
+        uint32_t length;
+    };
+
+    shm_pool(shm_pool const&) = delete;
+    ~shm_pool();
+
+    /// Creates the pool `name` as provider. An existing pool of the same name is replaced.
+    /// Returns nullptr on failure.
+    [[nodiscard]]
+    static std::shared_ptr<shm_pool> create(std::string const& name, uint32_t segments, uint32_t segment_size);
+
+    /// Maps the existing pool `name` as consumer. Returns nullptr if there is no such pool.
+    [[nodiscard]]
+    static std::shared_ptr<shm_pool> attach(std::string const& name);
+
+    /// Takes a free segment for writing (provider only), returns its index or -1 if all are pinned.
+    int32_t acquire(uint8_t*& data, uint32_t& capacity);
+
+    /// Returns the descriptor of the payload of `length` bytes written to an acquired segment.
+    [[nodiscard]]
+    descriptor describe(int32_t segment, uint32_t length) const;
+
+    /// Drops the provider's pin of an acquired segment, after it has been notified or instead.
+    void release(int32_t segment);
+
+    /// Returns a payload referring to the segment of a received descriptor, nullptr if `data` is
+    /// not a descriptor of this pool or the segment has been reused already.
+    [[nodiscard]]
+    std::shared_ptr<vsomeip::payload> resolve(uint8_t const* data, uint32_t length);
+
+private:
+    struct header {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t segments;
+        uint32_t segment_size;
+    };
+
+    static constexpr uint32_t magic = 0x4d485356;             // "VSHM"
+    static constexpr uint32_t descriptor_magic = 0x44485356;  // "VSHD"
+    static constexpr uint32_t version = 1;
+
+    shm_pool(std::string name, bool owner, void* base, std::size_t size);
+
+    [[nodiscard]]
+    static std::size_t size_of(uint32_t segments, uint32_t segment_size);
+
+    [[nodiscard]]
+    std::atomic<uint64_t>& state_of(uint32_t segment) const;
+
+    [[nodiscard]]
+    uint8_t* data_of(uint32_t segment) const;
+
+    /// buffer_payload release function, `context` is a heap allocated pin.
+    static void unpin(void* context);
+
+    std::string _name;
+    bool _owner;
+    void* _base;
+    std::size_t _size;
+    header const* _header;
+    std::atomic<uint32_t> _next;
+};
+
+#endif // SHM_POOL_H_
@@ -0,0 +1,158 @@
+// SPDX-License-Identifier: MPL-2.0
+//
+// Copyright (C) 2024 Alexander Seifarth
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include "standby_table.h"
+
+bool standby_table::add(vsomeip::service_t service, vsomeip::instance_t instance, vsomeip::major_version_t major,
+                        vsomeip::minor_version_t minor, clock::time_point deadline, role_callback_t callback)
+{
+    std::lock_guard<std::mutex> lock{_mutex};
+    return _entries.emplace(make_key(service, instance),
+                            entry{major, minor, false, {}, std::move(callback), ++_added, false, 0, 0, false,
+                                  false, deadline}).second;
+}
+
+bool standby_table::remove(vsomeip::service_t service, vsomeip::instance_t instance,
+                           vsomeip::major_version_t& major, vsomeip::minor_version_t& minor, bool& active)
+{
+    std::lock_guard<std::mutex> lock{_mutex};
+    auto it = _entries.find(make_key(service, instance));
+    if (it == _entries.end()) {
+        return false;
+    }
+    major = it->second.major;
+    minor = it->second.minor;
+    active = it->second.active;
+    _entries.erase(it);
+    return true;
+}
+
+std::optional<standby_table::takeover> standby_table::activate(vsomeip::service_t service, vsomeip::instance_t instance)
+{
+    std::lock_guard<std::mutex> lock{_mutex};
+    auto it = _entries.find(make_key(service, instance));
+    if (it == _entries.end() || it->second.active) {
+        return std::nullopt;
+    }
+    auto& e = it->second;
+    e.active = true;
+    takeover result{e.major, e.minor, {}};
+    result.fields.reserve(e.fields.size());
+    for (auto const& [event, data] : e.fields) {
+        result.fields.push_back(field{event, data});
+    }
+    return result;
+}
+
+bool standby_table::availability(vsomeip::service_t service, vsomeip::instance_t instance, bool available)
+{
+    std::lock_guard<std::mutex> lock{_mutex};
+    auto it = _entries.find(make_key(service, instance));
+    if (it == _entries.end()) {
+        return false;
+    }
+    auto& e = it->second;
+    // vsomeip reports an instance nobody offers as unavailable right away, that is no loss
+    bool lost = e.available && !available;
+    e.available = available;
+    if (available) {
+        e.deadline.reset();
+    }
+    return lost && !e.active;
+}
+
+std::vector<std::pair<vsomeip::service_t, vsomeip::instance_t>>
+standby_table::expired(clock::time_point now, std::optional<clock::time_point>& next)
+{
+    std::lock_guard<std::mutex> lock{_mutex};
+    std::vector<std::pair<vsomeip::service_t, vsomeip::instance_t>> result;
+    next.reset();
+    for (auto& [key, e] : _entries) {
+        if (!e.deadline) {
+            continue;
+        }
+        if (*e.deadline <= now) {
+            e.deadline.reset();
+            if (!e.active && !e.available) {
+                result.emplace_back(static_cast<vsomeip::service_t>(key >> 16),
+                                    static_cast<vsomeip::instance_t>(key & 0xffff));
+            }
+        } else if (!next || *e.deadline < *next) {
+            next = e.deadline;
+        }
+    }
+    return result;
+}
+
+bool standby_table::prepare(vsomeip::service_t service, vsomeip::instance_t instance, vsomeip::event_t event,
+                            uint8_t const* data, uint32_t data_len)
+{
+    std::lock_guard<std::mutex> lock{_mutex};
+    auto it = _entries.find(make_key(service, instance));
+    if (it == _entries.end()) {
+        return true;
+    }
+    if (it->second.active) {
+        return true;
+    }
+    it->second.fields[event].assign(data, data + data_len);
+    return false;
+}
+
+void standby_table::report_standby(vsomeip::service_t service, vsomeip::instance_t instance)
+{
+    std::unique_lock<std::mutex> lock{_mutex};
+    auto it = _entries.find(make_key(service, instance));
+    if (it == _entries.end() || it->second.active) {
+        return;
+    }
+    it->second.role = false;
+    ++it->second.sequence;
+    deliver(lock, service, instance);
+}
+
+void standby_table::report_active(vsomeip::service_t service, vsomeip::instance_t instance)
+{
+    std::unique_lock<std::mutex> lock{_mutex};
+    auto it = _entries.find(make_key(service, instance));
+    if (it == _entries.end() || !it->second.active) {
+        return;
+    }
+    it->second.role = true;
+    ++it->second.sequence;
+    deliver(lock, service, instance);
+}
+
+void standby_table::deliver(std::unique_lock<std::mutex>& lock, vsomeip::service_t service,
+                            vsomeip::instance_t instance)
+{
+    auto key = make_key(service, instance);
+    auto it = _entries.find(key);
+    auto id = it->second.id;
+    if (it->second.reporting) {
+        // the reporting thread passes on the new role after the current one
+        return;
+    }
+    it->second.reporting = true;
+    while (it->second.reported != it->second.sequence) {
+        auto sequence = it->second.sequence;
+        bool role = it->second.role;
+        auto callback = it->second.on_role;
+        lock.unlock();
+        if (callback) {
+            callback(service, instance, role);
+        }
+        lock.lock();
+        it = _entries.find(key);
+        if (it == _entries.end() || it->second.id != id) {
+            // removed while reporting
+            return;
+        }
+        it->second.reported = sequence;
+    }
+    it->second.reporting = false;
+}
@@ -0,0 +1,115 @@
+// SPDX-License-Identifier: MPL-2.0
+//
+// Copyright (C) 2024 Alexander Seifarth
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef STANDBY_TABLE_H_
+#define STANDBY_TABLE_H_
+
+#include <vsomeip/vsomeip.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+/// Service instances offered in hot-standby: the instance is only offered once no other provider
+/// offers it. Until then the latest values of its fields are prepared here, so that they can be
+/// published right after the takeover.
+///
+/// An instance is taken over when the other provider's offer is lost, or when no other provider
+/// has been seen until its initial wait has passed. Remote offers only become known with their
+/// service discovery offer, so the wait should be longer than the cyclic offer delay.
+///
+/// Role callbacks are invoked without the table locked. Each role report gets a sequence number,
+/// and only one thread at a time invokes the callback of an instance. It goes on until it has
+/// reported the latest role, so the last role reported is always the current one.
+class standby_table {
+public:
+    using role_callback_t = std::function<void(vsomeip::service_t, vsomeip::instance_t, bool active)>;
+    using clock = std::chrono::steady_clock;
+
+    struct field {
+        vsomeip::event_t event;
+        std::vector<vsomeip::byte_t> data;
+    };
+
+    struct takeover {
+        vsomeip::major_version_t major;
+        vsomeip::minor_version_t minor;
+        std::vector<field> fields;
+    };
+
+    standby_table() = default;
+    standby_table(standby_table const&) = delete;
+
+    /// Adds the instance in standby role, it is taken over at `deadline` unless another provider
+    /// has been seen before. Returns false if it is already in the table.
+    bool add(vsomeip::service_t service, vsomeip::instance_t instance, vsomeip::major_version_t major,
+             vsomeip::minor_version_t minor, clock::time_point deadline, role_callback_t callback);
+
+    /// Removes the instance. Returns false if it is not in the table.
+    bool remove(vsomeip::service_t service, vsomeip::instance_t instance, vsomeip::major_version_t& major,
+                vsomeip::minor_version_t& minor, bool& active);
+
+    /// Switches a standby instance to the active role, reported by report_active() once published.
+    /// Returns the data for publishing it or nothing if the instance is unknown or already active.
+    [[nodiscard]]
+    std::optional<takeover> activate(vsomeip::service_t service, vsomeip::instance_t instance);
+
+    /// Records the availability of the instance from other providers. Returns true if it must be
+    /// taken over now, that is it turned unavailable after having been available.
+    bool availability(vsomeip::service_t service, vsomeip::instance_t instance, bool available);
+
+    /// Returns the standby instances whose initial wait has passed without another provider by
+    /// `now`, they are returned once. `next` is set to the earliest deadline still ahead, if any.
+    std::vector<std::pair<vsomeip::service_t, vsomeip::instance_t>>
+    expired(clock::time_point now, std::optional<clock::time_point>& next);
+
+    /// Stores the latest value of a field of a standby instance.
+    /// Returns true if the value must be notified: the instance is active or not in the table.
+    bool prepare(vsomeip::service_t service, vsomeip::instance_t instance, vsomeip::event_t event,
+                 uint8_t const* data, uint32_t data_len);
+
+    /// Invokes the role callback of the instance if it is (still) in standby role.
+    void report_standby(vsomeip::service_t service, vsomeip::instance_t instance);
+
+    /// Invokes the role callback of an activated instance.
+    void report_active(vsomeip::service_t service, vsomeip::instance_t instance);
+
+private:
+    struct entry {
+        vsomeip::major_version_t major;
+        vsomeip::minor_version_t minor;
+        bool active;
+        std::map<vsomeip::event_t, std::vector<vsomeip::byte_t>> fields;
+        role_callback_t on_role;
+        uint64_t id;            // tells an entry from one re-added while its role was reported
+        bool role;              // role of the latest report
+        uint64_t sequence;      // sequence of the latest report
+        uint64_t reported;      // sequence of the latest role passed to on_role
+        bool reporting;         // a thread is invoking on_role
+        bool available;         // another provider offers the instance
+        std::optional<clock::time_point> deadline;  // end of the initial wait, none once it is over
+    };
+
+    /// Invokes the role callback until the latest report of the instance is passed on, unless
+    /// another thread is doing so. Must be called with `lock` held, returns with it held.
+    void deliver(std::unique_lock<std::mutex>& lock, vsomeip::service_t service, vsomeip::instance_t instance);
+
+    static uint32_t make_key(vsomeip::service_t service, vsomeip::instance_t instance) {
+        return static_cast<uint32_t>(service) << 16 | instance;
+    }
+
+    std::mutex _mutex;
+    std::map<uint32_t, entry> _entries;
+    uint64_t _added = 0;
+};
+
+#endif // STANDBY_TABLE_H_
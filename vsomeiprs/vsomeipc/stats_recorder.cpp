@@ -0,0 +1,109 @@
+// SPDX-License-Identifier: MPL-2.0
+//
+// Copyright (C) 2024 Alexander Seifarth
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include "stats_recorder.h"
+
+namespace {
+    constexpr unsigned sub_bucket_bits = 2;
+    constexpr uint64_t sub_buckets = 1u << sub_bucket_bits;
+
+    static_assert((64 - sub_bucket_bits + 1) * sub_buckets <= VSOMEIPC_HISTOGRAM_BUCKETS,
+                  "histogram buckets do not cover 64 bit values");
+}
+
+histogram::histogram()
+        : _buckets{}
+        , _count{0}
+        , _sum_ns{0}
+        , _max_ns{0}
+{}
+
+std::size_t histogram::bucket_of(uint64_t value_ns) {
+    if (value_ns < sub_buckets) {
+        return value_ns;
+    }
+    unsigned msb = 63 - __builtin_clzll(value_ns);
+    unsigned shift = msb - sub_bucket_bits;
+    return (shift + 1) * sub_buckets + ((value_ns >> shift) & (sub_buckets - 1));
+}
+
+void histogram::record(uint64_t value_ns) {
+    _buckets[bucket_of(value_ns)].fetch_add(1, std::memory_order_relaxed);
+    _count.fetch_add(1, std::memory_order_relaxed);
+    _sum_ns.fetch_add(value_ns, std::memory_order_relaxed);
+    auto max = _max_ns.load(std::memory_order_relaxed);
+    while (value_ns > max && !_max_ns.compare_exchange_weak(max, value_ns, std::memory_order_relaxed)) {}
+}
+
+void histogram::snapshot(latency_histogram& out) const {
+    out.count = _count.load(std::memory_order_relaxed);
+    out.sum_ns = _sum_ns.load(std::memory_order_relaxed);
+    out.max_ns = _max_ns.load(std::memory_order_relaxed);
+    for (std::size_t i = 0; i < VSOMEIPC_HISTOGRAM_BUCKETS; ++i) {
+        out.buckets[i] = _buckets[i].load(std::memory_order_relaxed);
+    }
+}
+
+stats_recorder::stats_recorder()
+        : _msgs_in{}
+        , _msgs_out{}
+        , _bytes_in{0}
+        , _bytes_out{0}
+        , _notify_calls{0}
+        , _payload_allocations{0}
+        , _handler_time{}
+{}
+
+std::size_t stats_recorder::slot_of(vsomeip::message_type_e type) {
+    switch (type) {
+        case vsomeip::message_type_e::MT_REQUEST: return 0;
+        case vsomeip::message_type_e::MT_REQUEST_NO_RETURN: return 1;
+        case vsomeip::message_type_e::MT_NOTIFICATION: return 2;
+        case vsomeip::message_type_e::MT_RESPONSE: return 3;
+        case vsomeip::message_type_e::MT_ERROR: return 4;
+        default: return 5;
+    }
+}
+
+void stats_recorder::count_in(vsomeip::message const& msg) {
+    _msgs_in[slot_of(msg.get_message_type())].fetch_add(1, std::memory_order_relaxed);
+    if (auto const& payload = msg.get_payload()) {
+        _bytes_in.fetch_add(payload->get_length(), std::memory_order_relaxed);
+    }
+}
+
+void stats_recorder::count_out(vsomeip::message const& msg) {
+    _msgs_out[slot_of(msg.get_message_type())].fetch_add(1, std::memory_order_relaxed);
+    if (auto const& payload = msg.get_payload()) {
+        _bytes_out.fetch_add(payload->get_length(), std::memory_order_relaxed);
+    }
+}
+
+void stats_recorder::count_notify(std::size_t bytes) {
+    _notify_calls.fetch_add(1, std::memory_order_relaxed);
+    _bytes_out.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void stats_recorder::count_payload_allocation() {
+    _payload_allocations.fetch_add(1, std::memory_order_relaxed);
+}
+
+void stats_recorder::record_handler_time(clock::duration duration) {
+    _handler_time.record(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+}
+
+void stats_recorder::snapshot(application_stats& out) const {
+    for (std::size_t i = 0; i < VSOMEIPC_MESSAGE_TYPE_COUNT; ++i) {
+        out.msgs_in[i] = _msgs_in[i].load(std::memory_order_relaxed);
+        out.msgs_out[i] = _msgs_out[i].load(std::memory_order_relaxed);
+    }
+    out.bytes_in = _bytes_in.load(std::memory_order_relaxed);
+    out.bytes_out = _bytes_out.load(std::memory_order_relaxed);
+    out.notify_calls = _notify_calls.load(std::memory_order_relaxed);
+    out.payload_allocations = _payload_allocations.load(std::memory_order_relaxed);
+    _handler_time.snapshot(out.handler_time);
+}
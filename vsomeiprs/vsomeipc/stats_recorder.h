@@ -0,0 +1,72 @@
+// SPDX-License-Identifier: MPL-2.0
+//
+// Copyright (C) 2024 Alexander Seifarth
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef STATS_RECORDER_H_
+#define STATS_RECORDER_H_
+
+#include "vsomeipc.h"
+
+#include <vsomeip/vsomeip.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+/// Log-linear histogram of durations in nanoseconds.
+///
+/// Each power of two is split into 4 sub-buckets, so a recorded value is at most 25% above the lower
+/// bound of its bucket. Recording is a few relaxed atomic increments and takes no lock.
+class histogram {
+public:
+    histogram();
+    histogram(histogram const&) = delete;
+
+    void record(uint64_t value_ns);
+    void snapshot(latency_histogram& out) const;
+
+    /// Index of the bucket holding `value_ns`, see VSOMEIPC_HISTOGRAM_BUCKETS.
+    static std::size_t bucket_of(uint64_t value_ns);
+
+private:
+    std::atomic<uint64_t> _buckets[VSOMEIPC_HISTOGRAM_BUCKETS];
+    std::atomic<uint64_t> _count;
+    std::atomic<uint64_t> _sum_ns;
+    std::atomic<uint64_t> _max_ns;
+};
+
+/// Counters and histograms of the hot paths of an application.
+///
+/// All members are updated with relaxed atomics, a snapshot is therefore not a consistent cut but
+/// each value is exact on its own.
+class stats_recorder {
+public:
+    using clock = std::chrono::steady_clock;
+
+    stats_recorder();
+    stats_recorder(stats_recorder const&) = delete;
+
+    void count_in(vsomeip::message const& msg);
+    void count_out(vsomeip::message const& msg);
+    void count_notify(std::size_t bytes);
+    void count_payload_allocation();
+    void record_handler_time(clock::duration duration);
+
+    void snapshot(application_stats& out) const;
+
+private:
+    static std::size_t slot_of(vsomeip::message_type_e type);
+
+    std::atomic<uint64_t> _msgs_in[VSOMEIPC_MESSAGE_TYPE_COUNT];
+    std::atomic<uint64_t> _msgs_out[VSOMEIPC_MESSAGE_TYPE_COUNT];
+    std::atomic<uint64_t> _bytes_in;
+    std::atomic<uint64_t> _bytes_out;
+    std::atomic<uint64_t> _notify_calls;
+    std::atomic<uint64_t> _payload_allocations;
+    histogram _handler_time;
+};
+
+#endif // STATS_RECORDER_H_
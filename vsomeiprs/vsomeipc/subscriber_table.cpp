@@ -0,0 +1,69 @@
+// SPDX-License-Identifier: MPL-2.0
+//
+// Copyright (C) 2024 Alexander Seifarth
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include "subscriber_table.h"
+
+void subscriber_table::offer(vsomeip::service_t service, vsomeip::instance_t instance, vsomeip::event_t event,
+                             std::set<vsomeip::eventgroup_t> const& groups)
+{
+    std::lock_guard<std::mutex> lock{_mutex};
+    _events[make_key(service, instance, event)].assign(groups.begin(), groups.end());
+}
+
+void subscriber_table::withdraw(vsomeip::service_t service, vsomeip::instance_t instance, vsomeip::event_t event)
+{
+    std::lock_guard<std::mutex> lock{_mutex};
+    _events.erase(make_key(service, instance, event));
+}
+
+bool subscriber_table::watch(vsomeip::service_t service, vsomeip::instance_t instance, vsomeip::eventgroup_t group,
+                             subscription_callback_t callback)
+{
+    std::lock_guard<std::mutex> lock{_mutex};
+    auto [it, added] = _groups.try_emplace(make_key(service, instance, group));
+    it->second.on_subscription = std::move(callback);
+    return added;
+}
+
+void subscriber_table::update(vsomeip::service_t service, vsomeip::instance_t instance, vsomeip::eventgroup_t group,
+                              vsomeip::client_t client, bool subscribed)
+{
+    subscription_callback_t callback;
+    {
+        std::lock_guard<std::mutex> lock{_mutex};
+        auto& g = _groups[make_key(service, instance, group)];
+        // vsomeip reports renewed subscriptions again, only changes are passed on
+        bool changed = subscribed ? g.clients.insert(client).second : g.clients.erase(client) > 0;
+        if (!changed || !g.on_subscription) {
+            return;
+        }
+        callback = g.on_subscription;
+    }
+    callback(service, instance, group, client, subscribed);
+}
+
+uint32_t subscriber_table::subscribers(vsomeip::service_t service, vsomeip::instance_t instance,
+                                       vsomeip::event_t event) const
+{
+    std::lock_guard<std::mutex> lock{_mutex};
+    auto it = _events.find(make_key(service, instance, event));
+    if (it == _events.end()) {
+        return 0;
+    }
+    if (it->second.size() == 1) {
+        auto g = _groups.find(make_key(service, instance, it->second.front()));
+        return g == _groups.end() ? 0 : static_cast<uint32_t>(g->second.clients.size());
+    }
+    // a client subscribed to several eventgroups of the event is counted once
+    std::set<vsomeip::client_t> clients;
+    for (auto group : it->second) {
+        if (auto g = _groups.find(make_key(service, instance, group)); g != _groups.end()) {
+            clients.insert(g->second.clients.begin(), g->second.clients.end());
+        }
+    }
+    return static_cast<uint32_t>(clients.size());
+}
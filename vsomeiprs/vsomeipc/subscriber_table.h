@@ -0,0 +1,67 @@
+// SPDX-License-Identifier: MPL-2.0
+//
+// Copyright (C) 2024 Alexander Seifarth
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef SUBSCRIBER_TABLE_H_
+#define SUBSCRIBER_TABLE_H_
+
+#include <vsomeip/vsomeip.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <vector>
+
+/// Subscribers of the eventgroups of offered events as reported by the vsomeip subscription
+/// handler, so that a provider can tell whether anybody receives the notifications of an event.
+/// Only watched eventgroups have a subscription handler, the subscribers of others are unknown.
+class subscriber_table {
+public:
+    using subscription_callback_t = std::function<void(vsomeip::service_t, vsomeip::instance_t,
+                                                       vsomeip::eventgroup_t, vsomeip::client_t, bool subscribed)>;
+
+    subscriber_table() = default;
+    subscriber_table(subscriber_table const&) = delete;
+
+    /// Records the eventgroups of an offered event.
+    void offer(vsomeip::service_t service, vsomeip::instance_t instance, vsomeip::event_t event,
+               std::set<vsomeip::eventgroup_t> const& groups);
+
+    /// Forgets the eventgroups of an event no longer offered, its subscribers are kept.
+    void withdraw(vsomeip::service_t service, vsomeip::instance_t instance, vsomeip::event_t event);
+
+    /// Sets the callback reporting the subscribers of an eventgroup joining or leaving, an empty
+    /// callback removes it. Returns true if the eventgroup is watched for the first time and needs
+    /// a subscription handler.
+    bool watch(vsomeip::service_t service, vsomeip::instance_t instance, vsomeip::eventgroup_t group,
+               subscription_callback_t callback);
+
+    /// Adds or removes a subscriber of an eventgroup and invokes the callback of the eventgroup.
+    void update(vsomeip::service_t service, vsomeip::instance_t instance, vsomeip::eventgroup_t group,
+                vsomeip::client_t client, bool subscribed);
+
+    /// Returns the number of clients subscribed to any watched eventgroup of the event.
+    [[nodiscard]]
+    uint32_t subscribers(vsomeip::service_t service, vsomeip::instance_t instance, vsomeip::event_t event) const;
+
+private:
+    struct group {
+        std::set<vsomeip::client_t> clients;
+        subscription_callback_t on_subscription;
+    };
+
+    static uint64_t make_key(vsomeip::service_t service, vsomeip::instance_t instance, uint16_t id) {
+        return static_cast<uint64_t>(service) << 32 | static_cast<uint64_t>(instance) << 16 | id;
+    }
+
+    mutable std::mutex _mutex;
+    std::map<uint64_t, group> _groups;                                  // key service, instance, eventgroup
+    std::map<uint64_t, std::vector<vsomeip::eventgroup_t>> _events;     // key service, instance, event
+};
+
+#endif // SUBSCRIBER_TABLE_H_
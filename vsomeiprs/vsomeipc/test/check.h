@@ -0,0 +1,37 @@
+// SPDX-License-Identifier: MPL-2.0
+//
+// Copyright (C) 2024 Alexander Seifarth
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef CHECK_H_
+#define CHECK_H_
+
+#include <iostream>
+
+/// Minimal checks for the vsomeipc unit tests, which do not depend on a test framework.
+/// A failed check is reported and makes test_result() return a failure exit code; the checks
+/// stay active in release builds.
+inline int& check_failures() {
+    static int failures = 0;
+    return failures;
+}
+
+#define CHECK(cond)                                                                           \
+    do {                                                                                      \
+        if (!(cond)) {                                                                        \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #cond "\n";        \
+            ++check_failures();                                                               \
+        }                                                                                     \
+    } while (false)
+
+inline int test_result() {
+    if (check_failures() > 0) {
+        std::cerr << check_failures() << " check(s) failed\n";
+        return 1;
+    }
+    return 0;
+}
+
+#endif // CHECK_H_
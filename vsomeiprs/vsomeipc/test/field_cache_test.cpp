@@ -0,0 +1,155 @@
+// SPDX-License-Identifier: MPL-2.0
+//
+// Copyright (C) 2024 Alexander Seifarth
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include "../field_cache.h"
+#include "check.h"
+
+#include <atomic>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+
+std::string cache_path(char const* test) {
+    auto path = std::filesystem::temp_directory_path() / ("field_cache_test-" + std::to_string(::getpid()) + "-" + test);
+    std::filesystem::remove(path);
+    return path.string();
+}
+
+void round_trip_test() {
+    auto path = cache_path("round_trip");
+    std::vector<vsomeip::byte_t> value;
+    {
+        auto cache = field_cache::open(path, 4, 16);
+        CHECK(cache);
+        CHECK(!cache->track(0x1234, 1, 0x8001, value));
+        // untracked events are not stored
+        vsomeip::byte_t other[] = {9, 9};
+        cache->store(0x1234, 1, 0x8002, other, sizeof(other));
+        vsomeip::byte_t data[] = {1, 2, 3};
+        cache->store(0x1234, 1, 0x8001, data, sizeof(data));
+        CHECK(cache->track(0x1234, 1, 0x8001, value));
+        CHECK((value == std::vector<vsomeip::byte_t>{1, 2, 3}));
+    }
+    // the value survives the process, untracked events are still unknown
+    auto cache = field_cache::open(path, 4, 16);
+    CHECK(cache);
+    value.clear();
+    CHECK(cache->track(0x1234, 1, 0x8001, value));
+    CHECK((value == std::vector<vsomeip::byte_t>{1, 2, 3}));
+    CHECK(!cache->track(0x1234, 1, 0x8002, value));
+
+    cache->clear(0x1234, 1, 0x8001);
+    CHECK(!cache->track(0x1234, 1, 0x8001, value));
+    cache.reset();
+
+    // a different layout discards the cached values
+    vsomeip::byte_t data[] = {4};
+    cache = field_cache::open(path, 4, 16);
+    cache->store(0x1234, 1, 0x8001, data, sizeof(data));
+    cache = field_cache::open(path, 4, 32);
+    CHECK(cache);
+    CHECK(!cache->track(0x1234, 1, 0x8001, value));
+    std::filesystem::remove(path);
+}
+
+void overflow_test() {
+    auto path = cache_path("overflow");
+    auto cache = field_cache::open(path, 2, 4);
+    CHECK(cache);
+    std::vector<vsomeip::byte_t> value;
+    CHECK(!cache->track(0x1234, 1, 0x8001, value));
+    CHECK(!cache->track(0x1234, 1, 0x8002, value));
+    // all slots are taken, the third field is not cached
+    CHECK(!cache->track(0x1234, 1, 0x8003, value));
+    vsomeip::byte_t data[] = {1, 2, 3, 4};
+    cache->store(0x1234, 1, 0x8003, data, sizeof(data));
+    CHECK(!cache->track(0x1234, 1, 0x8003, value));
+
+    // a value larger than the slot invalidates the previous one
+    cache->store(0x1234, 1, 0x8001, data, sizeof(data));
+    CHECK(cache->track(0x1234, 1, 0x8001, value));
+    vsomeip::byte_t large[] = {1, 2, 3, 4, 5};
+    cache->store(0x1234, 1, 0x8001, large, sizeof(large));
+    CHECK(!cache->track(0x1234, 1, 0x8001, value));
+    CHECK(!field_cache::open(path, 0, 4));
+    std::filesystem::remove(path);
+}
+
+void reuse_test() {
+    auto path = cache_path("reuse");
+    std::vector<vsomeip::byte_t> value;
+    vsomeip::byte_t data[] = {1};
+    {
+        auto cache = field_cache::open(path, 2, 4);
+        CHECK(!cache->track(0x1234, 1, 0x8001, value));
+        CHECK(!cache->track(0x1234, 1, 0x8002, value));
+        cache->store(0x1234, 1, 0x8001, data, sizeof(data));
+        cache->store(0x1234, 1, 0x8002, data, sizeof(data));
+        // an event whose offer was stopped is not stored anymore, its value is kept
+        cache->untrack(0x1234, 1, 0x8002);
+        vsomeip::byte_t other[] = {2};
+        cache->store(0x1234, 1, 0x8002, other, sizeof(other));
+    }
+    auto cache = field_cache::open(path, 2, 4);
+    CHECK(cache->track(0x1234, 1, 0x8002, value));
+    CHECK((value == std::vector<vsomeip::byte_t>{1}));
+    // the slot of a field cached by the previous run but not tracked now is reused
+    CHECK(!cache->track(0x1234, 1, 0x8003, value));
+    cache->store(0x1234, 1, 0x8003, data, sizeof(data));
+    CHECK(cache->track(0x1234, 1, 0x8003, value));
+    CHECK(!cache->track(0x1234, 1, 0x8004, value));
+
+    // a forgotten field frees its slot and loses its value
+    cache->forget(0x1234, 1, 0x8002);
+    CHECK(!cache->track(0x1234, 1, 0x8004, value));
+    cache->store(0x1234, 1, 0x8004, data, sizeof(data));
+    CHECK(cache->track(0x1234, 1, 0x8004, value));
+    CHECK(cache->track(0x1234, 1, 0x8003, value));
+    std::filesystem::remove(path);
+}
+
+void concurrent_test() {
+    auto path = cache_path("concurrent");
+    auto cache = field_cache::open(path, 1, 256);
+    CHECK(cache);
+    std::vector<vsomeip::byte_t> value;
+    cache->track(0x1234, 1, 0x8001, value);
+    std::atomic<bool> done{false};
+    std::thread writer([&] {
+        std::vector<vsomeip::byte_t> data(256);
+        for (unsigned n = 0; n < 20000; ++n) {
+            std::fill(data.begin(), data.end(), static_cast<vsomeip::byte_t>(n));
+            cache->store(0x1234, 1, 0x8001, data.data(), 1 + n % 256);
+        }
+        done = true;
+    });
+    // a reader never sees a value mixed from two writes
+    bool torn = false;
+    while (!done) {
+        if (cache->track(0x1234, 1, 0x8001, value)) {
+            for (auto b : value) {
+                torn |= b != value[0];
+            }
+        }
+    }
+    writer.join();
+    CHECK(!torn);
+    std::filesystem::remove(path);
+}
+
+}
+
+int main() {
+    round_trip_test();
+    overflow_test();
+    reuse_test();
+    concurrent_test();
+    return test_result();
+}
@@ -0,0 +1,112 @@
+// SPDX-License-Identifier: MPL-2.0
+//
+// Copyright (C) 2024 Alexander Seifarth
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include "../shm_pool.h"
+#include "check.h"
+
+#include <cstring>
+#include <string>
+#include <unistd.h>
+
+namespace {
+
+std::string pool_name(char const* test) {
+    return "test-" + std::to_string(::getpid()) + "-" + test;
+}
+
+std::shared_ptr<vsomeip::payload> resolve(shm_pool& consumer, shm_pool::descriptor const& d) {
+    return consumer.resolve(reinterpret_cast<uint8_t const*>(&d), sizeof(d));
+}
+
+void publish_test() {
+    auto provider = shm_pool::create(pool_name("publish"), 2, 64);
+    CHECK(provider);
+    auto consumer = shm_pool::attach(pool_name("publish"));
+    CHECK(consumer);
+
+    uint8_t* data = nullptr;
+    uint32_t capacity = 0;
+    int32_t segment = provider->acquire(data, capacity);
+    CHECK(segment == 0);
+    CHECK(capacity == 64);
+    std::memcpy(data, "hello", 5);
+    auto d = provider->describe(segment, 5);
+    provider->release(segment);
+
+    auto payload = resolve(*consumer, d);
+    CHECK(payload);
+    CHECK(payload->get_length() == 5);
+    CHECK(std::memcmp(payload->get_data(), "hello", 5) == 0);
+    // a descriptor is resolved as often as it is received, each pins the segment
+    auto again = resolve(*consumer, d);
+    CHECK(again);
+    again.reset();
+
+    // the pinned segment is skipped, segment 1 is reused while segment 0 stays pinned
+    CHECK(provider->acquire(data, capacity) == 1);
+    provider->release(1);
+    CHECK(provider->acquire(data, capacity) == 1);
+    uint8_t* other = nullptr;
+    CHECK(provider->acquire(other, capacity) == -1);
+    provider->release(1);
+
+    // unpinned segments are taken again with a new sequence, old descriptors are then stale
+    payload.reset();
+    CHECK(provider->acquire(data, capacity) == 0);
+    auto reused = provider->describe(0, 3);
+    CHECK(reused.sequence != d.sequence);
+    CHECK(!resolve(*consumer, d));
+    provider->release(0);
+    CHECK(resolve(*consumer, reused));
+}
+
+void descriptor_test() {
+    auto provider = shm_pool::create(pool_name("descriptor"), 1, 16);
+    CHECK(provider);
+    auto consumer = shm_pool::attach(pool_name("descriptor"));
+    CHECK(consumer);
+    uint8_t* data = nullptr;
+    uint32_t capacity = 0;
+    CHECK(provider->acquire(data, capacity) == 0);
+    // lengths are limited to the segment
+    auto d = provider->describe(0, 100);
+    CHECK(d.length == 16);
+    provider->release(0);
+
+    CHECK(!consumer->resolve(reinterpret_cast<uint8_t const*>(&d), sizeof(d) - 1));
+    auto bad = d;
+    bad.magic = 0;
+    CHECK(!resolve(*consumer, bad));
+    bad = d;
+    bad.segment = 1;
+    CHECK(!resolve(*consumer, bad));
+    bad = d;
+    bad.length = 17;
+    CHECK(!resolve(*consumer, bad));
+    CHECK(resolve(*consumer, d));
+}
+
+void name_test() {
+    CHECK(!shm_pool::create("", 1, 16));
+    CHECK(!shm_pool::create("a/b", 1, 16));
+    CHECK(!shm_pool::create(pool_name("name"), 0, 16));
+    CHECK(!shm_pool::attach(pool_name("missing")));
+    // the provider removes the pool name, new consumers cannot attach anymore
+    auto provider = shm_pool::create(pool_name("name"), 1, 16);
+    CHECK(provider);
+    provider.reset();
+    CHECK(!shm_pool::attach(pool_name("name")));
+}
+
+}
+
+int main() {
+    publish_test();
+    descriptor_test();
+    name_test();
+    return test_result();
+}
@@ -0,0 +1,138 @@
+// SPDX-License-Identifier: MPL-2.0
+//
+// Copyright (C) 2024 Alexander Seifarth
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include "../standby_table.h"
+#include "check.h"
+
+#include <thread>
+#include <vector>
+
+namespace {
+
+auto const later = standby_table::clock::now() + std::chrono::hours(1);
+
+void takeover_test() {
+    standby_table table;
+    std::vector<bool> roles;
+    CHECK(table.add(0x1234, 1, 1, 0, later, [&roles](vsomeip::service_t, vsomeip::instance_t, bool active) {
+        roles.push_back(active);
+    }));
+    CHECK(!table.add(0x1234, 1, 1, 0, later, {}));
+
+    uint8_t first[] = {1};
+    uint8_t latest[] = {2, 3};
+    CHECK(!table.prepare(0x1234, 1, 0x8001, first, sizeof(first)));
+    CHECK(!table.prepare(0x1234, 1, 0x8001, latest, sizeof(latest)));
+    // fields of other instances are notified right away
+    CHECK(table.prepare(0x1234, 2, 0x8001, latest, sizeof(latest)));
+    table.report_standby(0x1234, 1);
+    CHECK((roles == std::vector<bool>{false}));
+
+    auto takeover = table.activate(0x1234, 1);
+    CHECK(takeover);
+    CHECK(takeover->major == 1);
+    CHECK(takeover->fields.size() == 1);
+    CHECK(takeover->fields[0].event == 0x8001);
+    CHECK((takeover->fields[0].data == std::vector<vsomeip::byte_t>{2, 3}));
+    CHECK(!table.activate(0x1234, 1));
+    // the activation is reported once the instance is published, standby reports are ignored then
+    CHECK((roles == std::vector<bool>{false}));
+    table.report_standby(0x1234, 1);
+    table.report_active(0x1234, 1);
+    CHECK((roles == std::vector<bool>{false, true}));
+    CHECK(table.prepare(0x1234, 1, 0x8001, first, sizeof(first)));
+
+    vsomeip::major_version_t major = 0;
+    vsomeip::minor_version_t minor = 1;
+    bool active = false;
+    CHECK(table.remove(0x1234, 1, major, minor, active));
+    CHECK(major == 1 && minor == 0 && active);
+    CHECK(!table.remove(0x1234, 1, major, minor, active));
+}
+
+void unlocked_callback_test() {
+    standby_table table;
+    std::vector<bool> roles;
+    bool prepared = false;
+    // the callback may use the table, e.g. another thread taking the instance over meanwhile
+    CHECK(table.add(0x1234, 1, 1, 0, later, [&](vsomeip::service_t service, vsomeip::instance_t instance, bool active) {
+        roles.push_back(active);
+        if (!active) {
+            uint8_t data[] = {1};
+            prepared = !table.prepare(service, instance, 0x8001, data, sizeof(data));
+            std::thread takeover([&table, service, instance] {
+                CHECK(table.activate(service, instance));
+                table.report_active(service, instance);
+            });
+            takeover.join();
+        }
+    }));
+    table.report_standby(0x1234, 1);
+    CHECK(prepared);
+    // the activation reported meanwhile is passed on after the standby report
+    CHECK((roles == std::vector<bool>{false, true}));
+}
+
+void remove_while_reporting_test() {
+    standby_table table;
+    int reports = 0;
+    CHECK(table.add(0x1234, 1, 1, 0, later, [&](vsomeip::service_t service, vsomeip::instance_t instance, bool) {
+        ++reports;
+        vsomeip::major_version_t major;
+        vsomeip::minor_version_t minor;
+        bool active;
+        CHECK(table.remove(service, instance, major, minor, active));
+        // an instance added again while its removed predecessor is reported has roles of its own
+        CHECK(table.add(service, instance, 1, 0, later, {}));
+        table.report_standby(service, instance);
+    }));
+    table.report_standby(0x1234, 1);
+    CHECK(reports == 1);
+    CHECK(table.activate(0x1234, 1));
+}
+
+void initial_wait_test() {
+    standby_table table;
+    auto now = standby_table::clock::now();
+    std::optional<standby_table::clock::time_point> next;
+    CHECK(table.add(0x1234, 1, 1, 0, now + std::chrono::seconds(1), {}));
+    CHECK(table.add(0x1234, 2, 1, 0, now + std::chrono::seconds(2), {}));
+    CHECK(table.add(0x1234, 3, 1, 0, now + std::chrono::seconds(3), {}));
+    CHECK(table.expired(now, next).empty());
+    CHECK(next == now + std::chrono::seconds(1));
+
+    // vsomeip reports instances nobody offers as unavailable at first, that is no takeover
+    CHECK(!table.availability(0x1234, 1, false));
+    // another provider seen during the initial wait keeps the instance in standby
+    CHECK(!table.availability(0x1234, 2, true));
+    auto expired = table.expired(now + std::chrono::seconds(2), next);
+    CHECK((expired == std::vector<std::pair<vsomeip::service_t, vsomeip::instance_t>>{{0x1234, 1}}));
+    CHECK(next == now + std::chrono::seconds(3));
+    CHECK(table.activate(0x1234, 1));
+    CHECK(table.expired(now + std::chrono::seconds(2), next).empty());
+
+    // the loss of the other provider's offer is taken over right away
+    CHECK(table.availability(0x1234, 2, false));
+    CHECK(table.activate(0x1234, 2));
+    CHECK(!table.availability(0x1234, 2, true));
+    CHECK(!table.availability(0x1234, 2, false));
+    CHECK(!table.availability(0x1234, 4, false));
+
+    CHECK(!table.availability(0x1234, 3, true));
+    CHECK(table.expired(now + std::chrono::seconds(4), next).empty());
+    CHECK(!next);
+}
+
+}
+
+int main() {
+    takeover_test();
+    unlocked_callback_test();
+    remove_while_reporting_test();
+    initial_wait_test();
+    return test_result();
+}
@@ -0,0 +1,78 @@
+// SPDX-License-Identifier: MPL-2.0
+//
+// Copyright (C) 2024 Alexander Seifarth
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include "../subscriber_table.h"
+#include "check.h"
+
+#include <tuple>
+#include <vector>
+
+namespace {
+
+using report = std::tuple<vsomeip::eventgroup_t, vsomeip::client_t, bool>;
+
+void watch_test() {
+    subscriber_table table;
+    table.offer(0x1234, 1, 0x8001, {1});
+    std::vector<report> reports;
+    auto callback = [&reports](vsomeip::service_t, vsomeip::instance_t, vsomeip::eventgroup_t group,
+                               vsomeip::client_t client, bool subscribed) {
+        reports.emplace_back(group, client, subscribed);
+    };
+    // only the first watch of an eventgroup needs a subscription handler
+    CHECK(table.watch(0x1234, 1, 1, callback));
+    CHECK(!table.watch(0x1234, 1, 1, callback));
+    CHECK(table.subscribers(0x1234, 1, 0x8001) == 0);
+
+    table.update(0x1234, 1, 1, 0x10, true);
+    table.update(0x1234, 1, 1, 0x11, true);
+    // renewed subscriptions and unknown clients leaving are not reported
+    table.update(0x1234, 1, 1, 0x10, true);
+    table.update(0x1234, 1, 1, 0x12, false);
+    CHECK(table.subscribers(0x1234, 1, 0x8001) == 2);
+    table.update(0x1234, 1, 1, 0x10, false);
+    CHECK(table.subscribers(0x1234, 1, 0x8001) == 1);
+    CHECK((reports == std::vector<report>{{1, 0x10, true}, {1, 0x11, true}, {1, 0x10, false}}));
+
+    // without callback subscribers are still counted
+    CHECK(!table.watch(0x1234, 1, 1, {}));
+    table.update(0x1234, 1, 1, 0x13, true);
+    CHECK(reports.size() == 3);
+    CHECK(table.subscribers(0x1234, 1, 0x8001) == 2);
+}
+
+void count_test() {
+    subscriber_table table;
+    // an event nobody watches has no known subscribers
+    table.offer(0x1234, 1, 0x8001, {1, 2});
+    CHECK(table.subscribers(0x1234, 1, 0x8001) == 0);
+    CHECK(table.subscribers(0x1234, 1, 0x8002) == 0);
+
+    CHECK(table.watch(0x1234, 1, 1, {}));
+    CHECK(table.watch(0x1234, 1, 2, {}));
+    table.update(0x1234, 1, 1, 0x10, true);
+    table.update(0x1234, 1, 2, 0x10, true);
+    table.update(0x1234, 1, 2, 0x11, true);
+    // a client subscribed to several eventgroups of the event is counted once
+    CHECK(table.subscribers(0x1234, 1, 0x8001) == 2);
+    // other instances are separate
+    CHECK(table.subscribers(0x1234, 2, 0x8001) == 0);
+
+    // a withdrawn event has no subscribers, the eventgroups keep theirs for a new offer
+    table.withdraw(0x1234, 1, 0x8001);
+    CHECK(table.subscribers(0x1234, 1, 0x8001) == 0);
+    table.offer(0x1234, 1, 0x8001, {2});
+    CHECK(table.subscribers(0x1234, 1, 0x8001) == 2);
+}
+
+}
+
+int main() {
+    watch_test();
+    count_test();
+    return test_result();
+}
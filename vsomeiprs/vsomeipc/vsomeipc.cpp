@@ -7,14 +7,21 @@
 
 #include "vsomeipc.h"
 #include "application.h"
+#include "buffer_payload.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cstddef>
 #include <iostream>
 #include <optional>
 #include <thread>
 
 application_t create_application(const char* name) {
-    auto af = application::create(name);
+    return create_application_with_config(name, nullptr);
+}
+
+application_t create_application_with_config(const char* name, struct application_config const* config) {
+    auto af = application::create(name, config ? *config : application_config{});
     if (af) {
         return new std::shared_ptr<application>(af);
     }
@@ -32,23 +39,51 @@ char const* application_get_name(application_t app) {
     return (*app)->name().c_str();
 }
 
-struct message_header make_message_header(std::shared_ptr<vsomeip::message> const& msg) {
-    struct message_header hdr {
-            .service = msg->get_service(),
-            .instance = msg->get_instance(),
-            .method = msg->get_method(),
-            .client = msg->get_client(),
-            .session = msg->get_session(),
-            .proto_version = msg->get_protocol_version(),
-            .if_version = msg->get_interface_version(),
-            .message_type = (message_type) msg->get_message_type(),
-            .return_code = (return_code) msg->get_return_code(),
-            .is_initial = msg->is_initial(),
-            .is_reliable = msg->is_reliable(),
-            .data = msg->get_payload() ? msg->get_payload()->get_data() : nullptr,
-            .data_size = msg->get_length(),
-    };
-    return hdr;
+static_assert(sizeof(message_header) == VSOMEIPC_MESSAGE_HEADER_SIZE, "message_header layout changed");
+static_assert(offsetof(message_header, data) == 0 && offsetof(message_header, data_size) == 8
+              && offsetof(message_header, service) == 12 && offsetof(message_header, session) == 20
+              && offsetof(message_header, message_type) == 24 && offsetof(message_header, is_reliable) == 27
+              && offsetof(message_header, reserved) == 28 && offsetof(message_header, received_ns) == 32
+              && offsetof(message_header, handoff_ns) == 40,
+              "message_header layout changed");
+
+// Fills `set` with the event groups of an event. Consecutive events mostly share their event groups,
+// then the set is left as it is instead of being rebuilt node by node.
+void assign_event_groups(std::set<vsomeip::eventgroup_t>& set, eventgroup_id const* event_groups, uint32_t size) {
+    if (set.size() == size && std::equal(set.begin(), set.end(), event_groups)) {
+        return;
+    }
+    set.clear();
+    for (uint32_t i = 0; i < size; ++i) {
+        // event groups are usually given in ascending order, the end hint makes the insert O(1)
+        set.emplace_hint(set.end(), event_groups[i]);
+    }
+}
+
+// Fills `hdr` from `msg`, the payload data only `with_data` (headers passed along with the payload).
+void make_message_header(std::shared_ptr<vsomeip::message> const& msg, message_header& hdr, bool with_data = true) {
+    auto const& payload = with_data ? msg->get_payload() : nullptr;
+    hdr.data = payload ? reinterpret_cast<uintptr_t>(payload->get_data()) : 0;
+    hdr.data_size = payload ? payload->get_length() : 0;
+    hdr.service = msg->get_service();
+    hdr.instance = msg->get_instance();
+    hdr.method = msg->get_method();
+    hdr.client = msg->get_client();
+    hdr.session = msg->get_session();
+    hdr.proto_version = msg->get_protocol_version();
+    hdr.if_version = msg->get_interface_version();
+    hdr.message_type = static_cast<uint8_t>(msg->get_message_type());
+    hdr.return_code = static_cast<uint8_t>(msg->get_return_code());
+    hdr.is_initial = msg->is_initial();
+    hdr.is_reliable = msg->is_reliable();
+    hdr.reserved = 0;
+    hdr.received_ns = application::current_trace();
+    hdr.handoff_ns = hdr.received_ns ? vsomeipc_now_ns() : 0;
+}
+
+uint64_t vsomeipc_now_ns() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
 }
 
 void application_register_handlers(
@@ -65,20 +100,149 @@ void application_register_handlers(
     }
     if (msg_handler) {
         (*app)->setup_msg_handler(
-                [msg_handler, object](std::shared_ptr<vsomeip::message> const& msg) {
-                    msg_handler(
-                        make_message_header(msg),
-                        new std::shared_ptr<vsomeip::payload>(msg->get_payload()),
-                        object );
+                [a = app->get(), msg_handler, object](std::shared_ptr<vsomeip::message> const& msg) {
+                    auto payload = a->make_payload_handle(msg->get_payload());
+                    if (!payload) {
+                        return;     // payload handles exhausted, counted by the pool
+                    }
+                    message_header header;
+                    make_message_header(msg, header);
+                    msg_handler(&header, payload, object);
         });
     }
 }
 
+route_id application_add_route(application_t app, service_id service, instance_id instance,
+                               method_id first, method_id last,
+                               message_handler_t handler, void const* target, target_release_t release)
+{
+    assert(app && *app);
+    assert(handler);
+    // a handler still running after the route was removed keeps the target
+    std::shared_ptr<void const> keep{target, [release](void const* t) { if (release) release(t); }};
+    return (*app)->add_route(service, instance, first, last,
+            [a = app->get(), handler, target, keep = std::move(keep)](std::shared_ptr<vsomeip::message> const& msg) {
+                auto payload = a->make_payload_handle(msg->get_payload());
+                if (!payload) {
+                    return;
+                }
+                message_header header;
+                make_message_header(msg, header);
+                handler(&header, payload, target);
+            });
+}
+
+void application_remove_route(application_t app, route_id route) {
+    assert(app && *app);
+    (*app)->remove_route(route);
+}
+
+bool application_enable_field_cache(application_t app, char const* path, uint32_t slots, uint32_t slot_size)
+{
+    assert(app && *app);
+    assert(path);
+    return (*app)->enable_field_cache(path, slots, slot_size);
+}
+
+void application_forget_cached_field(application_t app, service_id service, instance_id instance, notifier_id notifier)
+{
+    assert(app && *app);
+    (*app)->forget_cached_field(service, instance, notifier);
+}
+
+bool application_create_shm_pool(application_t app, char const* name, uint32_t segments, uint32_t segment_size)
+{
+    assert(app && *app);
+    assert(name);
+    return (*app)->create_shm_pool(name, segments, segment_size);
+}
+
+int32_t application_shm_acquire(application_t app, uint8_t** data, uint32_t* capacity)
+{
+    assert(app && *app);
+    assert(data && capacity);
+    return (*app)->shm_acquire(*data, *capacity);
+}
+
+void application_notify_shm(application_t app, service_id service, instance_id instance, notifier_id notifier,
+                            int32_t segment, uint32_t length, bool force_send)
+{
+    assert(app && *app);
+    assert(segment >= 0);
+    (*app)->notify_shm(service, instance, notifier, segment, length, force_send);
+}
+
+void application_shm_discard(application_t app, int32_t segment)
+{
+    assert(app && *app);
+    assert(segment >= 0);
+    (*app)->shm_discard(segment);
+}
+
+bool application_attach_shm_pool(application_t app, service_id service, instance_id instance, notifier_id notifier,
+                                 char const* name)
+{
+    assert(app && *app);
+    assert(name);
+    return (*app)->attach_shm_pool(service, instance, notifier, name);
+}
+
+uint64_t application_shm_lost(application_t app)
+{
+    assert(app && *app);
+    return (*app)->shm_lost();
+}
+
+void application_set_message_filter(application_t app, message_filter_t filter, void const* context)
+{
+    assert(app && *app);
+    assert(filter);
+    (*app)->set_message_filter([filter, context](std::shared_ptr<vsomeip::message> const& msg) {
+        message_header header;
+        make_message_header(msg, header, false);
+        return filter(&header, context);
+    });
+}
+
+void application_set_trace_sampling(application_t app, uint32_t every)
+{
+    assert(app && *app);
+    (*app)->set_trace_sampling(every);
+}
+
+uint32_t application_drain(application_t app, struct message_header* headers, payload_t* payloads, uint32_t max) {
+    assert(app && *app);
+    assert(headers && payloads);
+    constexpr uint32_t chunk_size = 64;
+    std::shared_ptr<vsomeip::message> chunk[chunk_size];
+    uint32_t count = 0;
+    while (count < max) {
+        auto n = (*app)->drain(chunk, std::min(chunk_size, max - count));
+        for (std::size_t i = 0; i < n; ++i) {
+            // messages without a payload handle are dropped
+            if (auto payload = (*app)->make_payload_handle(chunk[i]->get_payload())) {
+                make_message_header(chunk[i], headers[count]);
+                payloads[count++] = payload;
+            }
+            chunk[i].reset();
+        }
+        if (n < chunk_size) {
+            break;
+        }
+    }
+    return count;
+}
+
+uint64_t application_batch_dropped(application_t app) {
+    assert(app && *app);
+    return (*app)->batch_dropped();
+}
+
 payload_t application_payload_create(application_t app, uint8_t const* data, uint32_t size) {
     assert(app && *app);
     auto pl = (*app)->create_payload(data, size);
     if (pl)
-        return new std::shared_ptr<vsomeip::payload>(pl);
+        return (*app)->make_payload_handle(std::move(pl));
     return nullptr;
 }
 
@@ -86,12 +250,27 @@ payload_t payload_create_empty(application_t app) {
     assert(app && *app);
     auto pl = (*app)->create_payload_empty();
     if (pl)
-        return new std::shared_ptr<vsomeip::payload>(pl);
+        return (*app)->make_payload_handle(std::move(pl));
     return nullptr;
 }
 
 void payload_destroy(payload_t pl) {
-    delete pl;
+    if (pl && pl->owner) {
+        pl->owner->release(pl);
+    } else {
+        delete pl;
+    }
+}
+
+payload_pool_stats application_payload_pool_stats(application_t app) {
+    assert(app && *app);
+    return (*app)->pool_stats();
+}
+
+void application_get_stats(application_t app, struct application_stats* stats) {
+    assert(app && *app);
+    assert(stats);
+    (*app)->stats(*stats);
 }
 
 static vsomeip::message_type_e from(message_type mt) {
@@ -162,21 +341,47 @@ message_t application_create_message(application_t app,
     return nullptr;
 }
 
+void application_send_msg(application_t app, message_t msg) {
+    assert(app && *app);
+    assert(msg && *msg);
+    (*app)->send(*msg);
+}
+
 void message_destroy(message_t msg) {
     delete msg;
 }
 
+message_t application_create_request_template(application_t app, service_id service, instance_id instance,
+                                              method_id method, major_version major, bool reliable)
+{
+    assert(app && *app);
+    auto msg = (*app)->create_request_template(service, instance, method, major, reliable);
+    if (msg) {
+        return new std::shared_ptr<vsomeip::message>(std::move(msg));
+    }
+    return nullptr;
+}
+
+session_id application_send_with(application_t app, message_t tmpl, uint8_t const* data, uint32_t data_len)
+{
+    assert(app && *app);
+    assert(tmpl && *tmpl);
+    return (*app)->send_with(*tmpl, data, data_len);
+}
+
 void application_request_service(application_t app,
                                  service_id service,
                                  instance_id instance,
                                  major_version major,
                                  minor_version minor,
                                  availability_handler_t avail_handler,
-                                 void const* object)
+                                 void const* object,
+                                 target_release_t release)
 {
     assert(app && *app);
+    std::shared_ptr<void const> keep{object, [release](void const* t) { if (release) release(t); }};
     (*app)->setup_avail_handler(service, instance, major,
-        [avail_handler, object](vsomeip::service_t svc, vsomeip::instance_t inst, bool avail) {
+        [avail_handler, object, keep = std::move(keep)](vsomeip::service_t svc, vsomeip::instance_t inst, bool avail) {
             avail_handler(svc, inst, avail ? AS_AVAILABLE : AS_UNAVAILABLE, object);}
     );
     (*app)->request_service(service, instance, major, minor);
@@ -202,6 +407,31 @@ void application_stop_offer_service(application_t app, service_id  service, inst
     (*app)->stop_offer_service(service, instance, major, minor);
 }
 
+void application_offer_service_standby(application_t app, service_id service, instance_id instance,
+                                       major_version major, minor_version minor, uint32_t initial_wait_ms,
+                                       provider_role_handler_t role_handler, void const* target)
+{
+    assert(app && *app);
+    assert(role_handler);
+    (*app)->offer_service_standby(service, instance, major, minor, std::chrono::milliseconds(initial_wait_ms),
+        [role_handler, target](vsomeip::service_t svc, vsomeip::instance_t inst, bool active) {
+            role_handler(svc, inst, active ? PR_ACTIVE : PR_STANDBY, target);}
+    );
+}
+
+void application_stop_offer_service_standby(application_t app, service_id service, instance_id instance)
+{
+    assert(app && *app);
+    (*app)->stop_offer_service_standby(service, instance);
+}
+
+void application_prepare_field(application_t app, service_id service, instance_id instance, notifier_id notifier,
+                               bool force_send, uint8_t const* data, uint32_t data_len)
+{
+    assert(app && *app);
+    (*app)->prepare_field(service, instance, notifier, force_send, data, data_len);
+}
+
 void application_offer_event(application_t app, service_id service, instance_id instance, notifier_id notifier,
                              eventgroup_id const* event_groups, uint32_t event_groups_size, bool is_field,
                              uint32_t cycle, bool change_resets_cycle, bool update_on_change)
@@ -209,14 +439,38 @@ void application_offer_event(application_t app, service_id service, instance_id
     assert(app && *app);
     assert(event_groups != nullptr);
     std::set<vsomeip::eventgroup_t> event_groups_set{};
-    for(int i = 0; i < event_groups_size; ++i) {
-        event_groups_set.emplace(event_groups[i]);
-    }
+    assign_event_groups(event_groups_set, event_groups, event_groups_size);
     (*app)->offer_event(service, instance, notifier, event_groups_set,
                         is_field ? vsomeip::event_type_e::ET_FIELD : vsomeip::event_type_e::ET_EVENT,
                         std::chrono::milliseconds(cycle),change_resets_cycle, update_on_change);
 }
 
+void application_offer_event_with_epsilon(application_t app, service_id service, instance_id instance,
+        notifier_id notifier, eventgroup_id const* event_groups, uint32_t event_groups_size, bool is_field,
+        uint32_t cycle, bool change_resets_cycle, bool update_on_change,
+        epsilon_change_t epsilon, void const* context, target_release_t release)
+{
+    assert(app && *app);
+    assert(event_groups != nullptr);
+    assert(epsilon);
+    std::set<vsomeip::eventgroup_t> event_groups_set{};
+    assign_event_groups(event_groups_set, event_groups, event_groups_size);
+    // a comparator replaced by a new offer may still run on a notifying thread
+    std::shared_ptr<void const> keep{context, [release](void const* c) { if (release) release(c); }};
+    auto epsilon_change_func = [epsilon, context, keep = std::move(keep)](
+            std::shared_ptr<vsomeip::payload> const& old_value, std::shared_ptr<vsomeip::payload> const& new_value) {
+        if (!old_value || !new_value) {
+            return true;
+        }
+        return epsilon(old_value->get_data(), old_value->get_length(),
+                       new_value->get_data(), new_value->get_length(), context);
+    };
+    (*app)->offer_event(service, instance, notifier, event_groups_set,
+                        is_field ? vsomeip::event_type_e::ET_FIELD : vsomeip::event_type_e::ET_EVENT,
+                        std::chrono::milliseconds(cycle), change_resets_cycle, update_on_change,
+                        epsilon_change_func);
+}
+
 void application_stop_offer_event(application_t app, service_id service, instance_id instance, notifier_id notifier)
 {
     assert(app && *app);
@@ -229,9 +483,7 @@ void application_request_event(application_t app, service_id service, instance_i
     assert(app && *app);
     assert(event_groups != nullptr);
     std::set<vsomeip::eventgroup_t> event_groups_set{};
-    for(int i = 0; i < event_groups_size; ++i) {
-        event_groups_set.emplace(event_groups[i]);
-    }
+    assign_event_groups(event_groups_set, event_groups, event_groups_size);
     (*app)->request_event(service, instance, notifier, event_groups_set,
                           is_field ? vsomeip::event_type_e::ET_FIELD : vsomeip::event_type_e::ET_EVENT);
 }
@@ -242,6 +494,35 @@ void application_release_event(application_t app, service_id service, instance_i
     (*app)->release_event(service, instance, notifier);
 }
 
+void application_offer_events(application_t app, struct event_descriptor const* events, uint32_t events_size)
+{
+    assert(app && *app);
+    assert(events != nullptr || events_size == 0);
+    std::set<vsomeip::eventgroup_t> event_groups_set{};
+    for (uint32_t i = 0; i < events_size; ++i) {
+        auto const& event = events[i];
+        assert(event.event_groups != nullptr || event.event_groups_size == 0);
+        assign_event_groups(event_groups_set, event.event_groups, event.event_groups_size);
+        (*app)->offer_event(event.service, event.instance, event.notifier, event_groups_set,
+                            event.is_field ? vsomeip::event_type_e::ET_FIELD : vsomeip::event_type_e::ET_EVENT,
+                            std::chrono::milliseconds(event.cycle), event.change_resets_cycle, event.update_on_change);
+    }
+}
+
+void application_request_events(application_t app, struct event_descriptor const* events, uint32_t events_size)
+{
+    assert(app && *app);
+    assert(events != nullptr || events_size == 0);
+    std::set<vsomeip::eventgroup_t> event_groups_set{};
+    for (uint32_t i = 0; i < events_size; ++i) {
+        auto const& event = events[i];
+        assert(event.event_groups != nullptr || event.event_groups_size == 0);
+        assign_event_groups(event_groups_set, event.event_groups, event.event_groups_size);
+        (*app)->request_event(event.service, event.instance, event.notifier, event_groups_set,
+                              event.is_field ? vsomeip::event_type_e::ET_FIELD : vsomeip::event_type_e::ET_EVENT);
+    }
+}
+
 void application_subscribe_event(application_t app, service_id service, instance_id instance, eventgroup_id eg,
                                  notifier_id event, major_version version)
 {
@@ -249,12 +530,109 @@ void application_subscribe_event(application_t app, service_id service, instance
     (*app)->subscribe(service, instance, eg, version, event);
 }
 
+void application_subscribe_with_debounce(application_t app, service_id service, instance_id instance,
+                                         eventgroup_id eg, notifier_id event, major_version version,
+                                         struct debounce_filter const* filter)
+{
+    assert(app && *app);
+    assert(filter);
+    vsomeip::debounce_filter_t vsomeip_filter;
+    vsomeip_filter.on_change_ = filter->on_change;
+    vsomeip_filter.on_change_resets_interval_ = filter->on_change_resets_interval;
+    vsomeip_filter.send_current_value_after_ = filter->send_current_value_after;
+    vsomeip_filter.interval_ = filter->interval_ms;
+    for (uint32_t i = 0; i < filter->ignore_size; ++i) {
+        vsomeip_filter.ignore_[filter->ignore[i].index] |= filter->ignore[i].mask;
+    }
+    (*app)->subscribe_with_debounce(service, instance, eg, version, event, vsomeip_filter);
+}
+
 void application_unsubscribe_event(application_t app, service_id service, instance_id instance, eventgroup_id eg)
 {
     assert(app && *app);
     (*app)->unsubscribe(service, instance, eg);
 }
 
+void application_watch_subscriptions(application_t app, service_id service, instance_id instance, eventgroup_id eg,
+                                     subscription_handler_t handler, void const* target)
+{
+    assert(app && *app);
+    subscriber_table::subscription_callback_t callback;
+    if (handler) {
+        callback = [handler, target](vsomeip::service_t svc, vsomeip::instance_t inst, vsomeip::eventgroup_t group,
+                                     vsomeip::client_t client, bool subscribed) {
+            handler(svc, inst, group, client, subscribed, target);
+        };
+    }
+    (*app)->watch_subscriptions(service, instance, eg, std::move(callback));
+}
+
+uint32_t application_subscriber_count(application_t app, service_id service, instance_id instance,
+                                      notifier_id notifier)
+{
+    assert(app && *app);
+    return (*app)->subscriber_count(service, instance, notifier);
+}
+
+void application_watch_subscription_status(application_t app, service_id service, instance_id instance,
+                                           eventgroup_id eg, notifier_id event,
+                                           subscription_status_handler_t handler, void const* target)
+{
+    assert(app && *app);
+    assert(handler);
+    (*app)->watch_subscription_status(service, instance, eg, event,
+        [handler, target](vsomeip::service_t svc, vsomeip::instance_t inst, vsomeip::eventgroup_t group,
+                          vsomeip::event_t ev, bool accepted) {
+            handler(svc, inst, group, ev, accepted, target);}
+    );
+}
+
+void application_unwatch_subscription_status(application_t app, service_id service, instance_id instance,
+                                             eventgroup_id eg, notifier_id event)
+{
+    assert(app && *app);
+    (*app)->unwatch_subscription_status(service, instance, eg, event);
+}
+
+bool application_conflate_event(application_t app, service_id service, instance_id instance, notifier_id notifier,
+                                field_dirty_handler_t dirty_handler, void const* object)
+{
+    assert(app && *app);
+    assert(dirty_handler);
+    return (*app)->conflate_event(service, instance, notifier,
+        [dirty_handler, object](vsomeip::service_t svc, vsomeip::instance_t inst, vsomeip::event_t event) {
+            dirty_handler(svc, inst, event, object); }
+    );
+}
+
+void application_unconflate_event(application_t app, service_id service, instance_id instance, notifier_id notifier)
+{
+    assert(app && *app);
+    (*app)->unconflate_event(service, instance, notifier);
+}
+
+payload_t application_take_conflated(application_t app, service_id service, instance_id instance,
+                                     notifier_id notifier, struct message_header* header, bool* exhausted)
+{
+    assert(app && *app);
+    assert(header);
+    assert(exhausted);
+    *exhausted = false;
+    auto msg = (*app)->take_conflated(service, instance, notifier);
+    if (!msg) {
+        return nullptr;
+    }
+    auto payload = (*app)->make_payload_handle(msg->get_payload());
+    if (!payload) {
+        // counted by the pool, the value must not get lost
+        *exhausted = true;
+        (*app)->restore_conflated(std::move(msg));
+        return nullptr;
+    }
+    make_message_header(msg, *header);
+    return payload;
+}
+
 void application_notify(application_t app, service_id service, instance_id instance, notifier_id notifier,
                                    bool force_send, uint8_t const* data, uint32_t data_len)
 {
@@ -262,6 +640,22 @@ void application_notify(application_t app, service_id service, instance_id insta
     (*app)->notify(service, instance, notifier, force_send, data, data_len);
 }
 
+void application_notify_many(application_t app, struct notify_entry const* entries, uint32_t count)
+{
+    assert(app && *app);
+    assert(entries || count == 0);
+    (*app)->notify_many(entries, count);
+}
+
+void application_send_requests(application_t app, service_id service, struct request_target const* targets,
+                               uint32_t count, major_version major, bool reliable,
+                               uint8_t const* data, uint32_t data_len, session_id* sessions)
+{
+    assert(app && *app);
+    assert((targets && sessions) || count == 0);
+    (*app)->send_requests(service, targets, count, major, reliable, data, data_len, sessions);
+}
+
 session_id application_send_request(application_t app, service_id service, instance_id instance, method_id method,
                               major_version major, bool reliable, uint8_t const* data, uint32_t data_len)
 {
@@ -284,10 +678,47 @@ void application_send_error(application_t app, service_id service, instance_id i
     (*app)->send_error(service, instance, method, client, session, major, reliable, from(rc));
 }
 
+void application_notify_buffer(application_t app, service_id service, instance_id instance, notifier_id notifier,
+                               bool force_send, uint8_t const* data, uint32_t data_len,
+                               buffer_release_t release, void* context)
+{
+    assert(app && *app);
+    (*app)->notify(service, instance, notifier, force_send,
+                   std::make_shared<buffer_payload>(data, data_len, release, context));
+}
+
+static std::shared_ptr<vsomeip::payload> forwarded(application_t app, payload_t payload) {
+    return payload && payload->payload ? payload->payload : (*app)->create_payload_empty();
+}
+
+void application_forward_notification(application_t app, service_id service, instance_id instance,
+                                      notifier_id notifier, bool force_send, payload_t payload)
+{
+    assert(app && *app);
+    (*app)->notify(service, instance, notifier, force_send, forwarded(app, payload));
+}
+
+session_id application_forward_request(application_t app, service_id service, instance_id instance,
+                                       method_id method, major_version major, bool reliable, bool no_return,
+                                       payload_t payload)
+{
+    assert(app && *app);
+    return (*app)->forward_request(service, instance, method, major, reliable, no_return, forwarded(app, payload));
+}
+
+void application_forward_response(application_t app, service_id service, instance_id instance, method_id method,
+                                  client_id client, session_id session, major_version major, bool reliable,
+                                  enum return_code rc, payload_t payload)
+{
+    assert(app && *app);
+    (*app)->send_response(service, instance, method, client, session, major, reliable, from(rc),
+                          forwarded(app, payload));
+}
+
 PayloadInfo payload_get_info(payload_t pl) {
     assert(pl);
-    if (*pl){
-        return PayloadInfo{ (*pl)->get_data() , static_cast<uint32_t>((*pl)->get_length())};
+    if (pl->payload){
+        return PayloadInfo{ pl->payload->get_data() , static_cast<uint32_t>(pl->payload->get_length())};
     } else {
         return PayloadInfo{ nullptr, 0};
     }
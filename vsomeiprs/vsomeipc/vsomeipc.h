@@ -18,6 +18,17 @@ enum availability_state_e {
     AS_AVAILABLE = 1,
 };
 
+enum provider_role_e {
+    PR_STANDBY = 0,
+    PR_ACTIVE = 1,
+};
+
+enum overflow_policy_e {
+    OP_BLOCK = 0,
+    OP_DROP_NEWEST = 1,
+    OP_DROP_OLDEST = 2,
+};
+
 enum message_type {
     MT_REQUEST = 0x00,
     MT_REQUEST_NO_RETURN = 0x01,
@@ -56,8 +67,9 @@ enum return_code {
 class application;
 using application_t = std::shared_ptr<application>*;
 
+struct payload_handle;
 using message_t = std::shared_ptr<vsomeip::message>*;
-using payload_t = std::shared_ptr<vsomeip::payload>*;
+using payload_t = payload_handle*;
 
 using service_id = vsomeip::service_t;
 using instance_id = vsomeip::instance_t;
@@ -70,6 +82,7 @@ using protocol_version = vsomeip::protocol_version_t;
 using interface_version = vsomeip::interface_version_t;
 using major_version = vsomeip::major_version_t;
 using minor_version = vsomeip::minor_version_t;
+using route_id = uint32_t;
 
 #else
 
@@ -90,6 +103,7 @@ typedef uint8_t protocol_version;
 typedef uint8_t interface_version;
 typedef uint8_t major_version;
 typedef uint32_t minor_version;
+typedef uint32_t route_id;
 
 #endif
 
@@ -99,8 +113,27 @@ extern "C" {
 
     typedef void (*state_handler_t)(enum state_type_ce state, void const* target);
     typedef void (*availability_handler_t)(service_id svc_id, instance_id inst_id, enum availability_state_e avail, void const* target);
+    typedef void (*provider_role_handler_t)(service_id svc_id, instance_id inst_id, enum provider_role_e role, void const* target);
+    typedef void (*subscription_handler_t)(service_id svc_id, instance_id inst_id, eventgroup_id eg, client_id client,
+                                           bool subscribed, void const* target);
+    typedef void (*subscription_status_handler_t)(service_id svc_id, instance_id inst_id, eventgroup_id eg,
+                                                  notifier_id event, bool accepted, void const* target);
 
+    // Header of a received message, passed to the message handler by pointer (valid during the call).
+    // The fields are ordered by alignment so that the struct has no internal padding, its layout is a
+    // contract with the Rust side checked on both sides (VSOMEIPC_MESSAGE_HEADER_SIZE). It is the same
+    // on 32 and 64 bit targets: the payload address is held in 64 bits and the padding before the
+    // trace stamps, which 32 bit targets align to 4 bytes only, is explicit.
+    // `message_type` and `return_code` hold the values of enum message_type and enum return_code.
+    // `data` (the address of the uint8_t data) and `data_size` refer to the payload handed over with
+    // the header, `data` is only valid as long as the payload is. Headers passed to a message_filter_t
+    // have no payload, `data` is 0 there.
+    // `received_ns` and `handoff_ns` are the trace stamps (vsomeipc_now_ns) of a message sampled for
+    // tracing: entry of the vsomeip message handler and call of the message_handler_t; 0 if not sampled.
+#define VSOMEIPC_MESSAGE_HEADER_SIZE 48
     struct message_header {
+        uint64_t data;
+        uint32_t data_size;
         service_id service;
         instance_id instance;
         method_id  method;
@@ -108,18 +141,57 @@ extern "C" {
         session_id session;
         protocol_version proto_version;
         interface_version if_version;
-        enum message_type message_type;
-        enum return_code return_code;
+        uint8_t message_type;
+        uint8_t return_code;
         bool is_initial;
         bool is_reliable;
-        uint8_t const* data;
-        uint32_t data_size;
+        uint32_t reserved;
+        uint64_t received_ns;
+        uint64_t handoff_ns;
     };
 
-    typedef void (*message_handler_t)(struct message_header header, payload_t payload, void const* target);
+    typedef void (*message_handler_t)(struct message_header const* header, payload_t payload, void const* target);
+    typedef bool (*message_filter_t)(struct message_header const* header, void const* context);
+    typedef void (*field_dirty_handler_t)(service_id service, instance_id instance, notifier_id notifier, void const* target);
+    typedef void (*batch_ready_handler_t)(void const* target);
+    typedef void (*buffer_release_t)(void* context);
+    typedef void (*target_release_t)(void const* target);
+    typedef bool (*epsilon_change_t)(uint8_t const* old_data, uint32_t old_len,
+                                     uint8_t const* new_data, uint32_t new_len, void const* context);
+
+    // Threading of an application, 0 selects the vsomeip default for each value.
+    // The vsomeip values (io_threads, max_dispatchers, max_dispatch_time_ms) are passed to vsomeip
+    // through a generated application specific configuration and only take effect if the base
+    // configuration does not configure the application itself.
+    // With dispatch_workers > 0 the message handler runs on that many worker threads, messages are
+    // sharded by service id so that the messages of a service are handled in order. Each worker
+    // queues up to `dispatch_queue_capacity` messages (0 for the default), `dispatch_overflow`
+    // decides whether the vsomeip dispatcher waits for room or which message is discarded.
+    // `transport_config` is vsomeip JSON configuration text (e.g. socket buffer and endpoint queue
+    // settings) added to the generated configuration, NULL for none.
+    // With batch_capacity > 0 the application starts in batched receive mode: messages are collected
+    // in a ring of that capacity and fetched with application_drain, `batch_ready_handler` is invoked
+    // with `batch_ready_object` when messages become available after the previous drain.
+    struct application_config {
+        uint32_t io_threads;
+        uint32_t max_dispatchers;
+        uint32_t max_dispatch_time_ms;
+        uint32_t dispatch_workers;
+        char const* transport_config;
+        uint32_t payload_handles;       // capacity of the payload handle pool, 0 for the default
+        uint32_t dispatch_queue_capacity;
+        enum overflow_policy_e dispatch_overflow;
+        uint32_t batch_capacity;
+        batch_ready_handler_t batch_ready_handler;
+        void const* batch_ready_object;
+    };
 
     // application handling
+    // monotonic clock of the trace stamps in ns
+    uint64_t vsomeipc_now_ns(void);
+
     application_t create_application(const char* name);
+    application_t create_application_with_config(const char* name, struct application_config const* config);
     void application_register_handlers(application_t app,
                                        state_handler_t state_handler,
                                        message_handler_t msg_handler,
@@ -127,34 +199,177 @@ extern "C" {
     void application_delete(application_t app);
     char const* application_get_name(application_t app);
 
+    // persistent cache of the last value of each offered field in the file `path` (`slots` fields of
+    // up to `slot_size` bytes), cached values are notified when their field is offered again. Values
+    // notified with application_notify_shm are not cached and a field stops being cached when its offer
+    // is stopped. Must be enabled before offering fields.
+    // Returns false if the file cannot be mapped or a cache is already enabled.
+    bool application_enable_field_cache(application_t app, char const* path, uint32_t slots, uint32_t slot_size);
+    // removes the cached value of a field that will not be offered again and frees its slot in the file
+    void application_forget_cached_field(application_t app, service_id service, instance_id instance, notifier_id notifier);
+
+    // shared memory payloads between applications on the same host: the provider writes a payload into
+    // a segment of its pool (application_shm_acquire returns the segment index or -1 if none is free)
+    // and notifies only a descriptor of it. Consumers attach the event to the pool, the payload of a
+    // received notification then refers to the segment until it is destroyed. Notifications whose
+    // segment has been reused by the provider before they were received are dropped and counted.
+    bool application_create_shm_pool(application_t app, char const* name, uint32_t segments, uint32_t segment_size);
+    int32_t application_shm_acquire(application_t app, uint8_t** data, uint32_t* capacity);
+    void application_notify_shm(application_t app, service_id service, instance_id instance, notifier_id notifier,
+                                int32_t segment, uint32_t length, bool force_send);
+    void application_shm_discard(application_t app, int32_t segment);
+    bool application_attach_shm_pool(application_t app, service_id service, instance_id instance, notifier_id notifier,
+                                     char const* name);
+    uint64_t application_shm_lost(application_t app);
+
+    // header filter: received messages for which `filter` returns false are discarded before a payload
+    // handle is created for them or they are dispatched. Must be set at most once.
+    void application_set_message_filter(application_t app, message_filter_t filter, void const* context);
+
+    // tracing: every `every`th received message gets trace stamps in its header, 0 disables tracing
+    void application_set_trace_sampling(application_t app, uint32_t every);
+
+    // batched receive mode (application_config.batch_capacity)
+    uint32_t application_drain(application_t app, struct message_header* headers, payload_t* payloads, uint32_t max);
+    uint64_t application_batch_dropped(application_t app);
+
+    // Routes deliver the messages of a method range of a service instance to their own handler,
+    // instance ANY_INSTANCE (0xFFFF) matches all instances without a route of their own.
+    // application_add_route returns 0 if the range overlaps an existing route. After
+    // application_remove_route returned the route's handler won't be invoked anymore, an invocation
+    // still running completes. `release(target)` (if not null) is called once the handler has
+    // returned for the last time, also if the route cannot be added.
+    route_id application_add_route(application_t app, service_id service, instance_id instance,
+                                   method_id first, method_id last,
+                                   message_handler_t handler, void const* target, target_release_t release);
+    void application_remove_route(application_t app, route_id route);
+
     session_id send_request(application_t app, uint8_t const* data, uint32_t data_len);
 
 
+    // vsomeip keeps one availability handler per requested instance, a second request replaces it.
+    // `release(object)` is invoked once the handler is released and has returned for the last time.
     void application_request_service(application_t app, service_id service, instance_id instance,
                                      major_version major, minor_version minor,
-                                     availability_handler_t avail_handler, void const* object);
+                                     availability_handler_t avail_handler, void const* object,
+                                     target_release_t release);
     void application_release_service(application_t app, service_id service, instance_id instance, major_version major);
     void application_offer_service(application_t app, service_id service, instance_id instance,
                                    major_version major, minor_version  minor);
     void application_stop_offer_service(application_t app, service_id  service, instance_id instance,
                                         major_version major, minor_version minor);
+
+    // hot-standby: the instance starts in standby role and is offered once the other provider's offer
+    // is lost, or after `initial_wait_ms` if no other provider has been seen by then (should exceed the
+    // service discovery cyclic offer delay); `role_handler` reports the role; until the takeover
+    // application_prepare_field only keeps the latest field values
+    void application_offer_service_standby(application_t app, service_id service, instance_id instance,
+                                           major_version major, minor_version minor, uint32_t initial_wait_ms,
+                                           provider_role_handler_t role_handler, void const* target);
+    void application_stop_offer_service_standby(application_t app, service_id service, instance_id instance);
+    void application_prepare_field(application_t app, service_id service, instance_id instance, notifier_id notifier,
+                                   bool force_send, uint8_t const* data, uint32_t data_len);
     void application_offer_event(application_t app, service_id service, instance_id instance, notifier_id notifier,
             eventgroup_id const* event_groups, uint32_t event_groups_size, bool is_field,
             uint32_t cycle, bool change_resets_cycle, bool update_on_change);
+    // offers an event whose notifications are only sent when `epsilon` reports a significant change
+    // against the last sent value (notifications with force_send are always sent);
+    // `release` is invoked with `context` once vsomeip no longer uses the comparator
+    void application_offer_event_with_epsilon(application_t app, service_id service, instance_id instance,
+            notifier_id notifier, eventgroup_id const* event_groups, uint32_t event_groups_size, bool is_field,
+            uint32_t cycle, bool change_resets_cycle, bool update_on_change,
+            epsilon_change_t epsilon, void const* context, target_release_t release);
     void application_stop_offer_event(application_t app, service_id service, instance_id instance, notifier_id notifier);
     void application_request_event(application_t app, service_id service, instance_id instance, notifier_id notifier,
                                    eventgroup_id const* event_groups, uint32_t event_groups_size, bool is_field);
     void application_release_event(application_t app, service_id service, instance_id instance, notifier_id notifier);
+
+    // bulk registration of events, e.g. for a whole service catalogue
+    struct event_descriptor {
+        service_id service;
+        instance_id instance;
+        notifier_id notifier;
+        bool is_field;
+        bool change_resets_cycle;       // offer only
+        bool update_on_change;          // offer only
+        uint32_t cycle;                 // offer only, cycle time in ms (0: no cyclic notifications)
+        eventgroup_id const* event_groups;
+        uint32_t event_groups_size;
+    };
+
+    void application_offer_events(application_t app, struct event_descriptor const* events, uint32_t events_size);
+    void application_request_events(application_t app, struct event_descriptor const* events, uint32_t events_size);
     void application_subscribe_event(application_t app, service_id service, instance_id instance, eventgroup_id eg,
                                      notifier_id event, major_version version);
     void application_unsubscribe_event(application_t app, service_id service, instance_id instance, eventgroup_id eg);
 
-    //    void subscribe_with_debounce(vsomeip::service_t service, vsomeip::instance_t instance,
-    //                                 vsomeip::eventgroup_t event_group, vsomeip::major_version_t major,
-    //                                 vsomeip::event_t event, vsomeip::debounce_filter_t const& filter);
+    // subscribers of offered events: watching an eventgroup registers its vsomeip subscription handler,
+    // which accepts all subscriptions and tracks the subscribers. `handler` reports subscribers of the
+    // eventgroup joining or leaving (null stops reporting, the subscribers are still tracked). The
+    // subscriber count of an event only includes its watched eventgroups.
+    void application_watch_subscriptions(application_t app, service_id service, instance_id instance, eventgroup_id eg,
+                                         subscription_handler_t handler, void const* target);
+    uint32_t application_subscriber_count(application_t app, service_id service, instance_id instance,
+                                          notifier_id notifier);
+    // acknowledgement of own subscriptions: `handler` reports whether the provider accepted a subscription
+    void application_watch_subscription_status(application_t app, service_id service, instance_id instance,
+                                               eventgroup_id eg, notifier_id event,
+                                               subscription_status_handler_t handler, void const* target);
+    void application_unwatch_subscription_status(application_t app, service_id service, instance_id instance,
+                                                 eventgroup_id eg, notifier_id event);
+
+    // conflated events: only the latest notification is kept, `dirty_handler` signals a new value
+    bool application_conflate_event(application_t app, service_id service, instance_id instance, notifier_id notifier,
+                                    field_dirty_handler_t dirty_handler, void const* object);
+    void application_unconflate_event(application_t app, service_id service, instance_id instance, notifier_id notifier);
+    // returns null if no new value has arrived; if no payload handle is free (static memory builds)
+    // `exhausted` is set to true and the value is kept for a later call
+    payload_t application_take_conflated(application_t app, service_id service, instance_id instance,
+                                         notifier_id notifier, struct message_header* header, bool* exhausted);
+
+    // debounce filters: notifications the filter rejects are dropped by vsomeip before they are dispatched
+    struct debounce_ignore {
+        uint32_t index;         // byte of the payload
+        uint8_t mask;           // bits of that byte not considered by the on_change comparison
+    };
+
+    struct debounce_filter {
+        bool on_change;                 // pass a notification when the payload differs from the last passed one
+        bool on_change_resets_interval; // a notification passed by on_change restarts the interval
+        bool send_current_value_after;  // pass the latest value once the interval expired
+        int64_t interval_ms;            // pass a notification after this time, -1 disables the interval
+        struct debounce_ignore const* ignore;
+        uint32_t ignore_size;
+    };
+
+    void application_subscribe_with_debounce(application_t app, service_id service, instance_id instance,
+                                             eventgroup_id eg, notifier_id event, major_version version,
+                                             struct debounce_filter const* filter);
 
     void application_notify(application_t app, service_id service, instance_id instance, notifier_id notifier,
                             bool force_send, uint8_t const* data, uint32_t data_len);
+
+    struct notify_entry {
+        service_id service;
+        instance_id instance;
+        notifier_id notifier;
+        bool force;
+        uint8_t const* data;
+        uint32_t data_len;
+    };
+
+    void application_notify_many(application_t app, struct notify_entry const* entries, uint32_t count);
+
+    // scatter-gather requests: the same payload is sent to every target, the session of the request
+    // to targets[i] is written to sessions[i]
+    struct request_target {
+        instance_id instance;
+        method_id method;
+    };
+
+    void application_send_requests(application_t app, service_id service, struct request_target const* targets,
+                                   uint32_t count, major_version major, bool reliable,
+                                   uint8_t const* data, uint32_t data_len, session_id* sessions);
     session_id application_send_request(application_t app, service_id service, instance_id instance, method_id method,
                             major_version major, bool reliable, uint8_t const* data, uint32_t data_len);
     void application_send_response(application_t app, service_id service, instance_id instance, method_id method,
@@ -163,6 +378,24 @@ extern "C" {
     void application_send_error(application_t app, service_id service, instance_id instance, method_id method,
                                 client_id client, session_id session, major_version major, bool reliable,  enum return_code rc);
 
+    // buffer variant of notify: the payload refers to the caller's buffer `data` which must stay valid until
+    // `release(context)` is invoked (possibly from a vsomeip thread). The notification is created without
+    // copying the data, vsomeip copies it when it stores the notified value.
+    void application_notify_buffer(application_t app, service_id service, instance_id instance, notifier_id notifier,
+                                   bool force_send, uint8_t const* data, uint32_t data_len,
+                                   buffer_release_t release, void* context);
+
+    // forwarding of received messages: the message is sent with the payload object of the received
+    // one, its data is not copied by the shim; `payload` stays owned by the caller, null sends an empty payload
+    void application_forward_notification(application_t app, service_id service, instance_id instance,
+                                          notifier_id notifier, bool force_send, payload_t payload);
+    session_id application_forward_request(application_t app, service_id service, instance_id instance,
+                                           method_id method, major_version major, bool reliable, bool no_return,
+                                           payload_t payload);
+    void application_forward_response(application_t app, service_id service, instance_id instance, method_id method,
+                                      client_id client, session_id session, major_version major, bool reliable,
+                                      enum return_code rc, payload_t payload);
+
 
 // payload handling
     struct PayloadInfo {
@@ -170,10 +403,51 @@ extern "C" {
         uint32_t len;
     };
 
+    // Statistics of the per-application pool of payload handles.
+    // `hits` counts handles taken from the free list, `misses` handles that had to be allocated.
+    // `exhausted` counts the handles refused because the arena was empty (static memory builds only),
+    // the messages concerned are dropped
+    struct payload_pool_stats {
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t exhausted;
+        uint32_t available;
+        uint32_t outstanding;
+    };
+
     payload_t application_payload_create(application_t app, uint8_t const* data, uint32_t size);
     payload_t payload_create_empty(application_t app);
     void payload_destroy(payload_t pl);
     struct PayloadInfo payload_get_info(payload_t pl);
+    struct payload_pool_stats application_payload_pool_stats(application_t app);
+
+    // Hot path statistics of an application.
+    // msgs_in/msgs_out are indexed by message kind: request, request without return, notification,
+    // response, error, other. Notifications sent are counted in notify_calls, bytes are payload bytes.
+    // handler_time is the time spent delivering a received message to its handler.
+    // Histogram bucket i < 4 holds the value i, above each power of two is split into 4 buckets:
+    // bucket (m - 1) * 4 + s holds the values [2^m + s * 2^(m-2), 2^m + (s + 1) * 2^(m-2)).
+#define VSOMEIPC_MESSAGE_TYPE_COUNT 6
+#define VSOMEIPC_HISTOGRAM_BUCKETS 252
+    struct latency_histogram {
+        uint64_t count;
+        uint64_t sum_ns;
+        uint64_t max_ns;
+        uint64_t buckets[VSOMEIPC_HISTOGRAM_BUCKETS];
+    };
+
+    struct application_stats {
+        uint64_t msgs_in[VSOMEIPC_MESSAGE_TYPE_COUNT];
+        uint64_t msgs_out[VSOMEIPC_MESSAGE_TYPE_COUNT];
+        uint64_t bytes_in;
+        uint64_t bytes_out;
+        uint64_t notify_calls;
+        uint64_t payload_allocations;
+        uint64_t dispatch_dropped;      // messages discarded at full dispatch worker queues
+        struct latency_histogram handler_time;
+    };
+
+    void application_get_stats(application_t app, struct application_stats* stats);
 
     // message handling
     message_t application_create_message(application_t app,
@@ -188,6 +462,11 @@ extern "C" {
     void application_send_msg(application_t app, message_t msg);
     void message_destroy(message_t msg);
 
+    // request templates: built once, sent repeatedly with new payload data
+    message_t application_create_request_template(application_t app, service_id service, instance_id instance,
+                                                  method_id method, major_version major, bool reliable);
+    session_id application_send_with(application_t app, message_t tmpl, uint8_t const* data, uint32_t data_len);
+
 
 #ifdef __cplusplus
 }